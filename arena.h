@@ -0,0 +1,260 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Size of the first block of an arena; larger requests get a block of their own
+const size_t ARENA_BLOCK_SIZE = 1024 * 1024;
+
+// An arena that needed more than this is emptied instead of kept for the next job
+const size_t ARENA_MAX_RETAINED = 64 * 1024 * 1024;
+
+// Totals over every arena of the process
+struct ArenaCounters
+{
+	std::atomic<size_t> allocations{ 0 }; // requests served from a block
+	std::atomic<size_t> bytes{ 0 };
+	std::atomic<size_t> blocks{ 0 }; // heap allocations made for blocks
+	std::atomic<size_t> blockBytes{ 0 };
+};
+
+ArenaCounters arenaCounters;
+
+// Bump allocator for load-time temporaries. Allocate hands out consecutive pieces of large
+// blocks and nothing is freed on its own; Rewind releases everything allocated after a Mark.
+// A full rewind merges the blocks into one, so the next job of the same size allocates from
+// a single block and makes no heap allocation at all. Not thread-safe: use one per thread.
+class Arena
+{
+public:
+	// Position in the arena, see Mark and Rewind
+	struct Marker
+	{
+		size_t block;
+		size_t used;
+	};
+
+	explicit Arena(size_t blockSize = ARENA_BLOCK_SIZE)
+		: blockSize(blockSize)
+	{
+	}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena()
+	{
+		Release();
+	}
+
+	/**
+	 * @brief Allocates memory that stays valid until the arena is rewound past it.
+	 *
+	 * @param bytes The size of the allocation.
+	 * @param alignment A power of two.
+	 * @return The memory; never NULL, throws std::bad_alloc like operator new.
+	 */
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+	{
+		for (; current < blocks.size(); current++)
+		{
+			Block& block = blocks[current];
+			uintptr_t start = (uintptr_t)block.data;
+			uintptr_t aligned = (start + block.used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			size_t offset = aligned - start;
+			if (offset + bytes <= block.size)
+			{
+				block.used = offset + bytes;
+				arenaCounters.allocations++;
+				arenaCounters.bytes += bytes;
+				return block.data + offset;
+			}
+			if (current + 1 < blocks.size())
+				blocks[current + 1].used = 0;
+		}
+		AddBlock(bytes + alignment > blockSize ? bytes + alignment : blockSize);
+		return Allocate(bytes, alignment);
+	}
+
+	// Typed Allocate for count default-constructed elements of a trivial type
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return (T*)Allocate(count * sizeof(T), alignof(T));
+	}
+
+	Marker Mark() const
+	{
+		Marker marker = { current, blocks.empty() ? 0 : blocks[current].used };
+		return marker;
+	}
+
+	/**
+	 * @brief Releases everything allocated since marker was taken.
+	 *
+	 * Rewinding to an empty arena merges its blocks into one of their combined size, or frees
+	 * them when that would exceed ARENA_MAX_RETAINED.
+	 *
+	 * @param marker A Mark of this arena not older than any earlier Rewind target.
+	 */
+	void Rewind(Marker marker)
+	{
+		if (blocks.empty())
+			return;
+		current = marker.block;
+		blocks[current].used = marker.used;
+		if (current != 0 || marker.used != 0 || blocks.size() == 1)
+			return;
+
+		size_t total = 0;
+		for (Block& block : blocks)
+			total += block.size;
+		Release();
+		if (total <= ARENA_MAX_RETAINED)
+			AddBlock(total);
+		current = 0;
+	}
+
+	void Reset()
+	{
+		Marker start = { 0, 0 };
+		Rewind(start);
+	}
+
+private:
+	struct Block
+	{
+		char* data;
+		size_t size;
+		size_t used;
+	};
+
+	void AddBlock(size_t size)
+	{
+		// operator new rather than malloc, so allocation counters such as loader_bench's see the blocks
+		Block block = { (char*)::operator new(size), size, 0 };
+		blocks.push_back(block);
+		current = blocks.size() - 1;
+		arenaCounters.blocks++;
+		arenaCounters.blockBytes += size;
+	}
+
+	void Release()
+	{
+		for (Block& block : blocks)
+			::operator delete(block.data);
+		blocks.clear();
+	}
+
+	std::vector<Block> blocks;
+	size_t current = 0;
+	size_t blockSize;
+};
+
+// The arena of the calling thread; load jobs use it through ArenaScope
+Arena& ThreadArena()
+{
+	thread_local Arena arena;
+	return arena;
+}
+
+// The arena ArenaAllocator takes memory from on this thread, NULL outside any ArenaScope
+Arena*& CurrentArena()
+{
+	thread_local Arena* arena = nullptr;
+	return arena;
+}
+
+// Scope of one load job: makes the thread's arena current and rewinds it on exit, releasing
+// everything allocated inside. Declare it before the containers that allocate from it, and
+// never let arena memory escape the scope.
+class ArenaScope
+{
+public:
+	ArenaScope()
+		: arena(ThreadArena()), marker(arena.Mark()), previous(CurrentArena())
+	{
+		CurrentArena() = &arena;
+	}
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+	~ArenaScope()
+	{
+		CurrentArena() = previous;
+		arena.Rewind(marker);
+	}
+
+	Arena& GetArena()
+	{
+		return arena;
+	}
+
+private:
+	Arena& arena;
+	Arena::Marker marker;
+	Arena* previous;
+};
+
+// std allocator over the arena that is current when the container is created; outside any
+// ArenaScope it falls back to operator new, so arena containers also work in plain code
+template <typename T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	Arena* arena;
+
+	ArenaAllocator()
+		: arena(CurrentArena())
+	{
+	}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other)
+		: arena(other.arena)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		if (arena != nullptr)
+			return arena->AllocateArray<T>(count);
+		return (T*)::operator new(count * sizeof(T));
+	}
+
+	void deallocate(T* p, size_t)
+	{
+		if (arena == nullptr)
+			::operator delete(p);
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.arena != b.arena;
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Prints how many heap allocations the arenas replaced so far
+void PrintArenaCounters(const char* label)
+{
+	size_t allocations = arenaCounters.allocations;
+	size_t blocks = arenaCounters.blocks;
+	printf("%s - arenas served %zu allocations (%.1f MB) from %zu blocks (%.1f MB), %zu heap allocations saved\n", label,
+		allocations, arenaCounters.bytes / (1024.0 * 1024.0), blocks, arenaCounters.blockBytes / (1024.0 * 1024.0),
+		allocations > blocks ? allocations - blocks : 0);
+}
@@ -0,0 +1,294 @@
+#pragma once
+#include <glad/glad.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "meshbuffer.h"
+#include "staticbatch.h"
+#include "texture.h"
+#include "texturecache.h"
+#include "texturemanager.h"
+#include "threadpool.h"
+
+// Pixels of a texture waiting for fill_texture on the GL thread: mapped from the texture cache,
+// or decoded by loadbitmap on a worker into new[]'d memory, since they outlive the job's arena scope
+struct DecodedBitmap
+{
+	const unsigned char* pixels = nullptr;
+	unsigned char* decoded = nullptr;
+	MappedFile cacheFile;
+	int width = 0;
+	int height = 0;
+
+	~DecodedBitmap()
+	{
+		delete[] decoded;
+		UnmapFile(cacheFile);
+	}
+};
+
+/**
+ * @brief Does the file work of a texture load without touching GL, so it can run on a worker thread.
+ *
+ * The pixels are mapped from the texture cache if it holds the file's contents; otherwise the
+ * file is decoded with loadbitmap and a cache entry is written for the next run.
+ *
+ * @param path The path to the BMP file.
+ * @param keyed Whether key holds the content key of the file; without one the cache is skipped.
+ * @param key The content key of the file, from ContentKeyOf.
+ * @param bitmap Receives the pixels; bitmap.pixels stays null if the file could not be decoded.
+ */
+void PrepareTexture(const std::string& path, bool keyed, uint64_t key, DecodedBitmap& bitmap)
+{
+	if (keyed && OpenTextureCache(key, bitmap.cacheFile, bitmap.pixels, bitmap.width, bitmap.height))
+		return;
+	BITMAPINFOHEADER info;
+	BITMAPFILEHEADER file;
+	loadbitmap(path.c_str(), bitmap.decoded, &info, &file);
+	if (bitmap.decoded == nullptr)
+		return;
+	bitmap.pixels = bitmap.decoded;
+	bitmap.width = info.biWidth;
+	bitmap.height = info.biHeight;
+	if (keyed && !WriteTextureCache(key, bitmap.pixels, bitmap.width, bitmap.height))
+		printf("LoadTexture - could not write cache for %s\n", path.c_str());
+}
+
+// What the loader filled from one file: exactly one of mesh, batch and texture is set
+struct LoadedAsset
+{
+	std::string path;
+	MeshBuffer* mesh = nullptr; // from LoadMesh
+	StaticBatch* batch = nullptr; // from LoadStaticMesh
+	std::string texturePath; // from LoadStaticMesh, the image the part is drawn with
+	GLuint texture = 0; // from LoadTexture
+};
+
+// A mesh loaded once for every file with the same content key
+struct SharedAsset
+{
+	size_t users = 0; // distinct paths
+	size_t bytes = 0; // uploaded for the first user, set by the upload
+	std::vector<MeshBuffer*> targets;
+};
+
+// Loads meshes and textures in parallel for startup. LoadMesh and LoadTexture queue the file
+// work (cache mapping, OBJ parsing, BMP decoding) on a worker pool and return at once; Finish
+// then runs on the GL thread and uploads each asset as soon as its worker is done. Files with
+// the same contents are loaded once and share their GL objects.
+class AssetLoader
+{
+public:
+	explicit AssetLoader(unsigned int threads = 0)
+		: pool(threads)
+	{
+		start = std::chrono::steady_clock::now();
+	}
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// target must stay alive until Finish returns; a file with the contents of one loaded before
+	// gets a copy of that mesh's buffer, sharing its VAO, VBO and EBO
+	void LoadMesh(const std::string& path, MeshBuffer& target)
+	{
+		MeshBuffer* out = &target;
+		loaded.push_back(LoadedAsset());
+		loaded.back().path = path;
+		loaded.back().mesh = out;
+		SharedAsset* shared = nullptr;
+		uint64_t key;
+		if (ContentKeyOf(path, key))
+		{
+			shared = &sharedMeshes[key];
+			shared->users++;
+			shared->targets.push_back(out);
+			if (shared->users > 1)
+				return;
+		}
+		ThreadPool* parsePool = &pool;
+		Queue(path, [path, out, shared, parsePool]()
+		{
+			std::shared_ptr<PreparedMesh> prepared = std::make_shared<PreparedMesh>();
+			PrepareObjMesh(path, *parsePool, *prepared);
+			return std::function<void()>([prepared, out, shared]()
+			{
+				size_t bytes = PreparedMeshBytes(*prepared);
+				*out = UploadPreparedMesh(*prepared);
+				if (shared == nullptr)
+					return;
+				shared->bytes = bytes;
+				for (size_t i = 1; i < shared->targets.size(); i++)
+					*shared->targets[i] = *out;
+			});
+		});
+	}
+
+	// batch must stay alive until Finish returns; call UploadStaticBatch after it. The part is
+	// drawn with LoadTexture(texturePath), which is how HotReloader finds the parts of an image.
+	void LoadStaticMesh(const std::string& path, StaticBatch& batch, const std::string& texturePath)
+	{
+		GLuint texture = LoadTexture(texturePath);
+		StaticBatch* out = &batch;
+		loaded.push_back(LoadedAsset());
+		loaded.back().path = path;
+		loaded.back().batch = out;
+		loaded.back().texturePath = texturePath;
+		ThreadPool* parsePool = &pool;
+		Queue(path, [path, out, texture, parsePool]()
+		{
+			std::shared_ptr<PreparedMesh> prepared = std::make_shared<PreparedMesh>();
+			PrepareStaticMesh(path, *parsePool, *prepared);
+			return std::function<void()>([prepared, out, texture]() { AddStaticPart(*out, *prepared, texture); });
+		});
+	}
+
+	// Call on the GL thread; the texture name is valid at once and filled in by Finish. A path
+	// loaded before, or a file with the same contents, gives the same name (see TextureManager),
+	// so parts sharing an image can share a static batch draw. Each call holds a reference in
+	// Textures(). The returned reference follows the path if HotReloader gives a changed file a
+	// texture of its own. Decoded pixels are kept in the texture cache.
+	const GLuint& LoadTexture(const std::string& path)
+	{
+		TextureAcquireResult result;
+		const GLuint& texObject = textureManager.Acquire(path, result);
+		if (result != TEXTURE_PATH_HIT)
+		{
+			loaded.push_back(LoadedAsset());
+			loaded.back().path = path;
+			loaded.back().texture = texObject;
+		}
+		if (result != TEXTURE_CREATED)
+			return texObject;
+		TextureManager* manager = &textureManager;
+		Queue(path, [path, texObject, manager]()
+		{
+			std::shared_ptr<DecodedBitmap> bitmap = std::make_shared<DecodedBitmap>();
+			uint64_t key = 0;
+			bool keyed = ContentKeyOf(path, key);
+			PrepareTexture(path, keyed, key, *bitmap);
+			return std::function<void()>([bitmap, texObject, manager]()
+			{
+				fill_texture(texObject, bitmap->pixels, bitmap->width, bitmap->height);
+				manager->SetTextureSize(texObject, bitmap->pixels != nullptr ? bitmap->width : 0, bitmap->height);
+			});
+		});
+		return texObject;
+	}
+
+	/**
+	 * @brief Uploads every queued asset as it completes and returns once all are loaded.
+	 *
+	 * Must be called on the thread that owns the GL context. Prints the worker and upload time
+	 * of each asset and the total wall-clock time since the loader was created.
+	 */
+	void Finish()
+	{
+		double prepareTotal = 0.0;
+		double uploadTotal = 0.0;
+		size_t assets = 0;
+		for (;;)
+		{
+			Completed item;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				ready.wait(lock, [this]() { return !completed.empty() || pending == 0; });
+				if (completed.empty())
+					break;
+				item = std::move(completed.front());
+				completed.pop_front();
+			}
+
+			auto uploadStart = std::chrono::steady_clock::now();
+			item.upload();
+			double uploadMs = MillisecondsSince(uploadStart);
+			printf("AssetLoader - %-36s prepare=%7.2f ms upload=%6.2f ms\n", item.path.c_str(), item.prepareMs, uploadMs);
+			prepareTotal += item.prepareMs;
+			uploadTotal += uploadMs;
+			assets++;
+		}
+		printf("AssetLoader - %zu assets in %.1f ms on %u threads (prepare %.1f ms, upload %.1f ms summed)\n", assets,
+			MillisecondsSince(start), pool.Size(), prepareTotal, uploadTotal);
+		size_t sharedCount = 0;
+		size_t savedBytes = 0;
+		for (const std::pair<const uint64_t, SharedAsset>& entry : sharedMeshes)
+		{
+			sharedCount += entry.second.users - 1;
+			savedBytes += (entry.second.users - 1) * entry.second.bytes;
+		}
+		printf("AssetLoader - deduplicated %zu meshes by content, %.1f KB of loading and uploads saved\n", sharedCount,
+			savedBytes / 1024.0);
+		textureManager.PrintStats("AssetLoader");
+		PrintArenaCounters("AssetLoader");
+	}
+
+	// The textures of LoadTexture; Release a name once for every call that returned it
+	TextureManager& Textures()
+	{
+		return textureManager;
+	}
+
+	// Every file loaded so far, in call order; a texture path appears once
+	const std::vector<LoadedAsset>& Loaded() const
+	{
+		return loaded;
+	}
+
+private:
+	struct Completed
+	{
+		std::string path;
+		double prepareMs = 0.0;
+		std::function<void()> upload;
+	};
+
+	static double MillisecondsSince(std::chrono::steady_clock::time_point time)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time).count();
+	}
+
+	// Runs prepare on the pool and queues the upload step it returns for Finish. Each job gets an
+	// ArenaScope on its worker's arena, so its temporaries must not outlive prepare.
+	void Queue(const std::string& path, std::function<std::function<void()>()> prepare)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending++;
+		}
+		pool.Submit([this, path, prepare]()
+		{
+			auto prepareStart = std::chrono::steady_clock::now();
+			Completed item;
+			item.path = path;
+			{
+				ArenaScope scope;
+				item.upload = prepare();
+			}
+			item.prepareMs = MillisecondsSince(prepareStart);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				completed.push_back(std::move(item));
+				pending--;
+			}
+			ready.notify_one();
+		});
+	}
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<Completed> completed;
+	size_t pending = 0;
+	std::vector<LoadedAsset> loaded;
+	std::map<uint64_t, SharedAsset> sharedMeshes; // by content key
+	TextureManager textureManager;
+	std::chrono::steady_clock::time_point start;
+	ThreadPool pool; // declared last so its workers are joined before the queue is destroyed
+};
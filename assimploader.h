@@ -0,0 +1,296 @@
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "glbloader.h"
+#include "mapfile.h"
+#include "mesh.h"
+#include "objloader.h"
+#include "threadpool.h"
+
+// Define MESH_USE_ASSIMP to read every format Assimp knows (FBX, glTF, DAE, ...) through
+// lib/assimp.lib; assimp.dll must then ship next to the executable. Without it only OBJ is read.
+#ifdef MESH_USE_ASSIMP
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "assimp.lib")
+#endif
+
+// Welds the corners, orders the triangles for the vertex cache, splits faces into triangles and
+// merges meshes sharing a material. SortByPType moves points and lines out of the triangle
+// meshes and GenSmoothNormals fills in normals a file does not have.
+const unsigned int ASSIMP_IMPORT_FLAGS = aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality | aiProcess_Triangulate
+	| aiProcess_OptimizeMeshes | aiProcess_SortByPType | aiProcess_GenSmoothNormals;
+
+// Read-only Assimp stream over a memory-mapped file
+class MappedIOStream : public Assimp::IOStream
+{
+public:
+	MappedFile file;
+	size_t position = 0;
+
+	~MappedIOStream()
+	{
+		UnmapFile(file);
+	}
+
+	size_t Read(void* buffer, size_t size, size_t count)
+	{
+		if (size == 0)
+			return 0;
+		size_t available = (file.size - position) / size;
+		if (count > available)
+			count = available;
+		memcpy(buffer, file.data + position, size * count);
+		position += size * count;
+		return count;
+	}
+
+	size_t Write(const void*, size_t, size_t)
+	{
+		return 0;
+	}
+
+	aiReturn Seek(size_t offset, aiOrigin origin)
+	{
+		size_t base = origin == aiOrigin_SET ? 0 : origin == aiOrigin_CUR ? position : file.size;
+		size_t target = origin == aiOrigin_END ? base - offset : base + offset;
+		if (target > file.size)
+			return aiReturn_FAILURE;
+		position = target;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const
+	{
+		return position;
+	}
+
+	size_t FileSize() const
+	{
+		return file.size;
+	}
+
+	void Flush()
+	{
+	}
+};
+
+// Assimp file system that maps the files it is asked for and records every one it opens, so the
+// mesh cache can depend on them (an MTL, a glTF .bin, ...)
+class RecordingIOSystem : public Assimp::IOSystem
+{
+public:
+	std::vector<std::string> opened;
+
+	bool Exists(const char* path) const
+	{
+		std::error_code ec;
+		return FindPakEntry(mountedPak, path) != nullptr || std::filesystem::is_regular_file(path, ec);
+	}
+
+	char getOsSeparator() const
+	{
+		return '/';
+	}
+
+	Assimp::IOStream* Open(const char* path, const char* mode)
+	{
+		if (strchr(mode, 'w') != nullptr || strchr(mode, 'a') != nullptr)
+			return nullptr;
+		MappedIOStream* stream = new MappedIOStream();
+		if (!MapFile(path, stream->file))
+		{
+			delete stream;
+			return nullptr;
+		}
+		bool seen = false;
+		for (const std::string& other : opened)
+			seen = seen || other == path;
+		if (!seen)
+			opened.push_back(path);
+		return stream;
+	}
+
+	void Close(Assimp::IOStream* stream)
+	{
+		delete stream;
+	}
+};
+
+Material ReadAssimpMaterial(const aiMaterial* in)
+{
+	Material material;
+	aiString name;
+	if (in->Get(AI_MATKEY_NAME, name) == aiReturn_SUCCESS)
+		material.name = name.C_Str();
+	aiColor3D color;
+	if (in->Get(AI_MATKEY_COLOR_DIFFUSE, color) == aiReturn_SUCCESS)
+		material.diffuse = glm::vec3(color.r, color.g, color.b);
+	if (in->Get(AI_MATKEY_COLOR_SPECULAR, color) == aiReturn_SUCCESS)
+		material.specular = glm::vec3(color.r, color.g, color.b);
+	if (in->Get(AI_MATKEY_COLOR_EMISSIVE, color) == aiReturn_SUCCESS)
+		material.emissive = glm::vec3(color.r, color.g, color.b);
+	float shininess;
+	if (in->Get(AI_MATKEY_SHININESS, shininess) == aiReturn_SUCCESS && shininess > 0.f)
+		material.shininess = shininess;
+	return material;
+}
+
+/**
+ * @brief Appends the triangle meshes of a node and its children, in world space, one submesh per mesh instance.
+ *
+ * @param scene The imported scene.
+ * @param node The node to append.
+ * @param parent The world transform of the node's parent.
+ * @param mesh The mesh to append to.
+ */
+void AppendAssimpNode(const aiScene* scene, const aiNode* node, const aiMatrix4x4& parent, Mesh& mesh)
+{
+	aiMatrix4x4 transform = parent * node->mTransformation;
+	aiMatrix3x3 normalTransform = aiMatrix3x3(transform);
+	normalTransform.Inverse().Transpose();
+
+	for (unsigned int m = 0; m < node->mNumMeshes; m++)
+	{
+		const aiMesh* in = scene->mMeshes[node->mMeshes[m]];
+		if ((in->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0)
+			continue;
+
+		unsigned int baseVertex = (unsigned int)MeshVertexCount(mesh);
+		size_t first = mesh.vertices.size();
+		mesh.vertices.resize(first + (size_t)in->mNumVertices * MESH_VERTEX_STRIDE);
+		float* out = mesh.vertices.data() + first;
+		for (unsigned int v = 0; v < in->mNumVertices; v++, out += MESH_VERTEX_STRIDE)
+		{
+			aiVector3D position = transform * in->mVertices[v];
+			aiVector3D normal = in->HasNormals() ? normalTransform * in->mNormals[v] : aiVector3D(0.f, 0.f, 0.f);
+			if (normal.SquareLength() > 0.f)
+				normal.Normalize();
+			aiVector3D uv = in->HasTextureCoords(0) ? in->mTextureCoords[0][v] : aiVector3D(0.f, 0.f, 0.f);
+			out[0] = position.x;
+			out[1] = position.y;
+			out[2] = position.z;
+			out[3] = normal.x;
+			out[4] = normal.y;
+			out[5] = normal.z;
+			out[6] = uv.x;
+			out[7] = uv.y;
+		}
+
+		SubMesh submesh;
+		submesh.name = in->mName.length > 0 ? in->mName.C_Str() : node->mName.C_Str();
+		submesh.materialIndex = in->mMaterialIndex < mesh.materials.size() ? (int)in->mMaterialIndex : -1;
+		if (submesh.materialIndex >= 0)
+			submesh.material = mesh.materials[submesh.materialIndex].name;
+		submesh.firstIndex = (unsigned int)mesh.indices.size();
+		for (unsigned int f = 0; f < in->mNumFaces; f++)
+		{
+			const aiFace& face = in->mFaces[f];
+			if (face.mNumIndices != 3)
+				continue;
+			for (unsigned int corner = 0; corner < 3; corner++)
+				mesh.indices.push_back(baseVertex + face.mIndices[corner]);
+		}
+		submesh.indexCount = (unsigned int)mesh.indices.size() - submesh.firstIndex;
+		if (submesh.indexCount > 0)
+			mesh.submeshes.push_back(submesh);
+	}
+
+	for (unsigned int child = 0; child < node->mNumChildren; child++)
+		AppendAssimpNode(scene, node->mChildren[child], transform, mesh);
+}
+#endif
+
+/**
+ * @brief Reads any file Assimp can import into an indexed mesh, flattening the node hierarchy.
+ *
+ * Every other file Assimp opens on the way, e.g. an MTL or a glTF buffer, is listed in
+ * mesh.dependencies so the mesh cache notices when it changes.
+ *
+ * @param filePath The path to the model file.
+ * @param mesh Receives the mesh.
+ * @return False if the file could not be imported or has no triangles, or without MESH_USE_ASSIMP.
+ */
+bool ReadAssimpMesh(const std::string& filePath, Mesh& mesh)
+{
+#ifdef MESH_USE_ASSIMP
+	Assimp::Importer importer;
+	RecordingIOSystem* io = new RecordingIOSystem(); // owned by the importer
+	importer.SetIOHandler(io);
+	const aiScene* scene = importer.ReadFile(filePath, ASSIMP_IMPORT_FLAGS);
+	if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0 || scene->mRootNode == nullptr)
+	{
+		printf("ReadAssimpMesh - could not import %s: %s\n", filePath.c_str(), importer.GetErrorString());
+		return false;
+	}
+
+	mesh = Mesh();
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+		mesh.materials.push_back(ReadAssimpMaterial(scene->mMaterials[i]));
+	AppendAssimpNode(scene, scene->mRootNode, aiMatrix4x4(), mesh);
+	if (mesh.indices.empty())
+	{
+		printf("ReadAssimpMesh - %s has no triangles\n", filePath.c_str());
+		return false;
+	}
+	ComputeMeshBounds(mesh);
+	for (const std::string& path : io->opened)
+	{
+		if (path != filePath)
+			mesh.dependencies.push_back(path);
+	}
+
+	size_t vertexCount = MeshVertexCount(mesh);
+	printf("ReadAssimpMesh - %s triangles=%zu vertices=%zu submeshes=%zu materials=%zu dependencies=%zu\n", filePath.c_str(),
+		mesh.indices.size() / 3, vertexCount, mesh.submeshes.size(), mesh.materials.size(), mesh.dependencies.size());
+	return true;
+#else
+	(void)mesh;
+	printf("ReadAssimpMesh - %s needs a build with MESH_USE_ASSIMP\n", filePath.c_str());
+	return false;
+#endif
+}
+
+// Case-insensitive check of the extension, given in lower case without the dot
+bool HasExtension(const std::string& filePath, const char* extension)
+{
+	size_t dot = filePath.find_last_of('.');
+	size_t length = strlen(extension);
+	if (dot == std::string::npos || filePath.size() - dot - 1 != length)
+		return false;
+	for (size_t i = 0; i < length; i++)
+	{
+		if ((filePath[dot + 1 + i] | 0x20) != extension[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Reads a model file into an indexed mesh: OBJ with ReadObjMesh, GLB with ReadGlbMesh, anything else with ReadAssimpMesh.
+ *
+ * OBJ and GLB keep their own readers, which are faster; the OBJ reader tracks its MTL files itself
+ * and a GLB has none.
+ *
+ * @param filePath The path to the model file.
+ * @param pool The pool to parse OBJ files on.
+ * @param mesh Receives the mesh.
+ * @return False if the file could not be read.
+ */
+bool ReadMeshFile(const std::string& filePath, ThreadPool& pool, Mesh& mesh)
+{
+	if (HasExtension(filePath, "obj"))
+		return ReadObjMesh(filePath, pool, mesh);
+	if (HasExtension(filePath, "glb"))
+		return ReadGlbMesh(filePath, mesh);
+	return ReadAssimpMesh(filePath, mesh);
+}
@@ -0,0 +1,154 @@
+// Compares ways of getting BMP pixels ready for glTexImage2D: the scalar R/B swap loadbitmap used
+// to do, an SSSE3 pshufb swap, and the plain row copy loadbitmap does now that textures are
+// uploaded as GL_BGR.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -mssse3 -I. -Iinclude bench/bmp_swizzle_bench.cpp include/glad/glad.c -o bmp_swizzle_bench
+//   ./bmp_swizzle_bench [file.bmp...]
+// Without files it uses every image in resources/bmp. Without -mssse3 the pshufb case is skipped.
+// On Windows, add bench/bmp_swizzle_bench.cpp to an empty console project with the same include directories.
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define BENCH_HAS_SSSE3 1
+#endif
+
+#include "bitmap.h"
+
+const int BENCH_REPEATS = 50;
+
+// What loadbitmap did before: copy, then swap R and B one pixel at a time
+void SwapScalar(const unsigned char* source, unsigned char* destination, size_t bytes)
+{
+	memcpy(destination, source, bytes);
+	for (size_t i = 0; i + 2 < bytes; i += 3)
+	{
+		unsigned char tmp = destination[i];
+		destination[i] = destination[i + 2];
+		destination[i + 2] = tmp;
+	}
+}
+
+#ifdef BENCH_HAS_SSSE3
+// Swaps R and B of five pixels per 16-byte load; the 16th byte is stored unchanged and
+// rewritten by the next step, which starts 15 bytes on
+void SwapSsse3(const unsigned char* source, unsigned char* destination, size_t bytes)
+{
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+	size_t i = 0;
+	for (; i + 16 <= bytes; i += 15)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(source + i));
+		_mm_storeu_si128((__m128i*)(destination + i), _mm_shuffle_epi8(pixels, mask));
+	}
+	for (; i + 2 < bytes; i += 3)
+	{
+		destination[i] = source[i + 2];
+		destination[i + 1] = source[i + 1];
+		destination[i + 2] = source[i];
+	}
+}
+#endif
+
+// What loadbitmap does now for a bottom-up 24-bit file without row padding
+void CopyRows(const unsigned char* source, unsigned char* destination, size_t bytes)
+{
+	memcpy(destination, source, bytes);
+}
+
+// Best time of BENCH_REPEATS runs over all images, in nanoseconds per pixel
+template <typename Convert>
+double TimeConversion(const std::vector<std::vector<unsigned char>>& images, std::vector<unsigned char>& out, Convert convert)
+{
+	size_t pixels = 0;
+	for (const std::vector<unsigned char>& image : images)
+		pixels += image.size() / 3;
+	double best = 1e30;
+	for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (const std::vector<unsigned char>& image : images)
+			convert(image.data(), out.data(), image.size());
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = seconds < best ? seconds : best;
+	}
+	return best * 1e9 / (pixels ? pixels : 1);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+		paths.push_back(argv[i]);
+	if (paths.empty())
+	{
+		std::error_code ec;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("resources/bmp", ec))
+		{
+			if (entry.path().extension() == ".bmp")
+				paths.push_back(entry.path().generic_string());
+		}
+	}
+
+	// The decoded BGR pixels of every image, as the conversions' input
+	std::vector<std::vector<unsigned char>> images;
+	size_t largest = 0;
+	double decodeSeconds = 1e30;
+	for (int repeat = 0; repeat < 5; repeat++)
+	{
+		std::vector<std::vector<unsigned char>> decoded;
+		auto start = std::chrono::steady_clock::now();
+		for (const std::string& path : paths)
+		{
+			unsigned char* pixels = NULL;
+			BITMAPINFOHEADER info;
+			BITMAPFILEHEADER file;
+			if (!loadbitmap(path.c_str(), pixels, &info, &file))
+				continue;
+			decoded.emplace_back(pixels, pixels + (size_t)info.biWidth * info.biHeight * 3);
+			delete[] pixels;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		decodeSeconds = seconds < decodeSeconds ? seconds : decodeSeconds;
+		images.swap(decoded);
+	}
+	if (images.empty())
+	{
+		printf("usage: %s [file.bmp...] (no images found)\n", argv[0]);
+		return 1;
+	}
+	size_t pixels = 0;
+	for (const std::vector<unsigned char>& image : images)
+	{
+		largest = image.size() > largest ? image.size() : largest;
+		pixels += image.size() / 3;
+	}
+	std::vector<unsigned char> out(largest), check(largest);
+
+	printf("%zu images, %.2f Mpixels; loadbitmap %.2f ms for all (best of 5, with logging)\n", images.size(), pixels / 1e6,
+		decodeSeconds * 1e3);
+	double scalar = TimeConversion(images, out, SwapScalar);
+	printf("%-34s %7.3f ns/pixel %8.1f MB/s\n", "scalar R/B swap (old loadbitmap)", scalar, 3e3 / scalar);
+#ifdef BENCH_HAS_SSSE3
+	double ssse3 = TimeConversion(images, out, SwapSsse3);
+	bool same = true;
+	for (const std::vector<unsigned char>& image : images)
+	{
+		SwapScalar(image.data(), check.data(), image.size());
+		SwapSsse3(image.data(), out.data(), image.size());
+		same = same && memcmp(check.data(), out.data(), image.size()) == 0;
+	}
+	printf("%-34s %7.3f ns/pixel %8.1f MB/s %.1fx%s\n", "ssse3 pshufb swap", ssse3, 3e3 / ssse3, scalar / ssse3,
+		same ? "" : " MISMATCH");
+#else
+	printf("%-34s skipped, build with -mssse3\n", "ssse3 pshufb swap");
+#endif
+	double copy = TimeConversion(images, out, CopyRows);
+	printf("%-34s %7.3f ns/pixel %8.1f MB/s %.1fx\n", "row copy, GL_BGR upload (now)", copy, 3e3 / copy, scalar / copy);
+	return 0;
+}
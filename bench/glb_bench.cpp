@@ -0,0 +1,236 @@
+// Compares loading the same geometry from OBJ and from GLB. Runs headless on Linux.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. -Iinclude bench/glb_bench.cpp -o glb_bench
+//   ./glb_bench [--reps N] [--tmp DIR] resources/*.obj
+//
+// Each OBJ is read with ReadObjMesh and written to DIR (default /tmp) as a GLB with one primitive
+// per submesh. The table shows the median time of N runs (default 9) for:
+//   ReadObjFile  parsing the OBJ into expanded vertices
+//   ReadObjMesh  parsing it into an indexed mesh
+//   OpenGlbFile  mapping the GLB and reading its JSON chunk, all LoadGlbMesh does before glBufferData
+//   ReadGlbMesh  also copying the accessors into an indexed mesh, as the mesh cache path does
+// "speedup" is ReadObjFile over OpenGlbFile.
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "glbloader.h"
+#include "objloader.h"
+
+void AppendBytes(std::vector<char>& bin, const void* data, size_t size)
+{
+	bin.insert(bin.end(), (const char*)data, (const char*)data + size);
+	while (bin.size() % 4 != 0)
+		bin.push_back(0);
+}
+
+// Equal up to the rounding of flipping v on the way out and back
+bool SameVertices(const std::vector<float>& a, const std::vector<float>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (fabsf(a[i] - b[i]) > 1e-6f)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Writes an indexed mesh as a GLB: one bufferView each for positions, normals, UVs and indices.
+ *
+ * Every submesh becomes a primitive sharing the vertex accessors, with its own index accessor.
+ */
+bool WriteGlbMesh(const std::string& path, const Mesh& mesh)
+{
+	size_t vertexCount = MeshVertexCount(mesh);
+	std::vector<float> positions, normals, uvs;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const float* in = mesh.vertices.data() + v * MESH_VERTEX_STRIDE;
+		positions.insert(positions.end(), in, in + 3);
+		normals.insert(normals.end(), in + 3, in + 6);
+		// glTF puts the texture origin at the top left, OBJ at the bottom left
+		uvs.push_back(in[6]);
+		uvs.push_back(1.f - in[7]);
+	}
+	bool shortIndices = vertexCount < 0xFFFF;
+	std::vector<char> bin;
+	AppendBytes(bin, positions.data(), positions.size() * sizeof(float));
+	size_t normalOffset = bin.size();
+	AppendBytes(bin, normals.data(), normals.size() * sizeof(float));
+	size_t uvOffset = bin.size();
+	AppendBytes(bin, uvs.data(), uvs.size() * sizeof(float));
+	size_t indexOffset = bin.size();
+	if (shortIndices)
+	{
+		std::vector<unsigned short> narrow(mesh.indices.begin(), mesh.indices.end());
+		AppendBytes(bin, narrow.data(), narrow.size() * sizeof(unsigned short));
+	}
+	else
+	{
+		AppendBytes(bin, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+	}
+	size_t indexSize = shortIndices ? 2 : 4;
+
+	char number[256];
+	std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"glb_bench\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+		"\"nodes\":[{\"mesh\":0}],\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}],\"bufferViews\":[";
+	snprintf(number, sizeof(number), "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu,\"target\":34962},", positions.size() * 4);
+	json += number;
+	snprintf(number, sizeof(number), "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34962},", normalOffset, normals.size() * 4);
+	json += number;
+	snprintf(number, sizeof(number), "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34962},", uvOffset, uvs.size() * 4);
+	json += number;
+	snprintf(number, sizeof(number), "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}],", indexOffset,
+		mesh.indices.size() * indexSize);
+	json += number;
+
+	json += "\"accessors\":[";
+	snprintf(number, sizeof(number), "{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]},",
+		vertexCount, mesh.boundsMin.x, mesh.boundsMin.y, mesh.boundsMin.z, mesh.boundsMax.x, mesh.boundsMax.y, mesh.boundsMax.z);
+	json += number;
+	snprintf(number, sizeof(number), "{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},", vertexCount);
+	json += number;
+	snprintf(number, sizeof(number), "{\"bufferView\":2,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"}", vertexCount);
+	json += number;
+	for (const SubMesh& submesh : mesh.submeshes)
+	{
+		snprintf(number, sizeof(number), ",{\"bufferView\":3,\"byteOffset\":%zu,\"componentType\":%d,\"count\":%u,\"type\":\"SCALAR\"}",
+			submesh.firstIndex * indexSize, shortIndices ? 5123 : 5125, submesh.indexCount);
+		json += number;
+	}
+	json += "],\"materials\":[";
+	for (size_t i = 0; i < mesh.materials.size(); i++)
+	{
+		const Material& material = mesh.materials[i];
+		snprintf(number, sizeof(number), "%s{\"pbrMetallicRoughness\":{\"baseColorFactor\":[%g,%g,%g,1]},\"emissiveFactor\":[%g,%g,%g],\"name\":",
+			i ? "," : "", material.diffuse.x, material.diffuse.y, material.diffuse.z, material.emissive.x, material.emissive.y, material.emissive.z);
+		json += number + JsonEscape(material.name) + "}";
+	}
+	json += "],\"meshes\":[{\"name\":" + JsonEscape(path) + ",\"primitives\":[";
+	for (size_t i = 0; i < mesh.submeshes.size(); i++)
+	{
+		const SubMesh& submesh = mesh.submeshes[i];
+		json += (i ? ",{" : "{") + std::string("\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":") + std::to_string(3 + i);
+		if (submesh.materialIndex >= 0)
+			json += ",\"material\":" + std::to_string(submesh.materialIndex);
+		json += "}";
+	}
+	json += "]}]}";
+	while (json.size() % 4 != 0)
+		json += ' ';
+
+	FILE* f = fopen(path.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	uint32_t header[5] = { 0x46546C67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size()), (uint32_t)json.size(), 0x4E4F534A };
+	uint32_t binHeader[2] = { (uint32_t)bin.size(), 0x004E4942 };
+	fwrite(header, sizeof(header), 1, f);
+	fwrite(json.data(), json.size(), 1, f);
+	fwrite(binHeader, sizeof(binHeader), 1, f);
+	fwrite(bin.data(), bin.size(), 1, f);
+	fclose(f);
+	return true;
+}
+
+// Median milliseconds of reps runs of load, with the loaders' logging sent to /dev/null
+template <typename Load>
+double MedianMs(int reps, Load load)
+{
+	fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	int null = open("/dev/null", O_WRONLY);
+	dup2(null, STDOUT_FILENO);
+	close(null);
+	load();
+	std::vector<double> times;
+	for (int rep = 0; rep < reps; rep++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		load();
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+size_t FileBytes(const std::string& path)
+{
+	MappedFile file;
+	if (!MapFile(path.c_str(), file))
+		return 0;
+	size_t size = file.size;
+	UnmapFile(file);
+	return size;
+}
+
+int main(int argc, char** argv)
+{
+	int reps = 9;
+	std::string tmp = "/tmp";
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--reps" && i + 1 < argc)
+			reps = std::max(1, atoi(argv[++i]));
+		else if (option == "--tmp" && i + 1 < argc)
+			tmp = argv[++i];
+		else
+			files.push_back(option);
+	}
+	if (files.empty())
+	{
+		printf("usage: %s [--reps N] [--tmp DIR] file.obj...\n", argv[0]);
+		return 1;
+	}
+
+	ThreadPool pool;
+	printf("%-32s %9s %9s %9s | %11s %11s %11s %11s | %7s\n", "mesh", "triangles", "obj KB", "glb KB", "ReadObjFile", "ReadObjMesh",
+		"OpenGlbFile", "ReadGlbMesh", "speedup");
+	for (const std::string& obj : files)
+	{
+		Mesh mesh;
+		fflush(stdout);
+		int saved = dup(STDOUT_FILENO);
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		close(null);
+		bool read = ReadObjMesh(obj, pool, mesh);
+		fflush(stdout);
+		dup2(saved, STDOUT_FILENO);
+		close(saved);
+		if (!read)
+			continue;
+
+		std::string name = obj.substr(obj.find_last_of('/') + 1);
+		std::string glb = tmp + "/glb_bench_" + name.substr(0, name.find_last_of('.')) + ".glb";
+		if (!WriteGlbMesh(glb, mesh))
+		{
+			printf("glb_bench - could not write %s\n", glb.c_str());
+			continue;
+		}
+		Mesh check;
+		if (!ReadGlbMesh(glb, check) || check.indices != mesh.indices || !SameVertices(check.vertices, mesh.vertices))
+		{
+			printf("glb_bench - %s does not read back as written\n", glb.c_str());
+			continue;
+		}
+
+		double objFile = MedianMs(reps, [&]() { std::vector<float> vertices = ReadObjFile(obj); });
+		double objMesh = MedianMs(reps, [&]() { Mesh out; ReadObjMesh(obj, pool, out); });
+		double glbOpen = MedianMs(reps, [&]() { GlbFile file; OpenGlbFile(glb, file); CloseGlbFile(file); });
+		double glbMesh = MedianMs(reps, [&]() { Mesh out; ReadGlbMesh(glb, out); });
+		printf("%-32s %9zu %9.1f %9.1f | %11.3f %11.3f %11.3f %11.3f | %6.1fx\n", obj.c_str(), mesh.indices.size() / 3,
+			FileBytes(obj) / 1024.0, FileBytes(glb) / 1024.0, objFile, objMesh, glbOpen, glbMesh, glbOpen > 0.0 ? objFile / glbOpen : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,307 @@
+// Loader throughput benchmark. Runs headless (no window or GL context) on Linux.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. -Iinclude bench/loader_bench.cpp -o loader_bench
+//   ./loader_bench [--reps N] [--max-mb M] [--tmp DIR]
+//
+// Every case runs in a forked child so its peak RSS is its own. Each case is run once to warm
+// the page cache, then timed N times (default 5). The table shows the median, min and max MB/s
+// over those runs, plus the operator new calls and bytes per run, which include the blocks of
+// the loaders' arenas (see arena.h). Like LoadShader and setup_texture, the read_file and
+// loadbitmap cases decode into the thread's arena. The synthetic OBJs double in size from 1 MB up to --max-mb (default 64; use
+// 1024 for the 1 GB case) and are written to --tmp (default /tmp).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bitmap.h"
+#include "objloader.h"
+#include "util.h"
+
+const int BENCH_MAX_REPS = 64;
+
+// Allocation counters for the current run, bumped by the replaced operator new; atomic because
+// ReadObjMesh allocates on the worker threads of benchPool too
+static std::atomic<size_t> benchAllocations{ 0 };
+static std::atomic<size_t> benchAllocatedBytes{ 0 };
+
+void* operator new(size_t size)
+{
+	benchAllocations.fetch_add(1, std::memory_order_relaxed);
+	benchAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	void* p = malloc(size ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+// What a child reports back through the pipe
+struct CaseResult
+{
+	int reps = 0;
+	size_t files = 0;
+	size_t inputBytes = 0; // per run
+	size_t allocations = 0; // per run
+	size_t allocatedBytes = 0; // per run
+	double seconds[BENCH_MAX_REPS] = {};
+};
+
+struct BenchCase
+{
+	std::string name;
+	std::vector<std::string> files;
+	void (*load)(const std::string& path);
+};
+
+std::vector<std::string> ListFiles(const std::string& directory, const std::string& extension, bool recursive)
+{
+	std::vector<std::string> files;
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL)
+		return files;
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name == "." || name == "..")
+			continue;
+		std::string path = directory + "/" + name;
+		if (entry->d_type == DT_DIR)
+		{
+			if (recursive)
+			{
+				std::vector<std::string> inner = ListFiles(path, extension, true);
+				files.insert(files.end(), inner.begin(), inner.end());
+			}
+		}
+		else if (extension.empty() || (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0))
+		{
+			files.push_back(path);
+		}
+	}
+	closedir(dir);
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+size_t FileSize(const std::string& path)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == NULL)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fclose(f);
+	return size > 0 ? (size_t)size : 0;
+}
+
+/**
+ * @brief Writes a Blender-style OBJ grid of about targetBytes, unless the file already has that size.
+ *
+ * Rows of 1024 vertices (v, vt and vn each) are followed by the quads joining them to the
+ * previous row, so every face only refers to vertices already written.
+ */
+bool WriteSyntheticObj(const std::string& path, size_t targetBytes)
+{
+	if (FileSize(path) >= targetBytes)
+		return true;
+	FILE* f = fopen(path.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	const int width = 1024;
+	size_t written = 0;
+	for (int row = 0; written < targetBytes; row++)
+	{
+		for (int column = 0; column < width; column++)
+		{
+			float x = column * 0.01f, z = row * 0.01f;
+			written += fprintf(f, "v %.6f %.6f %.6f\n", x, 0.1f * sinf(x + z), -z);
+			written += fprintf(f, "vt %.6f %.6f\n", column / (float)width, (row % width) / (float)width);
+			written += fprintf(f, "vn %.4f %.4f %.4f\n", 0.f, 1.f, 0.f);
+		}
+		if (row == 0)
+			continue;
+		for (int column = 0; column + 1 < width; column++)
+		{
+			long a = (long)(row - 1) * width + column + 1, b = a + 1, c = b + width, d = a + width;
+			written += fprintf(f, "f %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\n", a, a, a, b, b, b, c, c, c, d, d, d);
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+void LoadReadFile(const std::string& path)
+{
+	ArenaScope scope;
+	read_file(path.c_str(), &scope.GetArena());
+}
+
+void LoadBitmap(const std::string& path)
+{
+	ArenaScope scope;
+	unsigned char* pixels = NULL;
+	BITMAPINFOHEADER info;
+	BITMAPFILEHEADER file;
+	loadbitmap(path.c_str(), pixels, &info, &file, &scope.GetArena());
+}
+
+void LoadReadObjFile(const std::string& path)
+{
+	std::vector<float> vertices = ReadObjFile(path);
+}
+
+// Created in each child, since a forked child has no copies of the parent's worker threads
+ThreadPool* benchPool = nullptr;
+
+void LoadReadObjMesh(const std::string& path)
+{
+	Mesh mesh;
+	ReadObjMesh(path, *benchPool, mesh);
+}
+
+// Runs in the child: the loaders' own logging goes to /dev/null so only the table is printed
+CaseResult RunCase(const BenchCase& benchCase, int reps)
+{
+	int null = open("/dev/null", O_WRONLY);
+	dup2(null, STDOUT_FILENO);
+	close(null);
+
+	ThreadPool pool;
+	benchPool = &pool;
+
+	CaseResult result;
+	result.reps = reps;
+	result.files = benchCase.files.size();
+	for (const std::string& path : benchCase.files)
+		result.inputBytes += FileSize(path);
+
+	for (const std::string& path : benchCase.files)
+		benchCase.load(path);
+	for (int rep = 0; rep < reps; rep++)
+	{
+		benchAllocations.store(0, std::memory_order_relaxed);
+		benchAllocatedBytes.store(0, std::memory_order_relaxed);
+		auto start = std::chrono::steady_clock::now();
+		for (const std::string& path : benchCase.files)
+			benchCase.load(path);
+		result.seconds[rep] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.allocations = benchAllocations.load(std::memory_order_relaxed);
+		result.allocatedBytes = benchAllocatedBytes.load(std::memory_order_relaxed);
+	}
+	fflush(stdout);
+	return result;
+}
+
+void ReportCase(const BenchCase& benchCase, int reps)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return;
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(fds[0]);
+		CaseResult result = RunCase(benchCase, reps);
+		ssize_t ignored = write(fds[1], &result, sizeof(result));
+		(void)ignored;
+		_exit(0);
+	}
+	close(fds[1]);
+	CaseResult result;
+	ssize_t got = read(fds[0], &result, sizeof(result));
+	close(fds[0]);
+	int status = 0;
+	rusage usage;
+	wait4(pid, &status, 0, &usage);
+	if (got != (ssize_t)sizeof(result))
+	{
+		printf("%-28s failed (status %d)\n", benchCase.name.c_str(), status);
+		return;
+	}
+
+	double megabytes = result.inputBytes / (1024.0 * 1024.0);
+	std::vector<double> rates;
+	for (int rep = 0; rep < result.reps; rep++)
+		rates.push_back(megabytes / result.seconds[rep]);
+	std::sort(rates.begin(), rates.end());
+	double median = rates[rates.size() / 2];
+	printf("%-28s %5zu %9.1f %9.1f %9.1f %9.1f %11zu %10.1f %9.1f\n", benchCase.name.c_str(), result.files, megabytes,
+		median, rates.front(), rates.back(), result.allocations, result.allocatedBytes / (1024.0 * 1024.0), usage.ru_maxrss / 1024.0);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	int reps = 5;
+	size_t maxMegabytes = 64;
+	std::string tmp = "/tmp";
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string option = argv[i];
+		if (option == "--reps")
+			reps = std::max(1, std::min(BENCH_MAX_REPS, atoi(argv[i + 1])));
+		else if (option == "--max-mb")
+			maxMegabytes = (size_t)atol(argv[i + 1]);
+		else if (option == "--tmp")
+			tmp = argv[i + 1];
+	}
+
+	std::vector<BenchCase> cases;
+	cases.push_back({ "read_file resources/**", ListFiles("resources", "", true), LoadReadFile });
+	cases.push_back({ "loadbitmap resources/bmp", ListFiles("resources/bmp", ".bmp", false), LoadBitmap });
+	cases.push_back({ "ReadObjFile resources", ListFiles("resources", ".obj", false), LoadReadObjFile });
+	cases.push_back({ "ReadObjMesh resources", ListFiles("resources", ".obj", false), LoadReadObjMesh });
+	for (size_t megabytes = 1; megabytes <= maxMegabytes; megabytes *= 2)
+	{
+		std::string path = tmp + "/loader_bench_" + std::to_string(megabytes) + "MB.obj";
+		if (!WriteSyntheticObj(path, megabytes * 1024 * 1024))
+		{
+			printf("loader_bench - could not write %s\n", path.c_str());
+			break;
+		}
+		cases.push_back({ "ReadObjFile synthetic " + std::to_string(megabytes) + "MB", { path }, LoadReadObjFile });
+	}
+
+	printf("%d timed runs per case, %u hardware threads\n", reps, std::thread::hardware_concurrency());
+	printf("%-28s %5s %9s %9s %9s %9s %11s %10s %9s\n", "case", "files", "MB", "MB/s med", "MB/s min", "MB/s max",
+		"allocs/run", "alloc MB", "peak RSS");
+	for (const BenchCase& benchCase : cases)
+		ReportCase(benchCase, reps);
+	return 0;
+}
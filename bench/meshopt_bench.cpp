@@ -0,0 +1,89 @@
+// Reports the vertex cache efficiency of every mesh before and after OptimizeMesh. OBJ files are
+// always read; other formats need -DMESH_USE_ASSIMP and linking with assimp.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. -Iinclude bench/meshopt_bench.cpp -o meshopt_bench
+//   ./meshopt_bench resources/*.obj
+//
+// ACMR is shaded vertices per triangle and ATVR shaded vertices per vertex, both for a
+// VERTEX_CACHE_SIZE-entry FIFO cache. "tipsify" is after the vertex cache pass alone, "after"
+// also includes the overdraw ordering, which may give some of that back, and "meshlets" is
+// after BuildMeshlets has regrouped the triangles. "cone" is the share of meshlets whose normal
+// cone culls them, averaged over cameras spread around the mesh. "lods" lists the triangles of
+// every level from BuildMeshLods and "error" the coarsest level's error relative to the mesh radius.
+
+#include <chrono>
+
+#include "assimploader.h"
+#include "meshlet.h"
+#include "meshlod.h"
+#include "meshoptimize.h"
+
+// Fraction of meshlets back-face culled for cameras on a sphere around the mesh
+double ConeCulledFraction(const Mesh& mesh)
+{
+	glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	float distance = glm::length(mesh.boundsMax - mesh.boundsMin) + 1.f;
+	MeshCullView view;
+	for (glm::vec4& plane : view.planes)
+		plane = glm::vec4(0.f, 0.f, 0.f, 1.f);
+	view.backfaces = true;
+	size_t culled = 0, tested = 0;
+	for (int i = 0; i < 64; i++)
+	{
+		// Fibonacci sphere
+		float y = 1.f - (i + 0.5f) / 32.f;
+		float ring = sqrtf(1.f - y * y);
+		float angle = i * 2.39996323f;
+		view.cameraPosition = center + distance * glm::vec3(ring * cosf(angle), y, ring * sinf(angle));
+		for (const Meshlet& meshlet : mesh.meshlets)
+		{
+			tested++;
+			culled += !MeshletVisible(view, meshlet);
+		}
+	}
+	return tested ? (double)culled / tested : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s file.obj...\n", argv[0]);
+		return 1;
+	}
+
+	ThreadPool pool;
+	printf("%-32s %9s %9s | %7s %7s %7s %8s | %6s %6s | %8s %8s %6s | %-24s %6s | %8s %8s\n", "mesh", "triangles", "vertices",
+		"acmr", "tipsify", "after", "meshlets", "atvr", "after", "clusters", "meshlets", "cone", "lods", "error", "ms", "lod ms");
+	for (int arg = 1; arg < argc; arg++)
+	{
+		Mesh mesh;
+		if (!ReadMeshFile(argv[arg], pool, mesh))
+			continue;
+		auto start = std::chrono::steady_clock::now();
+		MeshOptimizeStats stats = OptimizeMesh(mesh);
+		BuildMeshlets(mesh);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		VertexCacheStats meshlets = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), MeshVertexCount(mesh));
+		size_t triangleCount = mesh.indices.size() / 3;
+		start = std::chrono::steady_clock::now();
+		BuildMeshLods(mesh);
+		double lodMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::string lods = std::to_string(triangleCount);
+		for (int level = 1; level < mesh.lodCount; level++)
+		{
+			size_t levelTriangles = 0;
+			for (const SubMesh& submesh : mesh.submeshes)
+				levelTriangles += submesh.lods[level - 1].indexCount / 3;
+			lods += "/" + std::to_string(levelTriangles);
+		}
+		float radius = 0.5f * glm::length(mesh.boundsMax - mesh.boundsMin);
+		printf("%-32s %9zu %9zu | %7.3f %7.3f %7.3f %8.3f | %6.3f %6.3f | %8zu %8zu %5.1f%% | %-24s %5.1f%% | %8.2f %8.2f\n",
+			argv[arg], triangleCount, MeshVertexCount(mesh), stats.before.acmr, stats.vertexCache.acmr, stats.after.acmr,
+			meshlets.acmr, stats.before.atvr, meshlets.atvr, stats.clusters, mesh.meshlets.size(),
+			100.0 * ConeCulledFraction(mesh), lods.c_str(), radius > 0.f ? 100.0 * mesh.lodErrors[mesh.lodCount - 1] / radius : 0.0,
+			ms, lodMs);
+	}
+	return 0;
+}
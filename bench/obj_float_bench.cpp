@@ -0,0 +1,115 @@
+// Compares the OBJ float parsers on the numbers of the v/vt/vn records of OBJ files.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. -Iinclude bench/obj_float_bench.cpp -o obj_float_bench
+//   ./obj_float_bench resources/PipeNail.obj resources/pumpBase.obj
+// On Windows, add bench/obj_float_bench.cpp to an empty console project with the same include directories.
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "objloader.h"
+
+const int BENCH_REPEATS = 20;
+
+// Start of every number on the attribute lines; the text is NUL-terminated for strtof
+std::vector<const char*> CollectObjNumbers(const std::string& text)
+{
+	std::vector<const char*> numbers;
+	const char* p = text.c_str();
+	const char* end = p + text.size();
+	while (p < end)
+	{
+		if (p[0] == 'v' && (p[1] == ' ' || ((p[1] == 't' || p[1] == 'n') && p[2] == ' ')))
+		{
+			p = SkipBlanks(p + (p[1] == ' ' ? 1 : 2), end);
+			while (p < end && *p != '\n' && *p != '\r')
+			{
+				numbers.push_back(p);
+				while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+					++p;
+				p = SkipBlanks(p, end);
+			}
+		}
+		p = SkipLine(p, end);
+	}
+	return numbers;
+}
+
+// Best time of BENCH_REPEATS runs in nanoseconds per number
+template <typename Parse>
+double TimeParser(const std::vector<const char*>& numbers, const char* end, std::vector<float>& values, Parse parse)
+{
+	double best = 1e30;
+	for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < numbers.size(); i++)
+			values[i] = parse(numbers[i], end);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = seconds < best ? seconds : best;
+	}
+	return best * 1e9 / (numbers.size() ? numbers.size() : 1);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s file.obj...\n", argv[0]);
+		return 1;
+	}
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		MappedFile file;
+		if (!MapFile(argv[arg], file))
+		{
+			printf("obj_float_bench - could not open %s\n", argv[arg]);
+			continue;
+		}
+		std::string text(file.data, file.size);
+		UnmapFile(file);
+
+		std::vector<const char*> numbers = CollectObjNumbers(text);
+		const char* end = text.c_str() + text.size();
+		size_t fixed = 0;
+#ifdef OBJ_USE_SSE2
+		for (const char* number : numbers)
+		{
+			float value;
+			if (end - number >= 17 && ParseObjFixedFloat(number, value) != nullptr)
+				fixed++;
+		}
+#endif
+
+		std::vector<float> reference(numbers.size()), fromChars(numbers.size()), objFloat(numbers.size());
+		double strtofTime = TimeParser(numbers, end, reference, [](const char* p, const char*) { return strtof(p, nullptr); });
+		double fromCharsTime = TimeParser(numbers, end, fromChars, [](const char* p, const char* e)
+		{
+			float value = 0.f;
+			std::from_chars(p, e, value);
+			return value;
+		});
+		double objFloatTime = TimeParser(numbers, end, objFloat, [](const char* p, const char* e)
+		{
+			float value;
+			ParseObjFloat(p, e, value);
+			return value;
+		});
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < numbers.size(); i++)
+		{
+			if (memcmp(&reference[i], &objFloat[i], sizeof(float)) != 0 || memcmp(&reference[i], &fromChars[i], sizeof(float)) != 0)
+				mismatches++;
+		}
+
+		printf("%s: %zu numbers, %.1f%% fixed-form, %zu mismatches\n", argv[arg], numbers.size(),
+			numbers.empty() ? 0.0 : 100.0 * fixed / numbers.size(), mismatches);
+		printf("  strtof        %6.2f ns/number\n", strtofTime);
+		printf("  from_chars    %6.2f ns/number\n", fromCharsTime);
+		printf("  ParseObjFloat %6.2f ns/number\n", objFloatTime);
+	}
+	return 0;
+}
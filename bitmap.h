@@ -1,51 +1,139 @@
+#pragma once
 #include "glad/glad.h"
 #include <stdio.h>
+#include <stdint.h>
+#ifdef _WIN32
 #include <windows.h>
 #include <wingdi.h>
+#else
 
+// The BMP headers as declared in wingdi.h
+#pragma pack(push, 2)
+struct BITMAPFILEHEADER
+{
+	uint16_t bfType;
+	uint32_t bfSize;
+	uint16_t bfReserved1;
+	uint16_t bfReserved2;
+	uint32_t bfOffBits;
+};
+#pragma pack(pop)
 
-
-GLuint loadbitmap(const char* filename, unsigned char*& pixelBuffer, BITMAPINFOHEADER* infoHeader, BITMAPFILEHEADER* fileHeader)
+struct BITMAPINFOHEADER
 {
-	FILE* bitmapFile;
+	uint32_t biSize;
+	int32_t biWidth;
+	int32_t biHeight;
+	uint16_t biPlanes;
+	uint16_t biBitCount;
+	uint32_t biCompression;
+	uint32_t biSizeImage;
+	int32_t biXPelsPerMeter;
+	int32_t biYPelsPerMeter;
+	uint32_t biClrUsed;
+	uint32_t biClrImportant;
+};
+#endif
+
+#include "util.h"
+
+
 
-	errno_t err = fopen_s(&bitmapFile, filename, "rb");
-	if (err != 0 || bitmapFile == NULL)
+/**
+ * @brief Decodes an uncompressed 24- or 32-bit BMP file into tightly packed BGR rows, bottom row first.
+ *
+ * BGR is the order BMP stores and glTexImage2D reads with GL_BGR, so no channel is swapped on
+ * the CPU; the rows are only unpadded, flipped if the file stores them top-down, and stripped of
+ * the unused fourth byte of 32-bit pixels. Afterwards infoHeader->biHeight holds the positive
+ * row count, also for a top-down file, whose header stores it negated.
+ *
+ * @param filename The path to the BMP file.
+ * @param pixelBuffer Receives width * height * 3 bytes; from the arena if one is given, which must
+ * then not be deleted, otherwise new[]'d.
+ * @param infoHeader Receives the info header.
+ * @param fileHeader Receives the file header.
+ * @param arena Optional arena to allocate the pixels from.
+ * @return 1 on success, 0 if the file is missing or not a supported BMP.
+ */
+GLuint loadbitmap(const char* filename, unsigned char*& pixelBuffer, BITMAPINFOHEADER* infoHeader, BITMAPFILEHEADER* fileHeader,
+	Arena* arena = NULL)
+{
+	MappedFile bitmapFile;
+	if (!MapFile(filename, bitmapFile))
 	{
 		printf("loadbitmap - open failed for %s\n", filename);
 		return NULL;
 	}
 
-	fread(fileHeader, sizeof(BITMAPFILEHEADER), 1, bitmapFile);
+	if (bitmapFile.size < sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER))
+	{
+		printf("loadbitmap - type failed \n");
+		UnmapFile(bitmapFile);
+		return NULL;
+	}
+	memcpy(fileHeader, bitmapFile.data, sizeof(BITMAPFILEHEADER));
 
 	if (fileHeader->bfType != 0x4D42)
 	{
 		printf("loadbitmap - type failed \n");
+		UnmapFile(bitmapFile);
 		return NULL;
 	}
 
-	fread(infoHeader, sizeof(BITMAPINFOHEADER), 1, bitmapFile);
+	memcpy(infoHeader, bitmapFile.data + sizeof(BITMAPFILEHEADER), sizeof(BITMAPINFOHEADER));
 
-	if (infoHeader->biBitCount < 24)
+	if ((infoHeader->biBitCount != 24 && infoHeader->biBitCount != 32) || infoHeader->biCompression != 0)
 	{
-		printf("loadbitmap - bitcount failed = %d\n", infoHeader->biBitCount);
+		printf("loadbitmap - bitcount failed = %d compression = %u\n", infoHeader->biBitCount, (unsigned)infoHeader->biCompression);
+		UnmapFile(bitmapFile);
 		return NULL;
 	}
 
-	fseek(bitmapFile, fileHeader->bfOffBits, SEEK_SET);
-
-	int nBytes = infoHeader->biWidth * infoHeader->biHeight * 3;
-	pixelBuffer = new unsigned char[nBytes];
-	fread(pixelBuffer, sizeof(unsigned char), nBytes, bitmapFile);
-
-	fclose(bitmapFile);
-
-	for (int i = 0; i < nBytes; i += 3)
+	// Rows are padded to four bytes; the last one may lack its padding
+	bool topDown = infoHeader->biHeight < 0;
+	int64_t width = infoHeader->biWidth;
+	int64_t height = topDown ? -(int64_t)infoHeader->biHeight : infoHeader->biHeight;
+	size_t pixelSize = infoHeader->biBitCount / 8;
+	size_t rowStride = (size_t)((width * infoHeader->biBitCount + 31) / 32 * 4);
+	size_t rowBytes = (size_t)width * 3;
+	if (width <= 0 || height <= 0 || width > 32768 || height > 32768 || fileHeader->bfOffBits > bitmapFile.size
+		|| bitmapFile.size - fileHeader->bfOffBits < rowStride * (size_t)(height - 1) + (size_t)width * pixelSize)
 	{
-		unsigned char tmp = pixelBuffer[i];
-		pixelBuffer[i] = pixelBuffer[i + 2];
-		pixelBuffer[i + 2] = tmp;
+		printf("loadbitmap - %s is truncated\n", filename);
+		UnmapFile(bitmapFile);
+		return NULL;
 	}
+	size_t nBytes = rowBytes * (size_t)height;
+	pixelBuffer = arena != NULL ? arena->AllocateArray<unsigned char>(nBytes) : new unsigned char[nBytes];
+	const unsigned char* rows = (const unsigned char*)bitmapFile.data + fileHeader->bfOffBits;
+	if (pixelSize == 3 && rowStride == rowBytes && !topDown)
+	{
+		memcpy(pixelBuffer, rows, nBytes);
+	}
+	else
+	{
+		for (int64_t y = 0; y < height; y++)
+		{
+			const unsigned char* source = rows + (size_t)(topDown ? height - 1 - y : y) * rowStride;
+			unsigned char* destination = pixelBuffer + (size_t)y * rowBytes;
+			if (pixelSize == 3)
+			{
+				memcpy(destination, source, rowBytes);
+				continue;
+			}
+			for (int64_t x = 0; x < width; x++)
+			{
+				destination[x * 3 + 0] = source[x * 4 + 0];
+				destination[x * 3 + 1] = source[x * 4 + 1];
+				destination[x * 3 + 2] = source[x * 4 + 2];
+			}
+		}
+	}
+	infoHeader->biHeight = (int32_t)height;
+
+	UnmapFile(bitmapFile);
 
-	printf("loadbitmap - loaded %s w=%d h=%d bits=%d\n", filename, infoHeader->biWidth, infoHeader->biHeight, infoHeader->biBitCount);
-}
+	printf("loadbitmap - loaded %s w=%d h=%d bits=%d%s\n", filename, infoHeader->biWidth, infoHeader->biHeight, infoHeader->biBitCount,
+		topDown ? " top-down" : "");
+	return 1;
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "hash.h"
+#include "mapfile.h"
+
+// Processed assets are stored under CACHE_DIR by the XXH64 hash of the source contents, so files
+// with the same bytes under different names share one entry. A small ref file per source path
+// remembers that hash, so a file that has not changed is not read to find its entry.
+
+const char CACHE_DIR[] = "cache";
+const uint32_t CONTENT_REF_VERSION = 1;
+
+// Identity of the source file a cache entry was built from
+struct SourceStamp
+{
+	uint64_t size = 0;
+	int64_t time = 0;
+	uint64_t hash = 0;
+};
+
+/**
+ * @brief Reads the size and modification time of a file, and optionally hashes its contents.
+ *
+ * A file in the mounted archive is stamped from its entry, which recorded all three when it was packed.
+ *
+ * @return False if the file does not exist.
+ */
+bool StampSourceFile(const std::string& path, bool withHash, SourceStamp& stamp)
+{
+	const PakEntry* entry = FindPakEntry(mountedPak, path.c_str());
+	if (entry != nullptr)
+	{
+		stamp.size = entry->size;
+		stamp.time = entry->time;
+		stamp.hash = withHash ? entry->hash : 0;
+		return true;
+	}
+	std::error_code ec;
+	stamp.size = (uint64_t)std::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	stamp.time = (int64_t)std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+	if (ec)
+		return false;
+	stamp.hash = 0;
+	if (withHash)
+	{
+		MappedFile file;
+		if (!MapFile(path.c_str(), file))
+			return false;
+		stamp.hash = XXH64(file.data, file.size);
+		UnmapFile(file);
+	}
+	return true;
+}
+
+/**
+ * @brief Checks a file against a stamp taken earlier.
+ *
+ * Size and mtime matching is enough; if only the mtime differs the file is hashed and
+ * compared by content.
+ *
+ * @param restamp If given and the file matched by content, receives its current stamp. Store
+ *        it in place of stamp, or every later check hashes the file again.
+ */
+bool SourceStampMatches(const std::string& path, const SourceStamp& stamp, SourceStamp* restamp = nullptr)
+{
+	SourceStamp current;
+	if (!StampSourceFile(path, false, current) || current.size != stamp.size)
+		return false;
+	if (current.time == stamp.time)
+		return true;
+	if (!StampSourceFile(path, true, current) || current.hash != stamp.hash)
+		return false;
+	if (restamp != nullptr)
+		*restamp = current;
+	return true;
+}
+
+// On-disk ref file: the source's stamp, whose hash is the content key
+struct ContentRef
+{
+	char magic[4];
+	uint32_t version;
+	SourceStamp source;
+};
+
+// Path of the ref file of a source, named after the source path
+std::string ContentRefPath(const std::string& sourcePath)
+{
+	std::string name = sourcePath;
+	for (char& c : name)
+	{
+		if (c == '/' || c == '\\' || c == ':')
+			c = '_';
+	}
+	return std::string(CACHE_DIR) + "/" + name + ".ref";
+}
+
+// Path of a cache entry, named after the content key, e.g. "cache/0123456789abcdef.mesh"
+std::string ContentCachePath(uint64_t key, const char* extension)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.", (unsigned long long)key);
+	return std::string(CACHE_DIR) + "/" + name + extension;
+}
+
+// A temporary name next to path that no other thread writes to, for replacing path with a rename
+std::string CacheTempPath(const std::string& path)
+{
+	return path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+}
+
+
+// Replaces the ref of a source; a ref that cannot be written only costs a hash next time
+void WriteContentRef(const std::string& refPath, const SourceStamp& source)
+{
+	ContentRef ref = {};
+	memcpy(ref.magic, "CREF", 4);
+	ref.version = CONTENT_REF_VERSION;
+	ref.source = source;
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_DIR, ec);
+	std::string tempPath = CacheTempPath(refPath);
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == NULL)
+		return;
+	bool written = fwrite(&ref, sizeof(ref), 1, f) == 1;
+	written = fclose(f) == 0 && written;
+	if (written)
+		std::filesystem::rename(tempPath, refPath, ec);
+	if (!written || ec)
+		std::filesystem::remove(tempPath, ec);
+}
+
+/**
+ * @brief Finds the content key of a file: the XXH64 hash of its bytes.
+ *
+ * The hash is read from the file's ref if the file still matches the stamp there (see
+ * SourceStampMatches); otherwise the file is hashed. The ref is rewritten whenever the file
+ * was hashed, also when only its mtime changed, so a touched file is hashed once.
+ *
+ * @param sourcePath The file.
+ * @param key Receives the key.
+ * @return False if the file does not exist.
+ */
+bool ContentKeyOf(const std::string& sourcePath, uint64_t& key)
+{
+	key = 0;
+	std::string refPath = ContentRefPath(sourcePath);
+	MappedFile file;
+	if (MapFile(refPath.c_str(), file))
+	{
+		const ContentRef* ref = (const ContentRef*)file.data;
+		bool valid = file.size == sizeof(ContentRef) && memcmp(ref->magic, "CREF", 4) == 0 && ref->version == CONTENT_REF_VERSION;
+		SourceStamp stamp = valid ? ref->source : SourceStamp();
+		UnmapFile(file);
+		SourceStamp current = stamp;
+		if (valid && SourceStampMatches(sourcePath, stamp, &current))
+		{
+			key = stamp.hash;
+			if (current.time != stamp.time)
+				WriteContentRef(refPath, current);
+			return true;
+		}
+	}
+
+	SourceStamp source;
+	if (!StampSourceFile(sourcePath, true, source))
+		return false;
+	key = source.hash;
+	WriteContentRef(refPath, source);
+	return true;
+}
@@ -0,0 +1,452 @@
+#pragma once
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "json.h"
+#include "mapfile.h"
+#include "mesh.h"
+
+// accessor.componentType values
+const int GLTF_BYTE = 5120;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_FLOAT = 5126;
+
+// primitive.mode of a triangle list, the default
+const int GLTF_TRIANGLES = 4;
+
+// Largest bufferView.byteStride the glTF specification allows
+const size_t GLTF_MAX_STRIDE = 252;
+
+// An accessor resolved to a byte range of the BIN chunk
+struct GlbAccessor
+{
+	size_t offset = 0; // of the first element, from the start of the BIN chunk
+	size_t count = 0; // 0 when the primitive has no such accessor
+	size_t stride = 0; // bytes from one element to the next
+	int componentType = 0;
+	int components = 0; // 1 for SCALAR up to 4 for VEC4
+	bool normalized = false;
+	bool hasBounds = false; // from the accessor's min and max, or ComputeGlbBounds
+	glm::vec3 boundsMin = glm::vec3(0.f);
+	glm::vec3 boundsMax = glm::vec3(0.f);
+};
+
+// One triangle list of a glTF mesh
+struct GlbPrimitive
+{
+	std::string name; // of its mesh
+	int materialIndex = -1; // into GlbFile::materials
+	GlbAccessor position;
+	GlbAccessor normal;
+	GlbAccessor uv; // TEXCOORD_0
+	GlbAccessor indices; // count 0 for a non-indexed primitive
+};
+
+// A memory-mapped GLB: only the JSON chunk is parsed, the BIN chunk stays in the mapping
+struct GlbFile
+{
+	std::string path;
+	MappedFile file;
+	const char* bin = nullptr;
+	size_t binSize = 0;
+	size_t jsonSize = 0;
+	std::vector<GlbPrimitive> primitives;
+	std::vector<Material> materials;
+};
+
+size_t GltfComponentSize(int componentType)
+{
+	switch (componentType)
+	{
+	case GLTF_BYTE:
+	case GLTF_UNSIGNED_BYTE:
+		return 1;
+	case GLTF_SHORT:
+	case GLTF_UNSIGNED_SHORT:
+		return 2;
+	case GLTF_UNSIGNED_INT:
+	case GLTF_FLOAT:
+		return 4;
+	}
+	return 0;
+}
+
+// Components of an accessor.type; 0 for matrices and unknown types
+int GltfComponentCount(const std::string& type)
+{
+	if (type == "SCALAR")
+		return 1;
+	if (type == "VEC2")
+		return 2;
+	if (type == "VEC3")
+		return 3;
+	if (type == "VEC4")
+		return 4;
+	return 0;
+}
+
+/**
+ * @brief Resolves an accessor to its range of the BIN chunk, checking that the range lies inside it.
+ *
+ * @param json The glTF document.
+ * @param index The accessor index.
+ * @param binSize Size of the BIN chunk.
+ * @param out Receives the range.
+ * @return False for a missing, sparse or out-of-range accessor, or one in an external buffer.
+ */
+bool ResolveGlbAccessor(const JsonValue& json, int index, size_t binSize, GlbAccessor& out)
+{
+	const JsonValue* accessors = json.Find("accessors");
+	const JsonValue* accessor = accessors != nullptr ? accessors->At(index) : nullptr;
+	if (accessor == nullptr || accessor->Find("sparse") != nullptr)
+		return false;
+	const JsonValue* bufferViews = json.Find("bufferViews");
+	const JsonValue* view = bufferViews != nullptr ? bufferViews->At(accessor->Int("bufferView", -1)) : nullptr;
+	if (view == nullptr || view->Int("buffer", 0) != 0)
+		return false;
+
+	out.componentType = accessor->Int("componentType", 0);
+	out.components = GltfComponentCount(accessor->String("type"));
+	out.normalized = accessor->Bool("normalized", false);
+	size_t elementSize = GltfComponentSize(out.componentType) * out.components;
+	if (elementSize == 0)
+		return false;
+
+	// Sizes past the BIN chunk are rejected before any arithmetic, so none of it can wrap
+	size_t viewOffset, viewLength, offset, stride;
+	if (!accessor->Unsigned("count", binSize, out.count) || !accessor->Unsigned("byteOffset", binSize, offset)
+		|| !view->Unsigned("byteOffset", binSize, viewOffset) || !view->Unsigned("byteLength", binSize, viewLength)
+		|| !view->Unsigned("byteStride", GLTF_MAX_STRIDE, stride))
+		return false;
+	if (stride == 0)
+		stride = elementSize;
+	if (stride < elementSize || viewLength > binSize - viewOffset || offset > viewLength)
+		return false;
+	size_t available = viewLength - offset;
+	if (out.count > 0 && (elementSize > available || (available - elementSize) / stride < out.count - 1))
+		return false;
+	out.offset = viewOffset + offset;
+	out.stride = stride;
+
+	const JsonValue* min = accessor->Find("min");
+	const JsonValue* max = accessor->Find("max");
+	if (min != nullptr && max != nullptr && min->Size() >= 3 && max->Size() >= 3)
+	{
+		out.hasBounds = true;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			out.boundsMin[axis] = (float)min->items[axis].number;
+			out.boundsMax[axis] = (float)max->items[axis].number;
+		}
+	}
+	return true;
+}
+
+// Phong terms for a metallic-roughness material: rough surfaces get a weak, wide highlight
+Material ReadGltfMaterial(const JsonValue& in)
+{
+	Material material;
+	material.name = in.String("name");
+	float roughness = 1.f;
+	const JsonValue* pbr = in.Find("pbrMetallicRoughness");
+	if (pbr != nullptr)
+	{
+		const JsonValue* color = pbr->Find("baseColorFactor");
+		if (color != nullptr && color->Size() >= 3)
+			material.diffuse = glm::vec3((float)color->items[0].number, (float)color->items[1].number, (float)color->items[2].number);
+		roughness = (float)pbr->Number("roughnessFactor", 1.0);
+	}
+	const JsonValue* emissive = in.Find("emissiveFactor");
+	if (emissive != nullptr && emissive->Size() >= 3)
+		material.emissive = glm::vec3((float)emissive->items[0].number, (float)emissive->items[1].number, (float)emissive->items[2].number);
+	material.specular = glm::vec3(1.f - roughness);
+	float alpha = roughness * roughness;
+	material.shininess = alpha > 0.f ? glm::clamp(2.f / (alpha * alpha) - 2.f, 1.f, 1024.f) : 1024.f;
+	return material;
+}
+
+// Primitives of one mesh often share their vertex accessors and differ only in indices
+bool SameGlbVertices(const GlbPrimitive& a, const GlbPrimitive& b)
+{
+	return a.position.offset == b.position.offset && a.position.count == b.position.count && a.position.stride == b.position.stride
+		&& a.normal.offset == b.normal.offset && a.normal.count == b.normal.count && a.normal.stride == b.normal.stride
+		&& a.uv.offset == b.uv.offset && a.uv.count == b.uv.count && a.uv.stride == b.uv.stride && a.uv.componentType == b.uv.componentType;
+}
+
+// Element i of an accessor as floats, converting normalized integers
+void ReadGlbElement(const GlbFile& glb, const GlbAccessor& accessor, size_t i, float* out)
+{
+	const char* element = glb.bin + accessor.offset + i * accessor.stride;
+	for (int c = 0; c < accessor.components; c++)
+	{
+		switch (accessor.componentType)
+		{
+		case GLTF_FLOAT:
+			memcpy(&out[c], element + c * 4, 4);
+			break;
+		case GLTF_UNSIGNED_BYTE:
+			out[c] = ((const uint8_t*)element)[c] / 255.f;
+			break;
+		case GLTF_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, element + c * 2, 2);
+			out[c] = value / 65535.f;
+			break;
+		}
+		default:
+			out[c] = 0.f;
+		}
+	}
+}
+
+// Fills in the bounds of a position accessor that came without min and max
+void ComputeGlbBounds(const GlbFile& glb, GlbAccessor& accessor)
+{
+	for (size_t i = 0; i < accessor.count; i++)
+	{
+		float position[3];
+		ReadGlbElement(glb, accessor, i, position);
+		glm::vec3 p(position[0], position[1], position[2]);
+		accessor.boundsMin = i == 0 ? p : glm::min(accessor.boundsMin, p);
+		accessor.boundsMax = i == 0 ? p : glm::max(accessor.boundsMax, p);
+	}
+	accessor.hasBounds = true;
+}
+
+void CloseGlbFile(GlbFile& glb)
+{
+	UnmapFile(glb.file);
+	glb.bin = nullptr;
+	glb.binSize = 0;
+}
+
+/**
+ * @brief Maps a GLB file, parses its JSON chunk and resolves every triangle primitive to BIN chunk ranges.
+ *
+ * Meshes are taken in file order; node transforms are not applied, so scenes should be exported
+ * with them baked in. Primitives without float positions, and other modes than triangle lists,
+ * are skipped.
+ *
+ * @param filePath The path to the GLB file.
+ * @param glb Receives the file; it stays mapped until CloseGlbFile.
+ * @return False if the file is not a GLB 2.0 with a BIN chunk.
+ */
+bool OpenGlbFile(const std::string& filePath, GlbFile& glb)
+{
+	glb.path = filePath;
+	if (!MapFile(filePath.c_str(), glb.file))
+	{
+		printf("OpenGlbFile - could not open %s\n", filePath.c_str());
+		return false;
+	}
+	const char* data = glb.file.data;
+	size_t size = glb.file.size;
+	uint32_t header[5];
+	if (size < sizeof(header) || memcmp(data, "glTF", 4) != 0)
+	{
+		printf("OpenGlbFile - %s is not a GLB file\n", filePath.c_str());
+		CloseGlbFile(glb);
+		return false;
+	}
+	memcpy(header, data, sizeof(header));
+	const uint32_t chunkJson = 0x4E4F534A, chunkBin = 0x004E4942;
+	if (header[1] != 2 || header[2] > size || header[4] != chunkJson || 20 + (size_t)header[3] > header[2])
+	{
+		printf("OpenGlbFile - %s is not a GLB 2.0 file\n", filePath.c_str());
+		CloseGlbFile(glb);
+		return false;
+	}
+	glb.jsonSize = header[3];
+	size_t binHeader = 20 + ((glb.jsonSize + 3) & ~(size_t)3);
+	if (binHeader + 8 <= header[2])
+	{
+		uint32_t chunk[2];
+		memcpy(chunk, data + binHeader, sizeof(chunk));
+		if (chunk[1] == chunkBin && binHeader + 8 + (size_t)chunk[0] <= header[2])
+		{
+			glb.bin = data + binHeader + 8;
+			glb.binSize = chunk[0];
+		}
+	}
+
+	JsonValue json;
+	std::string error;
+	if (!ParseJson(data + 20, data + 20 + glb.jsonSize, json, &error))
+	{
+		printf("OpenGlbFile - %s: %s\n", filePath.c_str(), error.c_str());
+		CloseGlbFile(glb);
+		return false;
+	}
+	if (glb.bin == nullptr)
+	{
+		printf("OpenGlbFile - %s has no BIN chunk\n", filePath.c_str());
+		CloseGlbFile(glb);
+		return false;
+	}
+
+	glb.materials.clear();
+	const JsonValue* materials = json.Find("materials");
+	for (size_t i = 0; materials != nullptr && i < materials->Size(); i++)
+		glb.materials.push_back(ReadGltfMaterial(materials->items[i]));
+
+	glb.primitives.clear();
+	size_t skipped = 0;
+	const JsonValue* meshes = json.Find("meshes");
+	for (size_t m = 0; meshes != nullptr && m < meshes->Size(); m++)
+	{
+		const JsonValue& mesh = meshes->items[m];
+		const JsonValue* primitives = mesh.Find("primitives");
+		for (size_t p = 0; primitives != nullptr && p < primitives->Size(); p++)
+		{
+			const JsonValue& in = primitives->items[p];
+			const JsonValue* attributes = in.Find("attributes");
+			GlbPrimitive primitive;
+			primitive.name = mesh.String("name", "mesh" + std::to_string(m));
+			int material = in.Int("material", -1);
+			primitive.materialIndex = material < (int)glb.materials.size() ? material : -1;
+			bool ok = attributes != nullptr && in.Int("mode", GLTF_TRIANGLES) == GLTF_TRIANGLES
+				&& ResolveGlbAccessor(json, attributes->Int("POSITION", -1), glb.binSize, primitive.position)
+				&& primitive.position.componentType == GLTF_FLOAT && primitive.position.components == 3;
+			if (ok && attributes->Find("NORMAL") != nullptr)
+				ok = ResolveGlbAccessor(json, attributes->Int("NORMAL", -1), glb.binSize, primitive.normal)
+					&& primitive.normal.componentType == GLTF_FLOAT && primitive.normal.components == 3;
+			if (ok && attributes->Find("TEXCOORD_0") != nullptr)
+				ok = ResolveGlbAccessor(json, attributes->Int("TEXCOORD_0", -1), glb.binSize, primitive.uv) && primitive.uv.components == 2
+					&& (primitive.uv.componentType == GLTF_FLOAT || primitive.uv.normalized);
+			if (ok && in.Find("indices") != nullptr)
+				ok = ResolveGlbAccessor(json, in.Int("indices", -1), glb.binSize, primitive.indices) && primitive.indices.components == 1
+					&& (primitive.indices.componentType == GLTF_UNSIGNED_BYTE || primitive.indices.componentType == GLTF_UNSIGNED_SHORT
+						|| primitive.indices.componentType == GLTF_UNSIGNED_INT);
+			if (ok && (primitive.normal.count > primitive.position.count || primitive.uv.count > primitive.position.count))
+				ok = false;
+			if (!ok)
+			{
+				skipped++;
+				continue;
+			}
+			if (!primitive.position.hasBounds)
+				ComputeGlbBounds(glb, primitive.position);
+			glb.primitives.push_back(primitive);
+		}
+	}
+	if (skipped > 0)
+		printf("OpenGlbFile - %s: skipped %zu primitives that are not float triangle lists inside the BIN chunk\n", filePath.c_str(), skipped);
+	return true;
+}
+
+uint32_t ReadGlbIndex(const GlbFile& glb, const GlbAccessor& accessor, size_t i)
+{
+	const char* element = glb.bin + accessor.offset + i * accessor.stride;
+	if (accessor.componentType == GLTF_UNSIGNED_BYTE)
+		return *(const uint8_t*)element;
+	if (accessor.componentType == GLTF_UNSIGNED_SHORT)
+	{
+		uint16_t value;
+		memcpy(&value, element, 2);
+		return value;
+	}
+	uint32_t value;
+	memcpy(&value, element, 4);
+	return value;
+}
+
+/**
+ * @brief Reads a GLB file into an indexed mesh, one submesh per primitive.
+ *
+ * Unlike LoadGlbMesh this copies the accessors into the interleaved layout, so the mesh can go
+ * through OptimizeMesh and the mesh cache like an OBJ. Vertices shared by several primitives
+ * are copied once.
+ *
+ * @param filePath The path to the GLB file.
+ * @param mesh Receives the mesh.
+ * @return False if the file could not be read or has no triangles.
+ */
+bool ReadGlbMesh(const std::string& filePath, Mesh& mesh)
+{
+	GlbFile glb;
+	if (!OpenGlbFile(filePath, glb))
+		return false;
+
+	mesh = Mesh();
+	mesh.materials = glb.materials;
+	std::vector<unsigned int> baseVertices(glb.primitives.size());
+	for (size_t p = 0; p < glb.primitives.size(); p++)
+	{
+		const GlbPrimitive& primitive = glb.primitives[p];
+		size_t shared = 0;
+		while (shared < p && !SameGlbVertices(glb.primitives[shared], primitive))
+			shared++;
+		if (shared < p)
+		{
+			baseVertices[p] = baseVertices[shared];
+		}
+		else
+		{
+			baseVertices[p] = (unsigned int)MeshVertexCount(mesh);
+			size_t first = mesh.vertices.size();
+			if (primitive.position.count > UINT_MAX - baseVertices[p]
+				|| primitive.position.count > (mesh.vertices.max_size() - first) / MESH_VERTEX_STRIDE)
+			{
+				printf("ReadGlbMesh - %s has too many vertices\n", filePath.c_str());
+				CloseGlbFile(glb);
+				return false;
+			}
+			mesh.vertices.resize(first + primitive.position.count * MESH_VERTEX_STRIDE, 0.f);
+			float* out = mesh.vertices.data() + first;
+			for (size_t v = 0; v < primitive.position.count; v++, out += MESH_VERTEX_STRIDE)
+			{
+				ReadGlbElement(glb, primitive.position, v, out);
+				if (v < primitive.normal.count)
+					ReadGlbElement(glb, primitive.normal, v, out + 3);
+				if (v < primitive.uv.count)
+				{
+					// glTF puts the texture origin at the top left, OBJ and the BMP upload at the bottom left
+					ReadGlbElement(glb, primitive.uv, v, out + 6);
+					out[7] = 1.f - out[7];
+				}
+			}
+		}
+		unsigned int baseVertex = baseVertices[p];
+
+		SubMesh submesh;
+		submesh.name = primitive.name;
+		submesh.materialIndex = primitive.materialIndex;
+		if (submesh.materialIndex >= 0)
+			submesh.material = mesh.materials[submesh.materialIndex].name;
+		submesh.firstIndex = (unsigned int)mesh.indices.size();
+		size_t indexCount = primitive.indices.count > 0 ? primitive.indices.count : primitive.position.count;
+		indexCount -= indexCount % 3;
+		if (indexCount > UINT_MAX - mesh.indices.size())
+		{
+			printf("ReadGlbMesh - %s has too many indices\n", filePath.c_str());
+			CloseGlbFile(glb);
+			return false;
+		}
+		mesh.indices.reserve(mesh.indices.size() + indexCount);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			uint32_t index = primitive.indices.count > 0 ? ReadGlbIndex(glb, primitive.indices, i) : (uint32_t)i;
+			mesh.indices.push_back(baseVertex + (index < primitive.position.count ? index : 0));
+		}
+		submesh.indexCount = (unsigned int)indexCount;
+		mesh.submeshes.push_back(submesh);
+	}
+	CloseGlbFile(glb);
+	if (mesh.indices.empty())
+	{
+		printf("ReadGlbMesh - %s has no triangles\n", filePath.c_str());
+		return false;
+	}
+	ComputeMeshBounds(mesh);
+	printf("ReadGlbMesh - %s triangles=%zu vertices=%zu submeshes=%zu materials=%zu\n", filePath.c_str(), mesh.indices.size() / 3,
+		MeshVertexCount(mesh), mesh.submeshes.size(), mesh.materials.size());
+	return true;
+}
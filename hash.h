@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// XXH64 (https://github.com/Cyan4973/xxHash), used to fingerprint asset contents
+
+const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t XXH64Rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+uint64_t XXH64Read64(const unsigned char* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint32_t XXH64Read32(const unsigned char* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64_t XXH64Round(uint64_t acc, uint64_t input)
+{
+	acc += input * XXH_PRIME64_2;
+	acc = XXH64Rotl(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+uint64_t XXH64MergeRound(uint64_t acc, uint64_t val)
+{
+	acc ^= XXH64Round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+/**
+ * @brief Computes the 64-bit xxHash of a buffer (little-endian platforms).
+ *
+ * @param data The bytes to hash.
+ * @param size Number of bytes.
+ * @param seed Hash seed.
+ * @return The hash value.
+ */
+uint64_t XXH64(const void* data, size_t size, uint64_t seed = 0)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+	uint64_t h;
+
+	if (size >= 32)
+	{
+		uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		uint64_t v2 = seed + XXH_PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - XXH_PRIME64_1;
+		const unsigned char* limit = end - 32;
+		do
+		{
+			v1 = XXH64Round(v1, XXH64Read64(p));
+			v2 = XXH64Round(v2, XXH64Read64(p + 8));
+			v3 = XXH64Round(v3, XXH64Read64(p + 16));
+			v4 = XXH64Round(v4, XXH64Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = XXH64Rotl(v1, 1) + XXH64Rotl(v2, 7) + XXH64Rotl(v3, 12) + XXH64Rotl(v4, 18);
+		h = XXH64MergeRound(h, v1);
+		h = XXH64MergeRound(h, v2);
+		h = XXH64MergeRound(h, v3);
+		h = XXH64MergeRound(h, v4);
+	}
+	else
+	{
+		h = seed + XXH_PRIME64_5;
+	}
+
+	h += (uint64_t)size;
+
+	while (p + 8 <= end)
+	{
+		h ^= XXH64Round(0, XXH64Read64(p));
+		h = XXH64Rotl(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= end)
+	{
+		h ^= (uint64_t)XXH64Read32(p) * XXH_PRIME64_1;
+		h = XXH64Rotl(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	while (p < end)
+	{
+		h ^= (*p) * XXH_PRIME64_5;
+		h = XXH64Rotl(h, 11) * XXH_PRIME64_1;
+		p++;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
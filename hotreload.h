@@ -0,0 +1,574 @@
+#pragma once
+#include <glad/glad.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "assetloader.h"
+
+// A file counts as changed once it has been quiet this long, so a save that writes in several
+// steps reloads once, from the finished file
+const int HOT_RELOAD_SETTLE_MS = 150;
+// How often the stamps of watched files are compared where inotify is not available
+const int HOT_RELOAD_POLL_MS = 500;
+// Workers that parse and decode changed files; few, so reloading does not compete with rendering
+const unsigned int HOT_RELOAD_THREADS = 2;
+
+// Reports which of a set of files changed on disk. On Linux a background thread reads inotify
+// events of the directories holding them; elsewhere, or if inotify fails, it compares their
+// size and modification time every HOT_RELOAD_POLL_MS.
+class FileWatcher
+{
+public:
+	FileWatcher()
+	{
+#ifdef __linux__
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFd < 0)
+			printf("FileWatcher - inotify is not available, polling instead\n");
+#endif
+		thread = std::thread([this]() { WatchLoop(); });
+	}
+
+	~FileWatcher()
+	{
+		stopping = true;
+		thread.join();
+#ifdef __linux__
+		if (inotifyFd >= 0)
+			close(inotifyFd);
+#endif
+	}
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Starts watching a file on disk; adding it again does nothing
+	void Add(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!files.insert(path).second)
+			return;
+#ifdef __linux__
+		std::string directory = DirectoryOf(path);
+		if (std::find(directories.begin(), directories.end(), directory) != directories.end())
+			return;
+		// Editors that save through a temporary file replace the file, so watch the directory
+		int wd = inotifyFd >= 0 ? inotify_add_watch(inotifyFd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) : -1;
+		if (wd >= 0)
+		{
+			directories.push_back(directory);
+			watches[wd] = directory;
+			return;
+		}
+		if (inotifyFd >= 0)
+			printf("FileWatcher - could not watch %s, polling it instead\n", directory.c_str());
+#endif
+		polled[path] = DiskStamp(path);
+	}
+
+	// Files that changed and have settled since the last call
+	std::vector<std::string> TakeChanged()
+	{
+		std::vector<std::string> settled;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::lock_guard<std::mutex> lock(mutex);
+		for (std::map<std::string, std::chrono::steady_clock::time_point>::iterator it = changed.begin(); it != changed.end();)
+		{
+			if (now - it->second < std::chrono::milliseconds(HOT_RELOAD_SETTLE_MS))
+			{
+				++it;
+				continue;
+			}
+			settled.push_back(it->first);
+			it = changed.erase(it);
+		}
+		return settled;
+	}
+
+	// "inotify" or "polling"
+	const char* Method() const
+	{
+		return inotifyFd >= 0 ? "inotify" : "polling";
+	}
+
+private:
+	// Size and modification time, ignoring the mounted archive
+	struct Stamp
+	{
+		uintmax_t size = 0;
+		std::filesystem::file_time_type time;
+		bool exists = false;
+	};
+
+	static Stamp DiskStamp(const std::string& path)
+	{
+		Stamp stamp;
+		std::error_code ec;
+		stamp.size = std::filesystem::file_size(path, ec);
+		if (ec)
+			return stamp;
+		stamp.time = std::filesystem::last_write_time(path, ec);
+		stamp.exists = !ec;
+		return stamp;
+	}
+
+	void WatchLoop()
+	{
+		std::chrono::steady_clock::time_point lastPoll = std::chrono::steady_clock::now();
+		while (!stopping)
+		{
+#ifdef __linux__
+			if (inotifyFd >= 0)
+				ReadEvents();
+			else
+#endif
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			if (std::chrono::steady_clock::now() - lastPoll < std::chrono::milliseconds(HOT_RELOAD_POLL_MS))
+				continue;
+			lastPoll = std::chrono::steady_clock::now();
+			PollStamps();
+		}
+	}
+
+	void PollStamps()
+	{
+		std::vector<std::string> paths;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const std::pair<const std::string, Stamp>& file : polled)
+				paths.push_back(file.first);
+		}
+		for (const std::string& path : paths)
+		{
+			Stamp stamp = DiskStamp(path);
+			std::lock_guard<std::mutex> lock(mutex);
+			Stamp& known = polled[path];
+			if (stamp.exists && (!known.exists || stamp.size != known.size || stamp.time != known.time))
+				changed[path] = std::chrono::steady_clock::now();
+			known = stamp;
+		}
+	}
+
+#ifdef __linux__
+	void ReadEvents()
+	{
+		// Waits a little for events, so the loop notices stopping and polls on time
+		pollfd ready = { inotifyFd, POLLIN, 0 };
+		if (poll(&ready, 1, 100) <= 0)
+			return;
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+		std::lock_guard<std::mutex> lock(mutex);
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			std::map<int, std::string>::iterator watch = watches.find(event->wd);
+			if (event->len == 0 || watch == watches.end())
+				continue;
+			std::string path = watch->second + event->name;
+			if (files.count(path) != 0)
+				changed[path] = std::chrono::steady_clock::now();
+		}
+	}
+#endif
+
+	std::mutex mutex;
+	std::set<std::string> files; // watched
+	std::map<std::string, Stamp> polled; // watched by their stamps, where inotify does not cover them
+	std::map<std::string, std::chrono::steady_clock::time_point> changed; // by the time of the last change
+	std::vector<std::string> directories;
+	std::map<int, std::string> watches; // inotify watch descriptor to directory
+	int inotifyFd = -1;
+	std::atomic<bool> stopping{ false };
+	std::thread thread;
+};
+
+/**
+ * @brief Lists the other files a model's cache entry was built from, such as its MTL files.
+ *
+ * @param path The path to the model file.
+ * @return The dependencies, or nothing if the model has no valid cache entry.
+ */
+std::vector<std::string> MeshDependencies(const std::string& path)
+{
+	std::vector<std::string> dependencies;
+	uint64_t key;
+	MappedFile file;
+	MeshCacheView view;
+	if (!ContentKeyOf(path, key) || !OpenMeshCache(path, key, meshVertexFormat, file, view))
+		return dependencies;
+	for (uint32_t i = 0; i < view.header->dependencyCount; i++)
+		dependencies.push_back(MeshCacheDependencyPath(view, i, path));
+	UnmapFile(file);
+	return dependencies;
+}
+
+// Reloads the meshes and textures an AssetLoader filled when their files change on disk, while
+// the viewer keeps rendering. Changed files are parsed and decoded on a worker thread (through
+// the same caches as startup) and Update swaps the result in between frames: a mesh gets new
+// buffers, a texture is refilled under its name (or, if other files share that name, moved to a
+// name of its own along with the parts drawn with it), and a static batch is merged again, its other
+// parts read back from their cache entries rather than parsed. A model also reloads when one of
+// its MTL files changes. Files read from the mounted archive are not watched.
+class HotReloader
+{
+public:
+	HotReloader()
+		: pool(HOT_RELOAD_THREADS)
+	{
+	}
+
+	HotReloader(const HotReloader&) = delete;
+	HotReloader& operator=(const HotReloader&) = delete;
+
+	/**
+	 * @brief Starts watching the files of loaded assets.
+	 *
+	 * Call on the GL thread after AssetLoader::Finish. The targets of the assets and the texture
+	 * manager must stay alive as long as the reloader. The MTL files of the models are looked up
+	 * on the worker and watched from the next Update on.
+	 *
+	 * @param assets The assets, e.g. AssetLoader::Loaded().
+	 * @param textures The manager the textures came from, e.g. AssetLoader::Textures().
+	 */
+	void Watch(const std::vector<LoadedAsset>& assets, TextureManager& textures)
+	{
+		textureManager = &textures;
+		size_t archived = 0;
+		for (const LoadedAsset& asset : assets)
+		{
+			if (FindPakEntry(mountedPak, asset.path.c_str()) != nullptr)
+			{
+				archived++;
+				continue;
+			}
+			size_t unit = UnitOf(asset);
+			Unit& target = units[unit];
+			if (asset.mesh != nullptr)
+				target.meshes.push_back(asset.mesh);
+			if (asset.batch != nullptr)
+			{
+				target.parts.push_back(asset.path);
+				target.partTextures.push_back(asset.texturePath);
+			}
+			AddUser(asset.path, unit);
+			if (asset.texture != 0)
+				continue;
+			std::string path = asset.path;
+			Submit(unit, [path]()
+			{
+				Reloaded result;
+				result.dependencies = MeshDependencies(path);
+				return result;
+			}, false);
+		}
+		printf("HotReloader - watching %zu files with %s%s\n", users.size(), watcher.Method(),
+			archived > 0 ? ", not those in the mounted archive" : "");
+	}
+
+	/**
+	 * @brief Queues reloads of changed files and swaps in those that are ready, without waiting.
+	 *
+	 * Call on the GL thread between frames. Uploads the material table again if a reloaded model
+	 * brought new materials.
+	 *
+	 * @param program The shader program with the Materials block.
+	 * @return The number of assets swapped in.
+	 */
+	size_t Update(GLuint program)
+	{
+		for (const std::string& path : watcher.TakeChanged())
+		{
+			printf("HotReloader - %s changed\n", path.c_str());
+			for (size_t unit : users[path])
+				Reload(unit);
+		}
+
+		std::deque<Completed> ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			ready.swap(completed);
+		}
+		size_t materials = materialTable.size();
+		size_t swapped = 0;
+		for (Completed& item : ready)
+		{
+			Unit& unit = units[item.unit];
+			unit.busy = unit.busy && !item.reload;
+			for (const std::string& dependency : item.result.dependencies)
+				AddUser(dependency, item.unit);
+			if (item.result.upload)
+			{
+				auto uploadStart = std::chrono::steady_clock::now();
+				if (item.result.upload())
+				{
+					swapped++;
+					printf("HotReloader - %-36s prepare=%7.2f ms upload=%6.2f ms\n", unit.name.c_str(), item.prepareMs,
+						std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count());
+				}
+			}
+			if (unit.dirty)
+			{
+				unit.dirty = false;
+				Reload(item.unit);
+			}
+		}
+		if (materialTable.size() != materials)
+			UploadMaterialTable(program);
+		return swapped;
+	}
+
+private:
+	// What is swapped in as a whole: the meshes loaded from one file, all parts of a static
+	// batch, or the texture of one file
+	struct Unit
+	{
+		std::string name; // the file, or the first part of a batch
+		std::vector<MeshBuffer*> meshes;
+		StaticBatch* batch = nullptr;
+		std::vector<std::string> parts; // files of the batch, in the order they were added
+		std::vector<std::string> partTextures; // image of each part
+		GLuint texture = 0;
+		bool busy = false; // a job is running
+		bool dirty = false; // changed again while busy
+	};
+
+	// Output of a worker job; upload runs on the GL thread and returns false if nothing was swapped
+	struct Reloaded
+	{
+		std::vector<std::string> dependencies;
+		std::function<bool()> upload;
+	};
+
+	struct Completed
+	{
+		size_t unit = 0;
+		bool reload = false; // false for the dependency lookups of Watch
+		double prepareMs = 0.0;
+		Reloaded result;
+	};
+
+	size_t UnitOf(const LoadedAsset& asset)
+	{
+		for (size_t i = 0; i < units.size(); i++)
+		{
+			if ((asset.batch != nullptr && units[i].batch == asset.batch)
+				|| (asset.batch == nullptr && units[i].batch == nullptr && units[i].name == asset.path))
+				return i;
+		}
+		units.push_back(Unit());
+		units.back().name = asset.path;
+		units.back().batch = asset.batch;
+		units.back().texture = asset.texture;
+		return units.size() - 1;
+	}
+
+	void AddUser(const std::string& path, size_t unit)
+	{
+		std::vector<size_t>& list = users[path];
+		if (std::find(list.begin(), list.end(), unit) == list.end())
+			list.push_back(unit);
+		watcher.Add(path);
+	}
+
+	// True if a mesh other than those of the unit still draws with these GL objects
+	bool MeshInUse(const MeshBuffer& buffer, size_t except) const
+	{
+		for (size_t i = 0; i < units.size(); i++)
+		{
+			for (const MeshBuffer* mesh : units[i].meshes)
+			{
+				if (i != except && mesh->VAO == buffer.VAO)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// Points the unit of a texture, and the batch parts drawn with its image, at a new name
+	void RetargetTexture(size_t index, GLuint texture)
+	{
+		if (units[index].texture == texture)
+			return;
+		units[index].texture = texture;
+		for (Unit& unit : units)
+		{
+			for (size_t i = 0; i < unit.partTextures.size(); i++)
+			{
+				if (unit.partTextures[i] != units[index].name)
+					continue;
+				for (StaticBatchPart& part : unit.batch->parts)
+				{
+					if (part.name == unit.parts[i])
+						part.texture = texture;
+				}
+			}
+		}
+	}
+
+	void Reload(size_t index)
+	{
+		Unit& unit = units[index];
+		if (unit.busy)
+		{
+			unit.dirty = true;
+			return;
+		}
+		ThreadPool* parsePool = &pool;
+		std::string path = unit.name;
+		if (unit.texture != 0)
+		{
+			Submit(index, [this, index, path]()
+			{
+				std::shared_ptr<DecodedBitmap> bitmap = std::make_shared<DecodedBitmap>();
+				uint64_t key = 0;
+				bool keyed = ContentKeyOf(path, key);
+				PrepareTexture(path, keyed, key, *bitmap);
+				Reloaded result;
+				result.upload = [this, index, bitmap, path, keyed, key]()
+				{
+					if (bitmap->pixels == nullptr)
+					{
+						printf("HotReloader - could not decode %s, keeping the old texture\n", path.c_str());
+						return false;
+					}
+					// A name other files share keeps their image; this file moves to its own
+					TextureAcquireResult acquired;
+					GLuint texture = textureManager->Reacquire(path, keyed, key, acquired);
+					if (texture == 0)
+						return false;
+					if (acquired != TEXTURE_CONTENT_HIT)
+					{
+						fill_texture(texture, bitmap->pixels, bitmap->width, bitmap->height);
+						textureManager->SetTextureSize(texture, bitmap->width, bitmap->height);
+					}
+					RetargetTexture(index, texture);
+					return true;
+				};
+				return result;
+			});
+		}
+		else if (unit.batch != nullptr)
+		{
+			StaticBatch* batch = unit.batch;
+			std::vector<std::string> parts = unit.parts;
+			Submit(index, [parts, batch, parsePool]()
+			{
+				// Unchanged parts come straight from their cache entries
+				std::shared_ptr<std::vector<PreparedMesh>> prepared = std::make_shared<std::vector<PreparedMesh>>(parts.size());
+				Reloaded result;
+				for (size_t i = 0; i < parts.size(); i++)
+				{
+					PrepareStaticMesh(parts[i], *parsePool, (*prepared)[i]);
+					result.dependencies.insert(result.dependencies.end(), (*prepared)[i].mesh.dependencies.begin(),
+						(*prepared)[i].mesh.dependencies.end());
+				}
+				result.upload = [prepared, parts, batch]()
+				{
+					// Textures as the parts have them now, since a texture reload may have moved one
+					StaticBatch merged;
+					for (size_t i = 0; i < prepared->size(); i++)
+					{
+						if (!(*prepared)[i].valid)
+						{
+							printf("HotReloader - could not read %s, keeping the old batch\n", (*prepared)[i].path.c_str());
+							return false;
+						}
+						std::vector<StaticBatchPart>::const_iterator found = std::find_if(batch->parts.begin(), batch->parts.end(),
+							[&parts, i](const StaticBatchPart& existing) { return existing.name == parts[i]; });
+						AddStaticPart(merged, (*prepared)[i], found != batch->parts.end() ? found->texture : 0);
+					}
+					UploadStaticBatch(merged);
+					DeleteMeshBuffer(batch->buffer);
+					*batch = std::move(merged);
+					return true;
+				};
+				return result;
+			});
+		}
+		else
+		{
+			Submit(index, [this, index, path, parsePool]()
+			{
+				std::shared_ptr<PreparedMesh> prepared = std::make_shared<PreparedMesh>();
+				PrepareObjMesh(path, *parsePool, *prepared);
+				Reloaded result;
+				if (prepared->cached)
+				{
+					for (uint32_t i = 0; i < prepared->view.header->dependencyCount; i++)
+						result.dependencies.push_back(MeshCacheDependencyPath(prepared->view, i, path));
+				}
+				else
+				{
+					result.dependencies = prepared->mesh.dependencies;
+				}
+				result.upload = [this, index, prepared]()
+				{
+					if (!prepared->valid)
+					{
+						printf("HotReloader - could not read %s, keeping the old mesh\n", prepared->path.c_str());
+						return false;
+					}
+					MeshBuffer buffer = UploadPreparedMesh(*prepared);
+					std::vector<MeshBuffer*>& meshes = units[index].meshes;
+					MeshBuffer old = *meshes[0];
+					for (MeshBuffer* mesh : meshes)
+						*mesh = buffer;
+					if (!MeshInUse(old, index))
+						DeleteMeshBuffer(old);
+					return true;
+				};
+				return result;
+			});
+		}
+	}
+
+	// Runs prepare on the pool in an ArenaScope and queues its result for Update; a reload marks
+	// the unit busy until then
+	void Submit(size_t unit, std::function<Reloaded()> prepare, bool reload = true)
+	{
+		units[unit].busy = units[unit].busy || reload;
+		pool.Submit([this, unit, prepare, reload]()
+		{
+			auto prepareStart = std::chrono::steady_clock::now();
+			Completed item;
+			item.unit = unit;
+			item.reload = reload;
+			{
+				ArenaScope scope;
+				item.result = prepare();
+			}
+			item.prepareMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - prepareStart).count();
+			std::lock_guard<std::mutex> lock(mutex);
+			completed.push_back(std::move(item));
+		});
+	}
+
+	std::vector<Unit> units;
+	std::map<std::string, std::vector<size_t>> users; // watched file to the units reloaded when it changes
+	std::mutex mutex;
+	std::deque<Completed> completed;
+	FileWatcher watcher;
+	TextureManager* textureManager = nullptr;
+	ThreadPool pool; // declared last so its workers are joined before the queue is destroyed
+};
@@ -0,0 +1,357 @@
+#pragma once
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Nesting deeper than this is rejected rather than risking the stack
+const int JSON_MAX_DEPTH = 64;
+
+enum JsonType
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+};
+
+// Parsed JSON value. Arrays keep their elements in items; objects keep their member values in
+// items and the names in keys, in file order.
+struct JsonValue
+{
+	JsonType type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<std::string> keys;
+	std::vector<JsonValue> items;
+
+	// The member called key, or nullptr if this is not an object or has no such member
+	const JsonValue* Find(const char* key) const
+	{
+		if (type != JSON_OBJECT)
+			return nullptr;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (keys[i] == key)
+				return &items[i];
+		}
+		return nullptr;
+	}
+
+	// Element i of an array, or nullptr
+	const JsonValue* At(size_t i) const
+	{
+		return type == JSON_ARRAY && i < items.size() ? &items[i] : nullptr;
+	}
+
+	size_t Size() const
+	{
+		return type == JSON_ARRAY || type == JSON_OBJECT ? items.size() : 0;
+	}
+
+	double Number(const char* key, double fallback) const
+	{
+		const JsonValue* member = Find(key);
+		return member != nullptr && member->type == JSON_NUMBER ? member->number : fallback;
+	}
+
+	// A member that is a whole number in range of int, else fallback
+	int Int(const char* key, int fallback) const
+	{
+		double value = Number(key, fallback);
+		return value == floor(value) && value >= INT_MIN && value <= INT_MAX ? (int)value : fallback;
+	}
+
+	// A member that is a whole number from 0 to max; false if it is present but not one
+	bool Unsigned(const char* key, size_t max, size_t& out) const
+	{
+		double value = Number(key, 0);
+		if (!(value >= 0 && value <= (double)max && value == floor(value)))
+			return false;
+		out = (size_t)value;
+		return true;
+	}
+
+	std::string String(const char* key, const std::string& fallback = std::string()) const
+	{
+		const JsonValue* member = Find(key);
+		return member != nullptr && member->type == JSON_STRING ? member->string : fallback;
+	}
+
+	bool Bool(const char* key, bool fallback) const
+	{
+		const JsonValue* member = Find(key);
+		return member != nullptr && member->type == JSON_BOOL ? member->boolean : fallback;
+	}
+};
+
+// Position of the parser in the text, see ParseJson
+struct JsonReader
+{
+	const char* cursor;
+	const char* end;
+	const char* error = nullptr;
+};
+
+void SkipJsonSpace(JsonReader& reader)
+{
+	while (reader.cursor < reader.end
+		&& (*reader.cursor == ' ' || *reader.cursor == '\t' || *reader.cursor == '\n' || *reader.cursor == '\r'))
+		reader.cursor++;
+}
+
+bool FailJson(JsonReader& reader, const char* message)
+{
+	if (reader.error == nullptr)
+		reader.error = message;
+	return false;
+}
+
+// Appends a code point as UTF-8
+void AppendUtf8(std::string& out, unsigned int code)
+{
+	if (code < 0x80)
+	{
+		out += (char)code;
+	}
+	else if (code < 0x800)
+	{
+		out += (char)(0xC0 | (code >> 6));
+		out += (char)(0x80 | (code & 0x3F));
+	}
+	else if (code < 0x10000)
+	{
+		out += (char)(0xE0 | (code >> 12));
+		out += (char)(0x80 | ((code >> 6) & 0x3F));
+		out += (char)(0x80 | (code & 0x3F));
+	}
+	else
+	{
+		out += (char)(0xF0 | (code >> 18));
+		out += (char)(0x80 | ((code >> 12) & 0x3F));
+		out += (char)(0x80 | ((code >> 6) & 0x3F));
+		out += (char)(0x80 | (code & 0x3F));
+	}
+}
+
+bool ReadJsonHex4(JsonReader& reader, unsigned int& code)
+{
+	if (reader.end - reader.cursor < 4)
+		return FailJson(reader, "truncated \\u escape");
+	code = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		char c = *reader.cursor++;
+		int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+		if (digit < 0)
+			return FailJson(reader, "bad \\u escape");
+		code = code * 16 + digit;
+	}
+	return true;
+}
+
+// Reads a string whose opening quote is at the cursor
+bool ReadJsonString(JsonReader& reader, std::string& out)
+{
+	reader.cursor++;
+	out.clear();
+	while (reader.cursor < reader.end)
+	{
+		const char* run = reader.cursor;
+		while (reader.cursor < reader.end && *reader.cursor != '"' && *reader.cursor != '\\')
+			reader.cursor++;
+		out.append(run, reader.cursor - run);
+		if (reader.cursor == reader.end)
+			break;
+		if (*reader.cursor++ == '"')
+			return true;
+
+		if (reader.cursor == reader.end)
+			break;
+		char escape = *reader.cursor++;
+		switch (escape)
+		{
+		case '"': out += '"'; break;
+		case '\\': out += '\\'; break;
+		case '/': out += '/'; break;
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u':
+		{
+			unsigned int code;
+			if (!ReadJsonHex4(reader, code))
+				return false;
+			if (code >= 0xD800 && code < 0xDC00 && reader.end - reader.cursor >= 6 && reader.cursor[0] == '\\' && reader.cursor[1] == 'u')
+			{
+				reader.cursor += 2;
+				unsigned int low;
+				if (!ReadJsonHex4(reader, low))
+					return false;
+				if (low >= 0xDC00 && low < 0xE000)
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			}
+			AppendUtf8(out, code);
+			break;
+		}
+		default:
+			return FailJson(reader, "bad escape");
+		}
+	}
+	return FailJson(reader, "unterminated string");
+}
+
+bool ReadJsonNumber(JsonReader& reader, double& number)
+{
+	// strtod needs a terminated copy; the text need not be NUL-terminated
+	char buffer[64];
+	size_t length = 0;
+	while (reader.cursor + length < reader.end && length + 1 < sizeof(buffer)
+		&& strchr("+-0123456789.eE", reader.cursor[length]) != nullptr && reader.cursor[length] != '\0')
+		length++;
+	memcpy(buffer, reader.cursor, length);
+	buffer[length] = '\0';
+	char* parsed = buffer;
+	number = strtod(buffer, &parsed);
+	if (parsed == buffer)
+		return FailJson(reader, "bad number");
+	reader.cursor += parsed - buffer;
+	return true;
+}
+
+bool ReadJsonLiteral(JsonReader& reader, const char* literal)
+{
+	size_t length = strlen(literal);
+	if ((size_t)(reader.end - reader.cursor) < length || memcmp(reader.cursor, literal, length) != 0)
+		return FailJson(reader, "unexpected character");
+	reader.cursor += length;
+	return true;
+}
+
+bool ReadJsonValue(JsonReader& reader, JsonValue& value, int depth)
+{
+	SkipJsonSpace(reader);
+	if (reader.cursor == reader.end)
+		return FailJson(reader, "unexpected end");
+	if (depth > JSON_MAX_DEPTH)
+		return FailJson(reader, "nested too deep");
+
+	char c = *reader.cursor;
+	if (c == '{' || c == '[')
+	{
+		bool object = c == '{';
+		char close = object ? '}' : ']';
+		value.type = object ? JSON_OBJECT : JSON_ARRAY;
+		reader.cursor++;
+		SkipJsonSpace(reader);
+		if (reader.cursor < reader.end && *reader.cursor == close)
+		{
+			reader.cursor++;
+			return true;
+		}
+		for (;;)
+		{
+			SkipJsonSpace(reader);
+			if (object)
+			{
+				if (reader.cursor == reader.end || *reader.cursor != '"')
+					return FailJson(reader, "expected a member name");
+				value.keys.emplace_back();
+				if (!ReadJsonString(reader, value.keys.back()))
+					return false;
+				SkipJsonSpace(reader);
+				if (reader.cursor == reader.end || *reader.cursor++ != ':')
+					return FailJson(reader, "expected ':'");
+			}
+			value.items.emplace_back();
+			if (!ReadJsonValue(reader, value.items.back(), depth + 1))
+				return false;
+			SkipJsonSpace(reader);
+			if (reader.cursor == reader.end)
+				return FailJson(reader, "unexpected end");
+			char next = *reader.cursor++;
+			if (next == close)
+				return true;
+			if (next != ',')
+				return FailJson(reader, object ? "expected ',' or '}'" : "expected ',' or ']'");
+		}
+	}
+	if (c == '"')
+	{
+		value.type = JSON_STRING;
+		return ReadJsonString(reader, value.string);
+	}
+	if (c == 't' || c == 'f')
+	{
+		value.type = JSON_BOOL;
+		value.boolean = c == 't';
+		return ReadJsonLiteral(reader, value.boolean ? "true" : "false");
+	}
+	if (c == 'n')
+	{
+		value.type = JSON_NULL;
+		return ReadJsonLiteral(reader, "null");
+	}
+	value.type = JSON_NUMBER;
+	return ReadJsonNumber(reader, value.number);
+}
+
+/**
+ * @brief Parses a JSON document held in memory.
+ *
+ * The text need not be NUL-terminated; anything but whitespace after the value is an error.
+ *
+ * @param begin Start of the text.
+ * @param end End of the text.
+ * @param value Receives the document.
+ * @param error Receives a description of the first problem; may be nullptr.
+ * @return False if the text is not valid JSON.
+ */
+bool ParseJson(const char* begin, const char* end, JsonValue& value, std::string* error = nullptr)
+{
+	JsonReader reader = { begin, end };
+	value = JsonValue();
+	bool ok = ReadJsonValue(reader, value, 0);
+	if (ok)
+	{
+		SkipJsonSpace(reader);
+		if (reader.cursor != reader.end)
+			ok = FailJson(reader, "text after the value");
+	}
+	if (!ok && error != nullptr)
+		*error = std::string(reader.error) + " at offset " + std::to_string(reader.cursor - begin);
+	return ok;
+}
+
+// Quotes text as a JSON string
+std::string JsonEscape(const std::string& text)
+{
+	std::string out = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)c);
+			out += escape;
+		}
+		else
+		{
+			out += c;
+		}
+	}
+	return out + "\"";
+}
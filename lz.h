@@ -0,0 +1,186 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#include "arena.h"
+
+// LZ77 block codec in the LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md):
+// a sequence is a token byte (literal length << 4 | match length - 4), extra length bytes, the
+// literals, a 16-bit little-endian offset and extra match length bytes. Fast to decode, which is
+// what archive reads need; the compressor is the greedy single-probe one.
+
+const size_t LZ_MIN_MATCH = 4;
+const size_t LZ_LAST_LITERALS = 5; // the block ends with at least this many literals
+const size_t LZ_MATCH_LIMIT = 12; // no match starts closer than this to the end
+const size_t LZ_MAX_OFFSET = 65535;
+const int LZ_HASH_BITS = 14;
+
+// Size of a destination buffer that any input of size bytes compresses into
+size_t LzCompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+uint32_t LzHash(const unsigned char* p)
+{
+	uint32_t sequence;
+	memcpy(&sequence, p, sizeof(sequence));
+	return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Writes the bytes of a length beyond the 15 that fit in the token
+unsigned char* WriteLzLength(unsigned char* out, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*out++ = 255;
+	*out++ = (unsigned char)length;
+	return out;
+}
+
+unsigned char* WriteLzSequence(unsigned char* out, const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength)
+{
+	unsigned char* token = out++;
+	*token = (unsigned char)((literalCount >= 15 ? 15 : literalCount) << 4);
+	if (literalCount >= 15)
+		out = WriteLzLength(out, literalCount - 15);
+	memcpy(out, literals, literalCount);
+	out += literalCount;
+	if (matchLength == 0)
+		return out;
+	*out++ = (unsigned char)offset;
+	*out++ = (unsigned char)(offset >> 8);
+	size_t extra = matchLength - LZ_MIN_MATCH;
+	*token |= (unsigned char)(extra >= 15 ? 15 : extra);
+	if (extra >= 15)
+		out = WriteLzLength(out, extra - 15);
+	return out;
+}
+
+/**
+ * @brief Compresses a buffer into one LZ block.
+ *
+ * @param source The bytes to compress.
+ * @param size Number of bytes.
+ * @param destination Receives the block.
+ * @param capacity Size of destination; at least LzCompressBound(size).
+ * @return The size of the block, or 0 if capacity is too small.
+ */
+size_t LzCompress(const void* source, size_t size, void* destination, size_t capacity)
+{
+	if (capacity < LzCompressBound(size))
+		return 0;
+	const unsigned char* in = (const unsigned char*)source;
+	unsigned char* out = (unsigned char*)destination;
+	const unsigned char* literals = in;
+	if (size > LZ_MATCH_LIMIT)
+	{
+		ArenaScope scope;
+		ArenaVector<uint32_t> table((size_t)1 << LZ_HASH_BITS, 0);
+		const unsigned char* limit = in + size - LZ_MATCH_LIMIT;
+		const unsigned char* matchEnd = in + size - LZ_LAST_LITERALS;
+		const unsigned char* p = in + 1;
+		table[LzHash(in)] = 0;
+		while (p < limit)
+		{
+			uint32_t& slot = table[LzHash(p)];
+			const unsigned char* candidate = in + slot;
+			slot = (uint32_t)(p - in);
+			if (candidate >= p || (size_t)(p - candidate) > LZ_MAX_OFFSET || memcmp(candidate, p, LZ_MIN_MATCH) != 0)
+			{
+				p++;
+				continue;
+			}
+
+			// Extend backwards over pending literals, then forwards
+			while (p > literals && candidate > in && p[-1] == candidate[-1])
+			{
+				p--;
+				candidate--;
+			}
+			const unsigned char* end = p + LZ_MIN_MATCH;
+			const unsigned char* from = candidate + LZ_MIN_MATCH;
+			while (end < matchEnd && *end == *from)
+			{
+				end++;
+				from++;
+			}
+			out = WriteLzSequence(out, literals, p - literals, p - candidate, end - p);
+			for (const unsigned char* q = p + 1; q < end && q < limit; q += 2)
+				table[LzHash(q)] = (uint32_t)(q - in);
+			p = literals = end;
+		}
+	}
+	out = WriteLzSequence(out, literals, in + size - literals, 0, 0);
+	return out - (unsigned char*)destination;
+}
+
+/**
+ * @brief Decompresses one LZ block, checking every length and offset against the buffers.
+ *
+ * @param source The block.
+ * @param size Size of the block.
+ * @param destination Receives the original bytes.
+ * @param originalSize The exact size the block decompresses to.
+ * @return False if the block is corrupt or does not decompress to originalSize bytes.
+ */
+bool LzDecompress(const void* source, size_t size, void* destination, size_t originalSize)
+{
+	const unsigned char* in = (const unsigned char*)source;
+	const unsigned char* inEnd = in + size;
+	unsigned char* out = (unsigned char*)destination;
+	unsigned char* outEnd = out + originalSize;
+	while (in < inEnd)
+	{
+		unsigned int token = *in++;
+		size_t literalCount = token >> 4;
+		if (literalCount == 15)
+		{
+			unsigned char extra;
+			do
+			{
+				if (in == inEnd)
+					return false;
+				extra = *in++;
+				literalCount += extra;
+			} while (extra == 255);
+		}
+		if ((size_t)(inEnd - in) < literalCount || (size_t)(outEnd - out) < literalCount)
+			return false;
+		memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return false;
+		size_t offset = in[0] | (size_t)in[1] << 8;
+		in += 2;
+		size_t matchLength = (token & 15) + LZ_MIN_MATCH;
+		if ((token & 15) == 15)
+		{
+			unsigned char extra;
+			do
+			{
+				if (in == inEnd)
+					return false;
+				extra = *in++;
+				matchLength += extra;
+			} while (extra == 255);
+		}
+		if (offset == 0 || offset > (size_t)(out - (unsigned char*)destination) || (size_t)(outEnd - out) < matchLength)
+			return false;
+		// A match may overlap the bytes it produces, repeating the last offset bytes; copying from
+		// the start of the match in chunks that double keeps every memcpy free of overlap
+		const unsigned char* from = out - offset;
+		unsigned char* matchEnd = out + matchLength;
+		while (out < matchEnd)
+		{
+			size_t chunk = std::min((size_t)(out - from), (size_t)(matchEnd - out));
+			memcpy(out, from, chunk);
+			out += chunk;
+		}
+	}
+	return out == outEnd;
+}
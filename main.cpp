@@ -6,15 +6,19 @@
 
 #include <iostream>
 #include <vector>
-#include <sstream>
 #include <string>
-#include <fstream>
 
 #include "window.h"
 #include "texture.h"
 #include "camera.h"
 #include "ModelViewerCamera.h"
 #include "shader.h"
+#include "objloader.h"
+#include "threadpool.h"
+#include "meshbuffer.h"
+#include "assetloader.h"
+#include "staticbatch.h"
+#include "hotreload.h"
 
 // Button Control
 bool LRefresh = true;
@@ -55,150 +59,37 @@ glm::vec3 SunColour = glm::vec3(0.5f, 0.f, 0.f);
 
 SCamera Camera;
 
-// Control Box Model Vector
-std::vector<float> CBoxVector;
-std::vector<float> CBoxSign;
-std::vector<float> CBoxBlue;
-std::vector<float> CBoxBlack;
-std::vector<float> CBoxRed;
-std::vector<float> CBoxGreen;
-std::vector<float> CBoxFace;
+// Parts that never move or change texture: the control box body, the heater body and the blower
+// body, merged into one vertex and index buffer
+StaticBatch staticWorld;
 
-// Heater Model Vector
-std::vector<float> heaterVector;
-std::vector<float> heaterTrailer;
-std::vector<float> heaterBase;
-std::vector<float> heaterEdge;
-std::vector<float> heaterHandle;
-std::vector<float> heaterDoor;
+// Control Box Model Buffers
+MeshBuffer CBoxBlue;
+MeshBuffer CBoxRed;
+MeshBuffer CBoxGreen;
 
-// Pipe Model Vector
-std::vector<float> Pipe;
-std::vector<float> PipeAirOut;
-std::vector<float> PipeNail;
+// Heater Model Buffers
+MeshBuffer heaterHandle;
+MeshBuffer heaterDoor;
 
-// Pump Model Vector
-std::vector<float> pumpVector;
-std::vector<float> pumpBase;
-std::vector<float> pumpOutAir;
+// Pipe Model Buffers
+MeshBuffer Pipe;
+MeshBuffer PipeAirOut;
+MeshBuffer PipeNail;
 
-// Car Model Vector
-std::vector<float> CarTerrface;
-std::vector<float> CarVector;
-std::vector<float> CarWheel;
+// Pump Model Buffers
+MeshBuffer pumpVector;
+MeshBuffer pumpBase;
+MeshBuffer pumpOutAir;
 
-// Blower Model Vector
-std::vector<float> BlowerVector;
-std::vector<float> BlowerBase;
-std::vector<float> BlowerFan;
+// Car Model Buffers
+MeshBuffer CarTerrface;
+MeshBuffer CarVector;
+MeshBuffer CarWheel;
 
-/**
- * @brief Reads an OBJ file and extracts vertex, normal, and UV data.
- *
- * @param filePath The path to the OBJ file.
- * @return A vector containing the vertex data (interleaved with color, normal, and UV).
- */
-std::vector<float> ReadObjFile(const std::string& filePath) 
-{
-	// Open the OBJ file
-	std::ifstream objFile(filePath);
-	// Vector to store the final vertex data
-	std::vector<float> vertices;
-	std::string line;
-
-	// Separate vectors to store indices for vertices, UVs, and normals
-	std::vector<int> vertexIndices, uvIndices, normalIndices;
-	std::vector<glm::vec3> temp_vertices; // Temporary storage for vertices
-	std::vector<glm::vec2> temp_uvs; // Temporary storage for UVs
-	std::vector<glm::vec3> temp_normals; // Temporary storage for normals
-
-	// Check if the file is open
-	if (!objFile.is_open()) {
-		std::cerr << "Failed to open file: " << filePath << std::endl;
-		return vertices; // Return an empty vector if the file cannot be opened
-	}
-	// Read each line of the OBJ file
-	while (getline(objFile, line)) 
-	{
-		std::istringstream iss(line);
-		std::string lineHeader;
-		iss >> lineHeader;
-		// Process vertex data
-		if (lineHeader == "v") 
-		{
+// Blower Model Buffers
+MeshBuffer BlowerFan;
 
-			glm::vec3 vertex;
-			if (iss >> vertex.x >> vertex.y >> vertex.z) 
-			{
-				temp_vertices.push_back(vertex);
-			}
-		}
-		// Process UV data
-		else if (lineHeader == "vt") 
-		{ 
-			glm::vec2 uv;
-			if (iss >> uv.x >> uv.y) 
-			{
-				temp_uvs.push_back(uv);
-			}
-		}
-		// Process normal data
-		else if (lineHeader == "vn") 
-		{
-			glm::vec3 normal;
-			if (iss >> normal.x >> normal.y >> normal.z) 
-			{
-				temp_normals.push_back(normal);
-			}
-		}
-		// Process face data
-		else if (lineHeader == "f") 
-		{
-			unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-			char slash;
-			for (int i = 0; i < 3; i++) 
-			{
-				iss >> vertexIndex[i] >> slash >> uvIndex[i] >> slash >> normalIndex[i];
-				vertexIndices.push_back(vertexIndex[i]);
-				uvIndices.push_back(uvIndex[i]);
-				normalIndices.push_back(normalIndex[i]);
-			}
-		}
-	}
-	// Set a default color
-	glm::vec3 defaultColor(1.0f, 1.0f, 1.0f);
-	// Process the indices to construct the final vertex data
-	for (size_t i = 0; i < vertexIndices.size(); i++) 
-	{
-		unsigned int vertexIndex = vertexIndices[i];
-		unsigned int uvIndex = uvIndices[i];
-		unsigned int normalIndex = normalIndices[i];
-
-		// Get the vertex, uv, and normal data using the indices
-		glm::vec3 vertex = temp_vertices[vertexIndex - 1];
-		glm::vec2 uv = temp_uvs[uvIndex - 1];
-		glm::vec3 normal = temp_normals[normalIndex - 1];
-
-		// Add vertex data to the vertices vector
-		vertices.push_back(vertex.x);
-		vertices.push_back(vertex.y);
-		vertices.push_back(vertex.z);
-
-		// Add color data
-		vertices.push_back(defaultColor.x);
-		vertices.push_back(defaultColor.y);
-		vertices.push_back(defaultColor.z);
-
-		// Add normal data
-		vertices.push_back(normal.x);
-		vertices.push_back(normal.y);
-		vertices.push_back(normal.z);
-
-		vertices.push_back(uv.x);
-		vertices.push_back(uv.y);
-	}
-	return vertices; // Return the final vector containing vertex data
-}
 /**
  * @brief Processes keyboard input to control camera movement and other actions.
  *
@@ -412,6 +303,8 @@ int main(int argc, char** argv)
 	GLFWwindow* window = CreateGLFWWindow(1920, 1080, "20320552");
 	// Load OpenGL function pointers
 	gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	// Read shaders, models and textures from one archive when tools/pak_packer has built it
+	MountPak("resources.pak");
 	// Load shader program
 	unsigned int shaderProgram = LoadShader("phong.vert", "phong.frag");
 	// Initialize camera
@@ -421,399 +314,82 @@ int main(int argc, char** argv)
 	lightDirection = Camera.Front;
 	lightPos = Camera.Position;
 
-	// Control Box Model
-	CBoxVector = ReadObjFile("resources/Box.obj");
-	CBoxSign = ReadObjFile("resources/BoxSign.obj");
-	CBoxBlue = ReadObjFile("resources/BoxBlue.obj");
-	CBoxBlack = ReadObjFile("resources/BoxBlack.obj");
-	CBoxRed = ReadObjFile("resources/BoxRed.obj");
-	CBoxGreen = ReadObjFile("resources/BoxGreen.obj");
-	CBoxFace = ReadObjFile("resources/BoxFace.obj");
+	// Parse and decode every asset on worker threads; "objLoaderShuttle <threads>" overrides the thread count
+	AssetLoader loader(argc > 1 ? (unsigned int)atoi(argv[1]) : 0);
+
 	// Control Box Texture
-	GLuint CBoxtexture = setup_texture("resources/bmp/Box.bmp");
-	GLuint CBoxSigntexture = setup_texture("resources/bmp/Pump.bmp");
-	GLuint CBoxBluetexture = setup_texture("resources/bmp/BoxBlue.bmp");
-	GLuint CBoxBlacktexture = setup_texture("resources/bmp/Black.bmp");
-	GLuint CBoxRedtexture = setup_texture("resources/bmp/Red.bmp");
-	GLuint CBoxGreentexture = setup_texture("resources/bmp/Green.bmp");
-	GLuint CBoxFacetexture = setup_texture("resources/bmp/BoxFace.bmp");
+	const GLuint& CBoxBluetexture = loader.LoadTexture("resources/bmp/BoxBlue.bmp");
+	const GLuint& CBoxBlacktexture = loader.LoadTexture("resources/bmp/Black.bmp");
+	const GLuint& CBoxRedtexture = loader.LoadTexture("resources/bmp/Red.bmp");
+	const GLuint& CBoxGreentexture = loader.LoadTexture("resources/bmp/Green.bmp");
+	// Control Box Model
+	loader.LoadStaticMesh("resources/Box.obj", staticWorld, "resources/bmp/Box.bmp");
+	loader.LoadStaticMesh("resources/BoxSign.obj", staticWorld, "resources/bmp/Pump.bmp");
+	loader.LoadMesh("resources/BoxBlue.obj", CBoxBlue);
+	loader.LoadStaticMesh("resources/BoxBlack.obj", staticWorld, "resources/bmp/Black.bmp");
+	loader.LoadMesh("resources/BoxRed.obj", CBoxRed);
+	loader.LoadMesh("resources/BoxGreen.obj", CBoxGreen);
+	loader.LoadStaticMesh("resources/BoxFace.obj", staticWorld, "resources/bmp/BoxFace.bmp");
 
-	// Heater Model
-	heaterVector = ReadObjFile("resources/Heater.obj");
-	heaterTrailer = ReadObjFile("resources/HeaterTrailer.obj");
-	heaterBase = ReadObjFile("resources/HeaterBase.obj");
-	heaterEdge = ReadObjFile("resources/HeaterEdge.obj");
-	heaterHandle = ReadObjFile("resources/HeaterHandle.obj");
-	heaterDoor = ReadObjFile("resources/HeaterDoor.obj");
 	// Heater Texture
-	GLuint heaterTexture = setup_texture("resources/bmp/Pump.bmp");
-	GLuint heaterTrailerTexture = setup_texture("resources/bmp/BlowerBase.bmp");
-	GLuint heaterBaseTexture = setup_texture("resources/bmp/HeaterBase.bmp");
-	GLuint heaterEdgeTexture = setup_texture("resources/bmp/Edge.bmp");
-	GLuint heaterHandleTexture = setup_texture("resources/bmp/Blower.bmp");
-	GLuint heaterDoorTexture = setup_texture("resources/bmp/Box.bmp");
+	const GLuint& heaterHandleTexture = loader.LoadTexture("resources/bmp/Blower.bmp");
+	const GLuint& heaterDoorTexture = loader.LoadTexture("resources/bmp/Box.bmp");
+	// Heater Model
+	loader.LoadStaticMesh("resources/Heater.obj", staticWorld, "resources/bmp/Pump.bmp");
+	loader.LoadStaticMesh("resources/HeaterTrailer.obj", staticWorld, "resources/bmp/BlowerBase.bmp");
+	loader.LoadStaticMesh("resources/HeaterBase.obj", staticWorld, "resources/bmp/HeaterBase.bmp");
+	loader.LoadStaticMesh("resources/HeaterEdge.obj", staticWorld, "resources/bmp/Edge.bmp");
+	loader.LoadMesh("resources/HeaterHandle.obj", heaterHandle);
+	loader.LoadMesh("resources/HeaterDoor.obj", heaterDoor);
 
 	// Pipe Model
-	Pipe = ReadObjFile("resources/Pipe.obj");
-	PipeAirOut = ReadObjFile("resources/PipeAirOut.obj");
-	PipeNail = ReadObjFile("resources/PipeNail.obj");
+	loader.LoadMesh("resources/Pipe.obj", Pipe);
+	loader.LoadMesh("resources/PipeAirOut.obj", PipeAirOut);
+	loader.LoadMesh("resources/PipeNail.obj", PipeNail);
 	// Pipe Texture
-	GLuint PipeTexture = setup_texture("resources/bmp/Pipe.bmp");
-	GLuint PipeAirOutTexture = setup_texture("resources/bmp/White.bmp");
-	GLuint PipeNailTexture = setup_texture("resources/bmp/Black.bmp");
+	const GLuint& PipeTexture = loader.LoadTexture("resources/bmp/Pipe.bmp");
+	const GLuint& PipeAirOutTexture = loader.LoadTexture("resources/bmp/White.bmp");
+	const GLuint& PipeNailTexture = loader.LoadTexture("resources/bmp/Black.bmp");
 
 	// Pump Model
-	pumpVector = ReadObjFile("resources/pump.obj");
-	pumpBase = ReadObjFile("resources/pumpBase.obj");
-	pumpOutAir = ReadObjFile("resources/pumpOutAir.obj");
+	loader.LoadMesh("resources/pump.obj", pumpVector);
+	loader.LoadMesh("resources/pumpBase.obj", pumpBase);
+	loader.LoadMesh("resources/pumpOutAir.obj", pumpOutAir);
 	// Pump Texture
-	GLuint pumpTexture = setup_texture("resources/bmp/Pump.bmp");
-	GLuint pumpBaseTexture = setup_texture("resources/bmp/Black.bmp");
-	GLuint pumpOutAirTexture = setup_texture("resources/bmp/White.bmp");
+	const GLuint& pumpTexture = loader.LoadTexture("resources/bmp/Pump.bmp");
+	const GLuint& pumpBaseTexture = loader.LoadTexture("resources/bmp/Black.bmp");
+	const GLuint& pumpOutAirTexture = loader.LoadTexture("resources/bmp/White.bmp");
 
 	// Car Model
-	CarTerrface = ReadObjFile("resources/CarTerrface.obj");
-	CarVector = ReadObjFile("resources/Car.obj");
-	CarWheel = ReadObjFile("resources/CarWheel.obj");
+	loader.LoadMesh("resources/CarTerrface.obj", CarTerrface);
+	loader.LoadMesh("resources/Car.obj", CarVector);
+	loader.LoadMesh("resources/CarWheel.obj", CarWheel);
 	// Car Texture
-	GLuint CarTerrfaceTexture = setup_texture("resources/bmp/CarTerrface.bmp");
-	GLuint CarTexture = setup_texture("resources/bmp/CarBase.bmp");
-	GLuint CarWheelTexture = setup_texture("resources/bmp/Wheel.bmp");
+	const GLuint& CarTerrfaceTexture = loader.LoadTexture("resources/bmp/CarTerrface.bmp");
+	const GLuint& CarTexture = loader.LoadTexture("resources/bmp/CarBase.bmp");
+	const GLuint& CarWheelTexture = loader.LoadTexture("resources/bmp/Wheel.bmp");
 
-	// Blower Model
-	BlowerVector = ReadObjFile("resources/Blower.obj");
-	BlowerBase = ReadObjFile("resources/BlowerBase.obj");
-	BlowerFan = ReadObjFile("resources/BlowerFan.obj");
 	// Blower Texture
-	GLuint BlowerTexture = setup_texture("resources/bmp/Blower.bmp");
-	GLuint BlowerBaseTexture = setup_texture("resources/bmp/BlowerBase.bmp");
-	GLuint BlowerFanTexture = setup_texture("resources/bmp/Wheel.bmp");
-
-	// Generate Vertex Array Objects and Vertex Buffer Objects
-	GLuint VAOs[25], VBOs[25];
-	glGenVertexArrays(25, VAOs);
-	glGenBuffers(25, VBOs);
-
-	// Setup pump model
-	// pump Part
-	glBindVertexArray(VAOs[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-	glBufferData(GL_ARRAY_BUFFER, pumpVector.size() * sizeof(float), pumpVector.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// pump Base Part
-	glBindVertexArray(VAOs[1]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-	glBufferData(GL_ARRAY_BUFFER, pumpBase.size() * sizeof(float), pumpBase.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// pump OutAir Part
-	glBindVertexArray(VAOs[2]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[2]);
-	glBufferData(GL_ARRAY_BUFFER, pumpOutAir.size() * sizeof(float), pumpOutAir.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-
-	// Setup heater model
-	// heater Part
-	glBindVertexArray(VAOs[3]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[3]);
-	glBufferData(GL_ARRAY_BUFFER, heaterVector.size() * sizeof(float), heaterVector.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// heater Trailer Part
-	glBindVertexArray(VAOs[4]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[4]);
-	glBufferData(GL_ARRAY_BUFFER, heaterTrailer.size() * sizeof(float), heaterTrailer.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// heater Base Part
-	glBindVertexArray(VAOs[5]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[5]);
-	glBufferData(GL_ARRAY_BUFFER, heaterBase.size() * sizeof(float), heaterBase.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// heater Edge Part
-	glBindVertexArray(VAOs[6]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[6]);
-	glBufferData(GL_ARRAY_BUFFER, heaterEdge.size() * sizeof(float), heaterEdge.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// heater Handle Part
-	glBindVertexArray(VAOs[7]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[7]);
-	glBufferData(GL_ARRAY_BUFFER, heaterHandle.size() * sizeof(float), heaterHandle.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// heater Door Part
-	glBindVertexArray(VAOs[8]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[8]);
-	glBufferData(GL_ARRAY_BUFFER, heaterDoor.size() * sizeof(float), heaterDoor.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-
-	// Setup Blower model
-	// Blower Part
-	glBindVertexArray(VAOs[9]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[9]);
-	glBufferData(GL_ARRAY_BUFFER, BlowerVector.size() * sizeof(float), BlowerVector.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	//Blower Base Part
-	glBindVertexArray(VAOs[10]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[10]);
-	glBufferData(GL_ARRAY_BUFFER, BlowerBase.size() * sizeof(float), BlowerBase.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	//Blower Fan Part
-	glBindVertexArray(VAOs[24]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[24]);
-	glBufferData(GL_ARRAY_BUFFER, BlowerFan.size() * sizeof(float), BlowerFan.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-
-	// Setup Car model
-	// CarBase Part
-	glBindVertexArray(VAOs[11]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[11]);
-	glBufferData(GL_ARRAY_BUFFER, CarVector.size() * sizeof(float), CarVector.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Car Terrface Part
-	glBindVertexArray(VAOs[12]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[12]);
-	glBufferData(GL_ARRAY_BUFFER, CarTerrface.size() * sizeof(float), CarTerrface.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Car Wheel Part
-	glBindVertexArray(VAOs[13]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[13]);
-	glBufferData(GL_ARRAY_BUFFER, CarWheel.size() * sizeof(float), CarWheel.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-
-	// Setup Control Box model
-	// Box Part
-	glBindVertexArray(VAOs[14]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[14]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxVector.size() * sizeof(float), CBoxVector.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Box Sign Part
-	glBindVertexArray(VAOs[15]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[15]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxSign.size() * sizeof(float), CBoxSign.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Box Blue Part
-	glBindVertexArray(VAOs[16]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[16]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxBlue.size() * sizeof(float), CBoxBlue.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Box Black Part
-	glBindVertexArray(VAOs[17]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[17]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxBlack.size() * sizeof(float), CBoxBlack.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Box Red Part
-	glBindVertexArray(VAOs[18]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[18]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxRed.size() * sizeof(float), CBoxRed.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Box Green Part
-	glBindVertexArray(VAOs[19]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[19]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxGreen.size() * sizeof(float), CBoxGreen.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Box Face Part
-	glBindVertexArray(VAOs[20]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[20]);
-	glBufferData(GL_ARRAY_BUFFER, CBoxFace.size() * sizeof(float), CBoxFace.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-
+	const GLuint& BlowerFanTexture = loader.LoadTexture("resources/bmp/Wheel.bmp");
+	// Blower Model
+	loader.LoadStaticMesh("resources/Blower.obj", staticWorld, "resources/bmp/Blower.bmp");
+	loader.LoadStaticMesh("resources/BlowerBase.obj", staticWorld, "resources/bmp/BlowerBase.bmp");
+	loader.LoadMesh("resources/BlowerFan.obj", BlowerFan);
 
-	// Setup Pipe model
-	// Pipe Part
-	glBindVertexArray(VAOs[21]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[21]);
-	glBufferData(GL_ARRAY_BUFFER, Pipe.size() * sizeof(float), Pipe.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Pipe AirOut Part
-	glBindVertexArray(VAOs[22]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[22]);
-	glBufferData(GL_ARRAY_BUFFER, PipeAirOut.size() * sizeof(float), PipeAirOut.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
-	// Pipe Nail Part
-	glBindVertexArray(VAOs[23]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOs[23]);
-	glBufferData(GL_ARRAY_BUFFER, PipeNail.size() * sizeof(float), PipeNail.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-	glEnableVertexAttribArray(3);
+	// Upload the assets as they finish loading, then the merged static parts
+	loader.Finish();
+	UploadStaticBatch(staticWorld);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	
 	// Enable depth testing
 	glEnable(GL_DEPTH_TEST);
 	// Use the shader program
 	glUseProgram(shaderProgram);
+	// Upload the materials of every loaded model
+	UploadMaterialTable(shaderProgram);
+	MeshShaderLocations meshLocations = GetMeshShaderLocations(shaderProgram);
+	// Reload models and textures when they change on disk, without restarting
+	HotReloader reloader;
+	reloader.Watch(loader.Loaded(), loader.Textures());
 	//Anti aliasing
 	glEnable(GL_MULTISAMPLE);
 
@@ -821,6 +397,8 @@ int main(int argc, char** argv)
 	{
 		// Process keyboard input
 		processKeyboard(window);
+		// Swap in assets reloaded since the last frame
+		reloader.Update(shaderProgram);
 		// Set callbacks for mouse movement and mouse button events
 		glfwSetCursorPosCallback(window, mouse_callback);
 		glfwSetMouseButtonCallback(window, mouseButtonCallback);
@@ -871,11 +449,22 @@ int main(int argc, char** argv)
 		glm::mat4 projection = glm::mat4(1.f);
 		projection = glm::perspective(glm::radians(45.f), (float)1920 / (float)1080, .1f, 100.f);
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+		// DrawMesh skips meshlets outside the frustum and picks each mesh's level of detail from its screen size
+		glm::mat4 viewProjection = projection * view;
+
+		// Rendering the static parts, a few draws for all of them
+		glm::mat4 model = glm::mat4(1.f);
+		if (invertObjects)
+		{
+			// Scene inversion
+			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
+		}
+		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+		DrawStaticBatch(staticWorld, meshLocations, viewProjection, model, Camera.Position);
 
 		// Rendering Pump Model
-		glBindVertexArray(VAOs[0]);
 		glBindTexture(GL_TEXTURE_2D, pumpTexture);
-		glm::mat4 model = glm::mat4(1.f);
+		model = glm::mat4(1.f);
 		if (invertObjects)
 		{
 			// Scene inversion
@@ -895,9 +484,8 @@ int main(int argc, char** argv)
 			model = glm::translate(model, glm::vec3(jitterX, jitterY, jitterZ));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, pumpVector.size());
+		DrawMesh(pumpVector, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[1]);
 		glBindTexture(GL_TEXTURE_2D, pumpBaseTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -919,9 +507,8 @@ int main(int argc, char** argv)
 			model = glm::translate(model, glm::vec3(jitterX, jitterY, jitterZ));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, pumpBase.size());
+		DrawMesh(pumpBase, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[2]);
 		glBindTexture(GL_TEXTURE_2D, pumpOutAirTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -951,74 +538,9 @@ int main(int argc, char** argv)
 			model = glm::translate(model, glm::vec3(jitterX, jitterY, jitterZ));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, pumpOutAir.size());
+		DrawMesh(pumpOutAir, meshLocations, viewProjection, model, Camera.Position);
 
 		// Rendering Heater Model
-		glBindVertexArray(VAOs[3]);
-		glBindTexture(GL_TEXTURE_2D, heaterTexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, heaterVector.size());
-
-		glBindVertexArray(VAOs[4]);
-		glBindTexture(GL_TEXTURE_2D, heaterTrailerTexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, heaterTrailer.size());
-
-		glBindVertexArray(VAOs[5]);
-		glBindTexture(GL_TEXTURE_2D, heaterBaseTexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, heaterBase.size());
-
-		glBindVertexArray(VAOs[6]);
-		glBindTexture(GL_TEXTURE_2D, heaterEdgeTexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, heaterEdge.size());
-
-		glBindVertexArray(VAOs[7]);
 		glBindTexture(GL_TEXTURE_2D, heaterHandleTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1038,9 +560,8 @@ int main(int argc, char** argv)
 			model = glm::translate(model, glm::vec3(10.f, 0.f, 6.f));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, heaterHandle.size());
+		DrawMesh(heaterHandle, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[8]);
 		glBindTexture(GL_TEXTURE_2D, heaterDoorTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1060,42 +581,9 @@ int main(int argc, char** argv)
 			model = glm::translate(model, glm::vec3(9.5f, 0.f, 4.f));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, heaterDoor.size());
+		DrawMesh(heaterDoor, meshLocations, viewProjection, model, Camera.Position);
 
 		//Rendering Blower Model 
-		glBindVertexArray(VAOs[9]);
-		glBindTexture(GL_TEXTURE_2D, BlowerTexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, BlowerVector.size());
-
-		glBindVertexArray(VAOs[10]);
-		glBindTexture(GL_TEXTURE_2D, BlowerBaseTexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, BlowerBase.size());
-
-		glBindVertexArray(VAOs[24]);
 		glBindTexture(GL_TEXTURE_2D, BlowerFanTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1124,10 +612,9 @@ int main(int argc, char** argv)
 			
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, BlowerFan.size());
+		DrawMesh(BlowerFan, meshLocations, viewProjection, model, Camera.Position);
 
 		//Rendering  Car Model 
-		glBindVertexArray(VAOs[11]);
 		glBindTexture(GL_TEXTURE_2D, CarTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1146,9 +633,8 @@ int main(int argc, char** argv)
 			model = glm::translate(model, CarPosition);
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CarVector.size());
+		DrawMesh(CarVector, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[12]);
 		glBindTexture(GL_TEXTURE_2D, CarTerrfaceTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1166,9 +652,8 @@ int main(int argc, char** argv)
 			model = glm::translate(model, CarPosition);
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CarTerrface.size());
+		DrawMesh(CarTerrface, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[13]);
 		glBindTexture(GL_TEXTURE_2D, CarWheelTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1186,42 +671,9 @@ int main(int argc, char** argv)
 			model = glm::translate(model, CarPosition);
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CarWheel.size());
+		DrawMesh(CarWheel, meshLocations, viewProjection, model, Camera.Position);
 
 		//Rendering Control Box Model 
-		glBindVertexArray(VAOs[14]);
-		glBindTexture(GL_TEXTURE_2D, CBoxtexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxVector.size());
-
-		glBindVertexArray(VAOs[15]);
-		glBindTexture(GL_TEXTURE_2D, CBoxSigntexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxSign.size());
-
-		glBindVertexArray(VAOs[16]);
 		// Update texture based on current box state
 		if (CurrentBox!=off)
 		{
@@ -1243,25 +695,8 @@ int main(int argc, char** argv)
 			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxBlue.size());
-
-		glBindVertexArray(VAOs[17]);
-		glBindTexture(GL_TEXTURE_2D, CBoxBlacktexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxBlack.size());
+		DrawMesh(CBoxBlue, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[18]);
 		// Update texture based on current box state
 		if (CurrentBox == AllRed || CurrentBox == HalfHalf)
 		{
@@ -1287,9 +722,8 @@ int main(int argc, char** argv)
 			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxRed.size());
+		DrawMesh(CBoxRed, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[19]);
 		// Update texture based on current box state
 		if (CurrentBox == AllGreen || CurrentBox == HalfHalf)
 		{
@@ -1315,26 +749,9 @@ int main(int argc, char** argv)
 			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxGreen.size());
-
-		glBindVertexArray(VAOs[20]);
-		glBindTexture(GL_TEXTURE_2D, CBoxFacetexture);
-		model = glm::mat4(1.f);
-		if (invertObjects)
-		{
-			// Scene inversion
-			model = glm::scale(model, glm::vec3(1.0f, -1.0f, 1.0f));
-		}
-		else
-		{
-			// Scene alignment
-			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-		}
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, CBoxFace.size());
+		DrawMesh(CBoxGreen, meshLocations, viewProjection, model, Camera.Position);
 
 		//Rendering Pipe Model 
-		glBindVertexArray(VAOs[21]);
 		glBindTexture(GL_TEXTURE_2D, PipeTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1356,9 +773,8 @@ int main(int argc, char** argv)
 			model = glm::scale(model, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, Pipe.size());
+		DrawMesh(Pipe, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[22]);
 		glBindTexture(GL_TEXTURE_2D, PipeAirOutTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1380,9 +796,8 @@ int main(int argc, char** argv)
 			model = glm::scale(model, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, PipeAirOut.size());
+		DrawMesh(PipeAirOut, meshLocations, viewProjection, model, Camera.Position);
 
-		glBindVertexArray(VAOs[23]);
 		glBindTexture(GL_TEXTURE_2D, PipeNailTexture);
 		model = glm::mat4(1.f);
 		if (invertObjects)
@@ -1404,7 +819,7 @@ int main(int argc, char** argv)
 			model = glm::scale(model, glm::vec3(scaleFactor, scaleFactor, scaleFactor));
 		}
 		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawArrays(GL_TRIANGLES, 0, PipeNail.size());
+		DrawMesh(PipeNail, meshLocations, viewProjection, model, Camera.Position);
 
 
 		glBindVertexArray(0);
@@ -0,0 +1,201 @@
+#pragma once
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "pak.h"
+
+// Read-only view of a whole file mapped into the address space, or of a file in the mounted archive
+struct MappedFile
+{
+	const char* data = nullptr;
+	size_t size = 0;
+	bool archived = false; // data points into the mounted archive or at decoded
+	char* decoded = nullptr; // new[]'d contents of a compressed archive entry
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+};
+
+void UnmapFile(MappedFile& file);
+void UnmountPak();
+
+// Directory part of a path including the trailing separator, or "" for a bare file name
+std::string DirectoryOf(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+/**
+ * @brief Maps a file on disk read-only into memory, ignoring the mounted archive.
+ *
+ * @param filename The path to the file.
+ * @param file Receives the mapping; file.data is null for an empty file.
+ * @return True if the file was opened and mapped.
+ */
+bool MapDiskFile(const char* filename, MappedFile& file)
+{
+	UnmapFile(file);
+#ifdef _WIN32
+	file.file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file.file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file.file, &size))
+	{
+		UnmapFile(file);
+		return false;
+	}
+	file.size = (size_t)size.QuadPart;
+	if (file.size == 0)
+		return true;
+	file.mapping = CreateFileMappingA(file.file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (file.mapping == NULL)
+	{
+		UnmapFile(file);
+		return false;
+	}
+	file.data = (const char*)MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0);
+	if (file.data == NULL)
+	{
+		UnmapFile(file);
+		return false;
+	}
+#else
+	file.fd = open(filename, O_RDONLY);
+	if (file.fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(file.fd, &st) != 0)
+	{
+		UnmapFile(file);
+		return false;
+	}
+	file.size = (size_t)st.st_size;
+	if (file.size == 0)
+		return true;
+	void* ptr = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		UnmapFile(file);
+		return false;
+	}
+	madvise(ptr, file.size, MADV_SEQUENTIAL);
+	file.data = (const char*)ptr;
+#endif
+	return true;
+}
+
+void UnmapFile(MappedFile& file)
+{
+	if (file.archived)
+	{
+		delete[] file.decoded;
+		file.decoded = nullptr;
+		file.archived = false;
+		file.data = nullptr;
+		file.size = 0;
+		return;
+	}
+#ifdef _WIN32
+	if (file.data != NULL)
+		UnmapViewOfFile(file.data);
+	if (file.mapping != NULL)
+		CloseHandle(file.mapping);
+	if (file.file != INVALID_HANDLE_VALUE)
+		CloseHandle(file.file);
+	file.mapping = NULL;
+	file.file = INVALID_HANDLE_VALUE;
+#else
+	if (file.data != nullptr)
+		munmap((void*)file.data, file.size);
+	if (file.fd >= 0)
+		close(file.fd);
+	file.fd = -1;
+#endif
+	file.data = nullptr;
+	file.size = 0;
+}
+
+// The archive MapFile looks in before the disk, see MountPak
+MappedFile mountedPakFile;
+PakArchive mountedPak;
+
+/**
+ * @brief Maps an archive for the rest of the run; from then on MapFile finds its files first.
+ *
+ * Mount once at startup, before any loader thread runs. Files the archive does not hold still
+ * come from the disk.
+ *
+ * @param filename The path to the .pak file.
+ * @return False if the file is missing or not a valid archive; nothing is mounted then.
+ */
+bool MountPak(const char* filename)
+{
+	UnmountPak();
+	if (!MapDiskFile(filename, mountedPakFile))
+		return false;
+	if (!OpenPak(mountedPakFile.data, mountedPakFile.size, mountedPak))
+	{
+		printf("MountPak - %s is not a valid archive\n", filename);
+		UnmapFile(mountedPakFile);
+		return false;
+	}
+	printf("MountPak - %s entries=%u %.1f KB\n", filename, mountedPak.entryCount, mountedPakFile.size / 1024.0);
+	return true;
+}
+
+// Files mapped from the archive must be unmapped before this
+void UnmountPak()
+{
+	mountedPak = PakArchive();
+	UnmapFile(mountedPakFile);
+}
+
+/**
+ * @brief Maps a file read-only into memory, from the mounted archive if it holds the path.
+ *
+ * A stored archive entry is a pointer into the archive mapping; a compressed one is decoded into
+ * memory that UnmapFile frees.
+ *
+ * @param filename The path to the file.
+ * @param file Receives the mapping; file.data is null for an empty file.
+ * @return True if the file was found and mapped.
+ */
+bool MapFile(const char* filename, MappedFile& file)
+{
+	const PakEntry* entry = FindPakEntry(mountedPak, filename);
+	if (entry == nullptr)
+		return MapDiskFile(filename, file);
+
+	UnmapFile(file);
+	file.archived = true;
+	file.size = (size_t)entry->size;
+	if ((entry->flags & PAK_COMPRESSED) == 0)
+	{
+		file.data = file.size > 0 ? mountedPak.data + entry->offset : nullptr;
+		return true;
+	}
+	file.decoded = new char[file.size];
+	file.data = file.decoded;
+	if (!ReadPakEntry(mountedPak, *entry, file.decoded))
+	{
+		printf("MapFile - %s is corrupt in the archive\n", filename);
+		UnmapFile(file);
+		return false;
+	}
+	return true;
+}
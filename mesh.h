@@ -0,0 +1,278 @@
+#pragma once
+#include <math.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MESH_USE_SSE 1
+#endif
+
+#include "arena.h"
+
+// Floats per vertex: position, normal and UV
+const int MESH_VERTEX_STRIDE = 8;
+
+// Levels of detail a mesh can have, counting the full mesh as level 0 (see BuildMeshLods)
+const int MESH_MAX_LODS = 4;
+
+// Vertex layouts a mesh can be uploaded and cached in
+enum VertexFormat
+{
+	VERTEX_FORMAT_FLOAT = 0, // MESH_VERTEX_STRIDE floats, 32 bytes
+	VERTEX_FORMAT_PACKED = 1, // PackedVertex, 16 bytes
+};
+
+// Compact vertex: position quantized to 16 bits inside the mesh bounds, 10:10:10:2 normal, half-float UV
+struct PackedVertex
+{
+	unsigned short position[4]; // unorm x, y, z; w is padding
+	unsigned int normal; // GL_INT_2_10_10_10_REV
+	unsigned short uv[2]; // half floats
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+size_t VertexFormatSize(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : MESH_VERTEX_STRIDE * sizeof(float);
+}
+
+// Surface properties from an MTL file; the defaults reproduce the old fixed white shading
+struct Material
+{
+	std::string name;
+	glm::vec3 diffuse = glm::vec3(1.f); // Kd
+	glm::vec3 specular = glm::vec3(1.f); // Ks
+	glm::vec3 emissive = glm::vec3(0.f); // Ke
+	float shininess = 128.f; // Ns
+};
+
+// Run of the index buffer, e.g. a submesh at one level of detail
+struct IndexRange
+{
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+};
+
+// Range of the index buffer drawn as one unit (an OBJ object or material run), with its bounds
+struct SubMesh
+{
+	std::string name;
+	std::string material;
+	int materialIndex = -1; // into Mesh::materials, -1 for the default material
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	glm::vec3 boundsMin = glm::vec3(0.f);
+	glm::vec3 boundsMax = glm::vec3(0.f);
+	glm::vec3 center = glm::vec3(0.f); // bounding sphere
+	float radius = 0.f;
+	unsigned int firstMeshlet = 0; // into Mesh::meshlets
+	unsigned int meshletCount = 0;
+	IndexRange lods[MESH_MAX_LODS - 1]; // simplified copies of the range for levels 1 and up
+};
+
+// Small run of a submesh's index range (see BuildMeshlets), with the bounds needed to cull it
+struct Meshlet
+{
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	glm::vec3 center = glm::vec3(0.f); // bounding sphere
+	float radius = 0.f;
+	glm::vec3 coneAxis = glm::vec3(0.f); // average facing of the triangles
+	float coneCutoff = 1.f; // sine of the normal cone's half-angle; 1 when the cone is too wide to cull
+};
+
+// Indexed triangle mesh in the interleaved layout used by the VAOs
+struct Mesh
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<SubMesh> submeshes;
+	std::vector<Meshlet> meshlets; // grouped by submesh
+	std::vector<Material> materials; // used by the submeshes
+	std::vector<std::string> dependencies; // other files the mesh was built from, e.g. MTLs
+	glm::vec3 boundsMin = glm::vec3(0.f);
+	glm::vec3 boundsMax = glm::vec3(0.f);
+	int lodCount = 1;
+	float lodErrors[MESH_MAX_LODS] = {}; // object-space simplification error of every level
+};
+
+size_t MeshVertexCount(const Mesh& mesh)
+{
+	return mesh.vertices.size() / MESH_VERTEX_STRIDE;
+}
+
+// 16-bit indices can address every vertex of the mesh
+bool MeshUsesShortIndices(const Mesh& mesh)
+{
+	return MeshVertexCount(mesh) <= 0x10000;
+}
+
+ArenaVector<unsigned short> NarrowIndices(const std::vector<unsigned int>& indices)
+{
+	return ArenaVector<unsigned short>(indices.begin(), indices.end());
+}
+
+/**
+ * @brief Computes the bounding box and bounding sphere of the vertices a submesh references.
+ *
+ * The min/max reduction runs four lanes at a time (x, y, z and a don't-care lane).
+ *
+ * @param mesh The mesh the submesh belongs to.
+ * @param submesh The submesh to update.
+ */
+void ComputeSubMeshBounds(const Mesh& mesh, SubMesh& submesh)
+{
+	if (submesh.indexCount == 0)
+		return;
+	const float* vertices = mesh.vertices.data();
+	const unsigned int* index = mesh.indices.data() + submesh.firstIndex;
+	const unsigned int* last = index + submesh.indexCount;
+
+#ifdef MESH_USE_SSE
+	// Each load reads x, y, z and the first normal float, which stays inside the vertex
+	__m128 lo = _mm_loadu_ps(vertices + (size_t)index[0] * MESH_VERTEX_STRIDE);
+	__m128 hi = lo;
+	for (const unsigned int* i = index + 1; i < last; i++)
+	{
+		__m128 position = _mm_loadu_ps(vertices + (size_t)*i * MESH_VERTEX_STRIDE);
+		lo = _mm_min_ps(lo, position);
+		hi = _mm_max_ps(hi, position);
+	}
+	float loLanes[4], hiLanes[4];
+	_mm_storeu_ps(loLanes, lo);
+	_mm_storeu_ps(hiLanes, hi);
+	submesh.boundsMin = glm::vec3(loLanes[0], loLanes[1], loLanes[2]);
+	submesh.boundsMax = glm::vec3(hiLanes[0], hiLanes[1], hiLanes[2]);
+#else
+	const float* first = vertices + (size_t)index[0] * MESH_VERTEX_STRIDE;
+	glm::vec3 lo(first[0], first[1], first[2]), hi = lo;
+	for (const unsigned int* i = index + 1; i < last; i++)
+	{
+		const float* v = vertices + (size_t)*i * MESH_VERTEX_STRIDE;
+		lo = glm::min(lo, glm::vec3(v[0], v[1], v[2]));
+		hi = glm::max(hi, glm::vec3(v[0], v[1], v[2]));
+	}
+	submesh.boundsMin = lo;
+	submesh.boundsMax = hi;
+#endif
+
+	// Sphere around the box centre, just large enough for the referenced vertices
+	submesh.center = (submesh.boundsMin + submesh.boundsMax) * 0.5f;
+	float radiusSquared = 0.f;
+	for (const unsigned int* i = index; i < last; i++)
+	{
+		const float* v = vertices + (size_t)*i * MESH_VERTEX_STRIDE;
+		glm::vec3 d = glm::vec3(v[0], v[1], v[2]) - submesh.center;
+		float distanceSquared = glm::dot(d, d);
+		if (distanceSquared > radiusSquared)
+			radiusSquared = distanceSquared;
+	}
+	submesh.radius = sqrtf(radiusSquared);
+}
+
+/**
+ * @brief Computes the bounds of every submesh and of the whole mesh.
+ *
+ * A mesh without a submesh table gets a single submesh covering all indices.
+ *
+ * @param mesh The mesh to update.
+ */
+void ComputeMeshBounds(Mesh& mesh)
+{
+	if (mesh.submeshes.empty())
+	{
+		SubMesh whole;
+		whole.indexCount = (unsigned int)mesh.indices.size();
+		mesh.submeshes.push_back(whole);
+	}
+
+	bool first = true;
+	for (SubMesh& submesh : mesh.submeshes)
+	{
+		ComputeSubMeshBounds(mesh, submesh);
+		if (submesh.indexCount == 0)
+			continue;
+		mesh.boundsMin = first ? submesh.boundsMin : glm::min(mesh.boundsMin, submesh.boundsMin);
+		mesh.boundsMax = first ? submesh.boundsMax : glm::max(mesh.boundsMax, submesh.boundsMax);
+		first = false;
+	}
+}
+
+// Multiplier taking a position offset from boundsMin to the unorm16 range; 0 on flat axes
+glm::vec3 PositionQuantizationScale(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	glm::vec3 extent = boundsMax - boundsMin;
+	glm::vec3 scale;
+	for (int axis = 0; axis < 3; axis++)
+		scale[axis] = extent[axis] > 0.f ? 65535.f / extent[axis] : 0.f;
+	return scale;
+}
+
+/**
+ * @brief Packs one float vertex (MESH_VERTEX_STRIDE floats).
+ *
+ * @param v The float vertex.
+ * @param boundsMin Origin of the position quantization.
+ * @param scale Result of PositionQuantizationScale for the same bounds.
+ * @param out Receives the packed vertex.
+ */
+void PackVertex(const float* v, const glm::vec3& boundsMin, const glm::vec3& scale, PackedVertex& out)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float q = (v[axis] - boundsMin[axis]) * scale[axis] + 0.5f;
+		out.position[axis] = (unsigned short)(q < 0.f ? 0.f : q > 65535.f ? 65535.f : q);
+	}
+	out.position[3] = 0;
+
+	glm::vec3 normal(v[3], v[4], v[5]);
+	float length = glm::length(normal);
+	if (length > 0.f)
+		normal /= length;
+	out.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.f));
+
+	out.uv[0] = glm::packHalf1x16(v[6]);
+	out.uv[1] = glm::packHalf1x16(v[7]);
+}
+
+/**
+ * @brief Unpacks one vertex written by PackVertex, to within its quantization step.
+ *
+ * @param in The packed vertex.
+ * @param boundsMin Minimum corner of the bounds the position was quantized in.
+ * @param boundsMax Maximum corner of the same bounds.
+ * @param v Receives MESH_VERTEX_STRIDE floats.
+ */
+void UnpackVertex(const PackedVertex& in, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float* v)
+{
+	glm::vec3 extent = boundsMax - boundsMin;
+	for (int axis = 0; axis < 3; axis++)
+		v[axis] = boundsMin[axis] + in.position[axis] / 65535.f * extent[axis];
+	glm::vec4 normal = glm::unpackSnorm3x10_1x2(in.normal);
+	v[3] = normal.x;
+	v[4] = normal.y;
+	v[5] = normal.z;
+	v[6] = glm::unpackHalf1x16(in.uv[0]);
+	v[7] = glm::unpackHalf1x16(in.uv[1]);
+}
+
+/**
+ * @brief Converts the float vertices of a mesh to PackedVertex.
+ *
+ * Positions are stored as fractions of the mesh bounds, so mesh.boundsMin and mesh.boundsMax
+ * must be computed first; a shader gets the position back as boundsMin + unorm * (boundsMax - boundsMin).
+ *
+ * @param mesh The mesh to pack.
+ * @return One packed vertex per mesh vertex.
+ */
+ArenaVector<PackedVertex> PackMeshVertices(const Mesh& mesh)
+{
+	glm::vec3 scale = PositionQuantizationScale(mesh.boundsMin, mesh.boundsMax);
+	ArenaVector<PackedVertex> packed(MeshVertexCount(mesh));
+	for (size_t i = 0; i < packed.size(); i++)
+		PackVertex(mesh.vertices.data() + i * MESH_VERTEX_STRIDE, mesh.boundsMin, scale, packed[i]);
+	return packed;
+}
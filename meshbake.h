@@ -0,0 +1,42 @@
+#pragma once
+#include <stdio.h>
+#include <string>
+
+#include "assimploader.h"
+#include "meshcache.h"
+#include "meshlet.h"
+#include "meshlod.h"
+#include "meshoptimize.h"
+#include "threadpool.h"
+
+// Layout used for uploads and the mesh cache; VERTEX_FORMAT_FLOAT keeps full precision
+VertexFormat meshVertexFormat = VERTEX_FORMAT_PACKED;
+
+/**
+ * @brief Builds the cache entry of a model file without touching GL.
+ *
+ * The file is read with ReadMeshFile (OBJ, GLB, or any format Assimp imports), optimized with
+ * OptimizeMesh, split into meshlets and given simplified levels of detail, then written with
+ * WriteMeshCache. Used by PrepareObjMesh on a cache miss and by tools/asset_baker.
+ *
+ * @param filePath The path to the model file.
+ * @param key The content key of the file, from ContentKeyOf.
+ * @param pool The pool to parse on; calling this from one of its tasks is fine.
+ * @param format The vertex layout of the entry.
+ * @param mesh Receives the processed mesh.
+ * @return False if the file could not be read; a failed cache write is only logged.
+ */
+bool BakeMesh(const std::string& filePath, uint64_t key, ThreadPool& pool, VertexFormat format, Mesh& mesh)
+{
+	if (!ReadMeshFile(filePath, pool, mesh))
+		return false;
+	MeshOptimizeStats stats = OptimizeMesh(mesh);
+	BuildMeshlets(mesh);
+	BuildMeshLods(mesh);
+	printf("OptimizeMesh - %s acmr %.3f -> %.3f atvr %.3f -> %.3f clusters=%zu meshlets=%zu lods=%d\n", filePath.c_str(),
+		stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr, stats.clusters, mesh.meshlets.size(),
+		mesh.lodCount);
+	if (!WriteMeshCache(filePath, key, mesh, format))
+		printf("BakeMesh - could not write cache for %s\n", filePath.c_str());
+	return true;
+}
@@ -0,0 +1,757 @@
+#pragma once
+#include <glad/glad.h> 
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "assimploader.h"
+#include "mesh.h"
+#include "meshbake.h"
+#include "meshcache.h"
+#include "meshlet.h"
+#include "meshlod.h"
+#include "meshoptimize.h"
+#include "objloader.h"
+
+// Must match MAX_MATERIALS in phong.frag; 256 * 48 bytes fits the 16 KB minimum uniform block size
+const int MAX_MATERIALS = 256;
+
+// One draw call of a mesh: a run of submeshes sharing a material table slot
+struct MeshDraw
+{
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	int materialSlot = 0;
+	unsigned int firstMeshlet = 0; // the meshlets covering the range, none for streamed meshes
+	unsigned int meshletCount = 0;
+	IndexRange lods[MESH_MAX_LODS - 1]; // the same submeshes at levels 1 and up
+	GLuint VAO = 0; // vertex array of the draw's own, e.g. a glTF primitive's; 0 uses the mesh's
+};
+
+// GPU copy of a mesh: vertex array, vertex buffer and index buffer, plus the submesh table for culling
+struct MeshBuffer
+{
+	GLuint VAO = 0;
+	GLuint VBO = 0;
+	GLuint EBO = 0; // 0 for streamed meshes, whose draws then address vertices directly
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLsizei indexCount = 0;
+	VertexFormat format = VERTEX_FORMAT_FLOAT;
+	glm::vec3 positionScale = glm::vec3(1.f); // object position = attribute * scale + offset
+	glm::vec3 positionOffset = glm::vec3(0.f);
+	glm::vec2 texCoordScale = glm::vec2(1.f); // texture coordinate = attribute * scale + offset
+	glm::vec2 texCoordOffset = glm::vec2(0.f);
+	std::vector<SubMesh> submeshes;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshDraw> draws;
+	glm::vec3 boundsMin = glm::vec3(0.f);
+	glm::vec3 boundsMax = glm::vec3(0.f);
+	int lodCount = 1;
+	float lodErrors[MESH_MAX_LODS] = {};
+	mutable MeshLodState lodState; // of the last DrawMesh without a state of its own
+};
+
+// Uniforms of the mesh shader that DrawMesh sets per mesh and per draw
+struct MeshShaderLocations
+{
+	GLint materialIndex = -1;
+	GLint positionScale = -1;
+	GLint positionOffset = -1;
+	GLint texCoordScale = -1;
+	GLint texCoordOffset = -1;
+};
+
+MeshShaderLocations GetMeshShaderLocations(GLuint program)
+{
+	MeshShaderLocations locations;
+	locations.materialIndex = glGetUniformLocation(program, "materialIndex");
+	locations.positionScale = glGetUniformLocation(program, "positionScale");
+	locations.positionOffset = glGetUniformLocation(program, "positionOffset");
+	locations.texCoordScale = glGetUniformLocation(program, "texCoordScale");
+	locations.texCoordOffset = glGetUniformLocation(program, "texCoordOffset");
+	return locations;
+}
+
+// Every material of every loaded mesh, deduplicated by value; slot 0 is the default material
+std::vector<Material> materialTable(1);
+GLuint materialBuffer = 0;
+
+bool SameMaterial(const Material& a, const Material& b)
+{
+	return a.diffuse == b.diffuse && a.specular == b.specular && a.emissive == b.emissive && a.shininess == b.shininess;
+}
+
+/**
+ * @brief Finds or adds a material in the global material table.
+ *
+ * @param material The material to look up.
+ * @return The slot of the material, or 0 (the default) when the table is full.
+ */
+int RegisterMaterial(const Material& material)
+{
+	for (size_t i = 0; i < materialTable.size(); i++)
+	{
+		if (SameMaterial(materialTable[i], material))
+			return (int)i;
+	}
+	if (materialTable.size() >= MAX_MATERIALS)
+	{
+		printf("RegisterMaterial - table full, using the default for %s\n", material.name.c_str());
+		return 0;
+	}
+	materialTable.push_back(material);
+	return (int)materialTable.size() - 1;
+}
+
+/**
+ * @brief Builds the draw list of a mesh, registering its materials in the global table.
+ *
+ * Consecutive submeshes that end up in the same slot are merged into one draw, as long as
+ * their ranges are also consecutive at every level of detail.
+ *
+ * @param buffer The mesh whose draws are built; buffer.submeshes must be set.
+ * @param materials The materials the submeshes refer to.
+ */
+void BuildMeshDraws(MeshBuffer& buffer, const std::vector<Material>& materials)
+{
+	std::vector<int> slots(materials.size());
+	for (size_t i = 0; i < materials.size(); i++)
+		slots[i] = RegisterMaterial(materials[i]);
+
+	buffer.draws.clear();
+	for (const SubMesh& submesh : buffer.submeshes)
+	{
+		if (submesh.indexCount == 0)
+			continue;
+		int slot = submesh.materialIndex >= 0 && submesh.materialIndex < (int)slots.size() ? slots[submesh.materialIndex] : 0;
+		if (!buffer.draws.empty())
+		{
+			MeshDraw& last = buffer.draws.back();
+			bool consecutive = last.materialSlot == slot && last.firstIndex + last.indexCount == submesh.firstIndex
+				&& last.firstMeshlet + last.meshletCount == submesh.firstMeshlet;
+			for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+				consecutive = consecutive && last.lods[level].firstIndex + last.lods[level].indexCount == submesh.lods[level].firstIndex;
+			if (consecutive)
+			{
+				last.indexCount += submesh.indexCount;
+				last.meshletCount += submesh.meshletCount;
+				for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+					last.lods[level].indexCount += submesh.lods[level].indexCount;
+				continue;
+			}
+		}
+		MeshDraw draw;
+		draw.firstIndex = submesh.firstIndex;
+		draw.indexCount = submesh.indexCount;
+		draw.materialSlot = slot;
+		draw.firstMeshlet = submesh.firstMeshlet;
+		draw.meshletCount = submesh.meshletCount;
+		for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+			draw.lods[level] = submesh.lods[level];
+		buffer.draws.push_back(draw);
+	}
+}
+
+/**
+ * @brief Uploads the global material table to the "Materials" uniform block of a program.
+ *
+ * Call after all meshes are loaded. Each entry is three std140 vec4s: diffuse, specular with
+ * the shininess in w, and emissive.
+ *
+ * @param program The shader program declaring the block.
+ */
+void UploadMaterialTable(GLuint program)
+{
+	std::vector<glm::vec4> data(materialTable.size() * 3);
+	for (size_t i = 0; i < materialTable.size(); i++)
+	{
+		const Material& material = materialTable[i];
+		data[i * 3 + 0] = glm::vec4(material.diffuse, 1.f);
+		data[i * 3 + 1] = glm::vec4(material.specular, material.shininess);
+		data[i * 3 + 2] = glm::vec4(material.emissive, 0.f);
+	}
+
+	if (materialBuffer == 0)
+		glGenBuffers(1, &materialBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * 3 * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size() * sizeof(glm::vec4), data.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	GLuint block = glGetUniformBlockIndex(program, "Materials");
+	if (block == GL_INVALID_INDEX)
+	{
+		printf("UploadMaterialTable - program has no Materials block\n");
+		return;
+	}
+	glUniformBlockBinding(program, block, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, materialBuffer);
+	printf("UploadMaterialTable - %zu materials\n", materialTable.size());
+}
+
+// Attribute layout of the interleaved vertex (see ExpandObjCorner and PackedVertex)
+void SetupVertexAttributes(VertexFormat format)
+{
+	if (format == VERTEX_FORMAT_PACKED)
+	{
+		GLsizei stride = sizeof(PackedVertex);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, uv));
+		glEnableVertexAttribArray(3);
+		return;
+	}
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, MESH_VERTEX_STRIDE * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+}
+
+/**
+ * @brief Creates a VAO/VBO/EBO from raw vertex and index data.
+ *
+ * @param vertices Interleaved vertex data.
+ * @param vertexBytes Size of the vertex data in bytes.
+ * @param format Layout of the vertex data.
+ * @param indices Index data.
+ * @param indexCount Number of indices.
+ * @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @return The GPU buffers of the mesh.
+ */
+MeshBuffer UploadMeshData(const void* vertices, size_t vertexBytes, VertexFormat format, const void* indices, size_t indexCount,
+	GLenum indexType)
+{
+	MeshBuffer buffer;
+	glGenVertexArrays(1, &buffer.VAO);
+	glGenBuffers(1, &buffer.VBO);
+	glGenBuffers(1, &buffer.EBO);
+
+	glBindVertexArray(buffer.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+	SetupVertexAttributes(format);
+	buffer.format = format;
+
+	size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indices, GL_STATIC_DRAW);
+	buffer.indexType = indexType;
+	buffer.indexCount = (GLsizei)indexCount;
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return buffer;
+}
+
+// Packed positions are fractions of the mesh bounds; float positions are used as they are
+void SetPositionDequantization(MeshBuffer& buffer)
+{
+	if (buffer.format == VERTEX_FORMAT_PACKED)
+	{
+		buffer.positionScale = buffer.boundsMax - buffer.boundsMin;
+		buffer.positionOffset = buffer.boundsMin;
+	}
+	else
+	{
+		buffer.positionScale = glm::vec3(1.f);
+		buffer.positionOffset = glm::vec3(0.f);
+	}
+}
+
+/**
+ * @brief Uploads a mesh, storing indices as 16-bit when every vertex can be addressed that way.
+ *
+ * @param mesh The mesh to upload; its bounds must be computed.
+ * @param format The vertex layout to upload in.
+ * @return The GPU buffers of the mesh.
+ */
+MeshBuffer UploadMesh(const Mesh& mesh, VertexFormat format)
+{
+	ArenaScope scope;
+	ArenaVector<PackedVertex> packed;
+	const void* vertices = mesh.vertices.data();
+	size_t vertexBytes = mesh.vertices.size() * sizeof(float);
+	if (format == VERTEX_FORMAT_PACKED)
+	{
+		packed = PackMeshVertices(mesh);
+		vertices = packed.data();
+		vertexBytes = packed.size() * sizeof(PackedVertex);
+	}
+
+	MeshBuffer buffer;
+	if (MeshUsesShortIndices(mesh))
+	{
+		ArenaVector<unsigned short> shortIndices = NarrowIndices(mesh.indices);
+		buffer = UploadMeshData(vertices, vertexBytes, format, shortIndices.data(), shortIndices.size(), GL_UNSIGNED_SHORT);
+	}
+	else
+	{
+		buffer = UploadMeshData(vertices, vertexBytes, format, mesh.indices.data(), mesh.indices.size(), GL_UNSIGNED_INT);
+	}
+	buffer.submeshes = mesh.submeshes;
+	buffer.meshlets = mesh.meshlets;
+	buffer.lodCount = mesh.lodCount;
+	memcpy(buffer.lodErrors, mesh.lodErrors, sizeof(buffer.lodErrors));
+	BuildMeshDraws(buffer, mesh.materials);
+	buffer.boundsMin = mesh.boundsMin;
+	buffer.boundsMax = mesh.boundsMax;
+	SetPositionDequantization(buffer);
+	return buffer;
+}
+
+// CPU half of LoadObjMesh: either a mapped cache entry or a freshly built mesh, ready to upload
+struct PreparedMesh
+{
+	std::string path;
+	uint64_t key = 0; // content key of the file, see ContentKeyOf
+	bool valid = false;
+	bool cached = false;
+	MappedFile cacheFile;
+	MeshCacheView view;
+	Mesh mesh;
+};
+
+/**
+ * @brief Does the file work of LoadObjMesh without touching GL, so it can run on a worker thread.
+ *
+ * The cache entry is found by the content key of the file, so files with the same bytes share
+ * it. A valid entry is mapped and its pages are read in, so the upload does not stall on the
+ * disk. Otherwise BakeMesh builds the mesh and writes a new entry for the next run.
+ *
+ * @param filePath The path to the model file.
+ * @param pool The pool to parse on; calling this from one of its tasks is fine.
+ * @param prepared Receives the data to pass to UploadPreparedMesh.
+ */
+void PrepareObjMesh(const std::string& filePath, ThreadPool& pool, PreparedMesh& prepared)
+{
+	prepared.path = filePath;
+	bool keyed = ContentKeyOf(filePath, prepared.key);
+	if (keyed && OpenMeshCache(filePath, prepared.key, meshVertexFormat, prepared.cacheFile, prepared.view))
+	{
+		volatile char touch = 0;
+		for (size_t offset = 0; offset < prepared.cacheFile.size; offset += 4096)
+			touch = touch + prepared.cacheFile.data[offset];
+		prepared.cached = true;
+		prepared.valid = true;
+		return;
+	}
+
+	if (!keyed)
+	{
+		printf("LoadObjMesh - could not open %s\n", filePath.c_str());
+		return;
+	}
+	prepared.valid = BakeMesh(filePath, prepared.key, pool, meshVertexFormat, prepared.mesh);
+}
+
+// Bytes of vertex and index data UploadPreparedMesh sends to the GPU
+size_t PreparedMeshBytes(const PreparedMesh& prepared)
+{
+	if (!prepared.valid)
+		return 0;
+	if (prepared.cached)
+		return (size_t)prepared.view.header->vertexCount * prepared.view.header->vertexStride
+			+ (size_t)prepared.view.header->indexCount * prepared.view.header->indexSize;
+	return MeshVertexCount(prepared.mesh) * VertexFormatSize(meshVertexFormat)
+		+ prepared.mesh.indices.size() * (MeshUsesShortIndices(prepared.mesh) ? 2 : 4);
+}
+
+/**
+ * @brief Creates the GPU buffers of a prepared mesh and releases its CPU data.
+ *
+ * @param prepared The result of PrepareObjMesh.
+ * @return The GPU buffers of the mesh, empty if the file could not be read.
+ */
+MeshBuffer UploadPreparedMesh(PreparedMesh& prepared)
+{
+	if (!prepared.valid)
+		return MeshBuffer();
+	if (!prepared.cached)
+	{
+		MeshBuffer buffer = UploadMesh(prepared.mesh, meshVertexFormat);
+		prepared.mesh = Mesh();
+		return buffer;
+	}
+
+	const MeshCacheView& view = prepared.view;
+	const MeshCacheHeader* header = view.header;
+	MeshBuffer buffer = UploadMeshData(view.vertices, (size_t)header->vertexCount * header->vertexStride, meshVertexFormat,
+		view.indices, header->indexCount, header->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+	std::vector<Material> materials;
+	ReadMeshCacheSubMeshes(view, buffer.submeshes, buffer.meshlets, materials, buffer.boundsMin, buffer.boundsMax);
+	buffer.lodCount = (int)header->lodCount;
+	memcpy(buffer.lodErrors, header->lodErrors, sizeof(buffer.lodErrors));
+	UnmapFile(prepared.cacheFile);
+	BuildMeshDraws(buffer, materials);
+	SetPositionDequantization(buffer);
+	return buffer;
+}
+
+/**
+ * @brief Loads a model file as an indexed mesh, going through the binary mesh cache.
+ *
+ * A valid cache entry is memory-mapped and handed straight to glBufferData. Otherwise the
+ * file is read with ReadMeshFile and a new entry is written for the next run.
+ *
+ * @param filePath The path to the OBJ file, or any format Assimp imports.
+ * @param pool The pool to parse on.
+ * @return The GPU buffers of the mesh, empty if the file could not be read.
+ */
+MeshBuffer LoadObjMesh(const std::string& filePath, ThreadPool& pool)
+{
+	PreparedMesh prepared;
+	PrepareObjMesh(filePath, pool, prepared);
+	return UploadPreparedMesh(prepared);
+}
+
+// Deletes the GL objects of a mesh and empties it; copies sharing them must not be drawn afterwards
+void DeleteMeshBuffer(MeshBuffer& buffer)
+{
+	for (const MeshDraw& draw : buffer.draws)
+	{
+		if (draw.VAO != 0 && draw.VAO != buffer.VAO)
+			glDeleteVertexArrays(1, &draw.VAO);
+	}
+	if (buffer.VAO != 0)
+		glDeleteVertexArrays(1, &buffer.VAO);
+	if (buffer.VBO != 0)
+		glDeleteBuffers(1, &buffer.VBO);
+	if (buffer.EBO != 0)
+		glDeleteBuffers(1, &buffer.EBO);
+	buffer = MeshBuffer();
+}
+
+// Vertices written per glMapBufferRange in StreamObjMesh; bounds the host-side staging
+const size_t STREAM_CHUNK_VERTICES = 64 * 1024;
+
+/**
+ * @brief Loads an OBJ file as a non-indexed mesh, expanding the faces straight into the mapped vertex buffer.
+ *
+ * Unlike LoadObjMesh this never holds the corner list, the expanded vertices or an index buffer
+ * in host memory, only the attribute pools; the vertex buffer is sized from the pre-scan and
+ * filled one mapped range of chunkVertices at a time. Nothing is cached.
+ *
+ * @param filePath The path to the OBJ file.
+ * @param chunkVertices Vertices per mapped range.
+ * @param progress Called after each chunk with the vertices written so far and the total; may be empty.
+ * @return The GPU buffers of the mesh, empty if the file could not be read.
+ */
+MeshBuffer StreamObjMesh(const std::string& filePath, size_t chunkVertices = STREAM_CHUNK_VERTICES,
+	const std::function<void(size_t done, size_t total)>& progress = nullptr)
+{
+	ArenaScope scope;
+	ObjStream stream;
+	if (!OpenObjStream(filePath, stream))
+		return MeshBuffer();
+
+	size_t total = stream.counts.corners;
+	size_t vertexSize = VertexFormatSize(meshVertexFormat);
+	MeshBuffer buffer;
+	glGenVertexArrays(1, &buffer.VAO);
+	glGenBuffers(1, &buffer.VBO);
+	glBindVertexArray(buffer.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+	glBufferData(GL_ARRAY_BUFFER, total * vertexSize, NULL, GL_STATIC_DRAW);
+	SetupVertexAttributes(meshVertexFormat);
+	buffer.format = meshVertexFormat;
+
+	size_t done = 0;
+	size_t chunks = 0;
+	while (done < total)
+	{
+		size_t count = total - done < chunkVertices ? total - done : chunkVertices;
+		void* out = glMapBufferRange(GL_ARRAY_BUFFER, done * vertexSize, count * vertexSize,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (out == NULL)
+		{
+			printf("StreamObjMesh - could not map the vertex buffer of %s\n", filePath.c_str());
+			break;
+		}
+		size_t written = ReadObjStream(stream, meshVertexFormat, out, count);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		done += written;
+		chunks++;
+		if (progress)
+			progress(done, total);
+		if (written < count)
+			break;
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	size_t hostBytes = stream.obj.positions.size() * sizeof(glm::vec3) + stream.obj.uvs.size() * sizeof(glm::vec2)
+		+ stream.obj.normals.size() * sizeof(glm::vec3);
+	Mesh mesh;
+	CloseObjStream(stream, mesh);
+	buffer.indexCount = (GLsizei)done;
+	buffer.submeshes = mesh.submeshes;
+	BuildMeshDraws(buffer, mesh.materials);
+	buffer.boundsMin = mesh.boundsMin;
+	buffer.boundsMax = mesh.boundsMax;
+	SetPositionDequantization(buffer);
+	printf("StreamObjMesh - %s vertices=%zu chunks=%zu host=%.1f KB gpu=%.1f KB\n", filePath.c_str(), done, chunks,
+		hostBytes / 1024.0, done * vertexSize / 1024.0);
+	return buffer;
+}
+
+// GL type of a glTF component type
+GLenum GltfComponentGLType(int componentType)
+{
+	switch (componentType)
+	{
+	case GLTF_BYTE: return GL_BYTE;
+	case GLTF_UNSIGNED_BYTE: return GL_UNSIGNED_BYTE;
+	case GLTF_SHORT: return GL_SHORT;
+	case GLTF_UNSIGNED_SHORT: return GL_UNSIGNED_SHORT;
+	case GLTF_UNSIGNED_INT: return GL_UNSIGNED_INT;
+	}
+	return GL_FLOAT;
+}
+
+/**
+ * @brief Loads a GLB file without converting it: the BIN chunk goes to GL in one glBufferData straight from the mapping.
+ *
+ * Only the JSON chunk is parsed. Each distinct set of vertex accessors gets a vertex array whose
+ * attribute pointers point at the accessors in the uploaded chunk, which also serves as the index
+ * buffer, so nothing is copied or reordered on the host. In exchange there are no meshlets, levels
+ * of detail or cache entry, and the vertex order is drawn as the exporter wrote it. Files whose
+ * primitives are not indexed, or mix index types, go through ReadGlbMesh and UploadMesh instead.
+ *
+ * @param filePath The path to the GLB file.
+ * @return The GPU buffers of the mesh, empty if the file could not be read.
+ */
+MeshBuffer LoadGlbMesh(const std::string& filePath)
+{
+	GlbFile glb;
+	if (!OpenGlbFile(filePath, glb))
+		return MeshBuffer();
+
+	bool direct = !glb.primitives.empty();
+	int indexComponentType = direct ? glb.primitives[0].indices.componentType : 0;
+	size_t indexSize = GltfComponentSize(indexComponentType);
+	for (const GlbPrimitive& primitive : glb.primitives)
+	{
+		direct = direct && primitive.indices.count > 0 && primitive.indices.componentType == indexComponentType
+			&& indexComponentType != GLTF_UNSIGNED_BYTE && primitive.indices.stride == indexSize && primitive.indices.offset % indexSize == 0;
+	}
+	if (!direct)
+	{
+		CloseGlbFile(glb);
+		printf("LoadGlbMesh - %s has unindexed or mixed index primitives, converting\n", filePath.c_str());
+		Mesh mesh;
+		if (!ReadGlbMesh(filePath, mesh))
+			return MeshBuffer();
+		return UploadMesh(mesh, meshVertexFormat);
+	}
+
+	MeshBuffer buffer;
+	glGenBuffers(1, &buffer.VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+	glBufferData(GL_ARRAY_BUFFER, glb.binSize, glb.bin, GL_STATIC_DRAW);
+	buffer.EBO = buffer.VBO;
+	buffer.format = VERTEX_FORMAT_FLOAT;
+	buffer.indexType = indexComponentType == GLTF_UNSIGNED_SHORT ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	std::vector<int> slots(glb.materials.size());
+	for (size_t i = 0; i < glb.materials.size(); i++)
+		slots[i] = RegisterMaterial(glb.materials[i]);
+	std::vector<const GlbPrimitive*> arrayPrimitives; // the primitive each vertex array was made for
+	std::vector<GLuint> arrays;
+	for (const GlbPrimitive& primitive : glb.primitives)
+	{
+		GLuint vao = 0;
+		for (size_t i = 0; i < arrays.size() && vao == 0; i++)
+		{
+			if (SameGlbVertices(*arrayPrimitives[i], primitive))
+				vao = arrays[i];
+		}
+		if (vao == 0)
+		{
+			glGenVertexArrays(1, &vao);
+			glBindVertexArray(vao);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, (GLsizei)primitive.position.stride, (void*)primitive.position.offset);
+			glEnableVertexAttribArray(0);
+			if (primitive.normal.count > 0)
+			{
+				glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, (GLsizei)primitive.normal.stride, (void*)primitive.normal.offset);
+				glEnableVertexAttribArray(2);
+			}
+			if (primitive.uv.count > 0)
+			{
+				glVertexAttribPointer(3, 2, GltfComponentGLType(primitive.uv.componentType), primitive.uv.normalized ? GL_TRUE : GL_FALSE,
+					(GLsizei)primitive.uv.stride, (void*)primitive.uv.offset);
+				glEnableVertexAttribArray(3);
+			}
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.VBO);
+			arrays.push_back(vao);
+			arrayPrimitives.push_back(&primitive);
+		}
+
+		SubMesh submesh;
+		submesh.name = primitive.name;
+		submesh.materialIndex = primitive.materialIndex;
+		if (submesh.materialIndex >= 0)
+			submesh.material = glb.materials[submesh.materialIndex].name;
+		submesh.firstIndex = (unsigned int)(primitive.indices.offset / indexSize);
+		submesh.indexCount = (unsigned int)(primitive.indices.count - primitive.indices.count % 3);
+		submesh.boundsMin = primitive.position.boundsMin;
+		submesh.boundsMax = primitive.position.boundsMax;
+		submesh.center = (submesh.boundsMin + submesh.boundsMax) * 0.5f;
+		submesh.radius = glm::length(submesh.boundsMax - submesh.boundsMin) * 0.5f;
+		buffer.boundsMin = buffer.submeshes.empty() ? submesh.boundsMin : glm::min(buffer.boundsMin, submesh.boundsMin);
+		buffer.boundsMax = buffer.submeshes.empty() ? submesh.boundsMax : glm::max(buffer.boundsMax, submesh.boundsMax);
+		buffer.submeshes.push_back(submesh);
+
+		MeshDraw draw;
+		draw.firstIndex = submesh.firstIndex;
+		draw.indexCount = submesh.indexCount;
+		draw.materialSlot = submesh.materialIndex >= 0 ? slots[submesh.materialIndex] : 0;
+		draw.VAO = vao;
+		buffer.draws.push_back(draw);
+		buffer.indexCount += (GLsizei)draw.indexCount;
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	buffer.VAO = arrays[0];
+	SetPositionDequantization(buffer);
+	// glTF puts the texture origin at the top left; the shader flips v rather than the data
+	buffer.texCoordScale = glm::vec2(1.f, -1.f);
+	buffer.texCoordOffset = glm::vec2(0.f, 1.f);
+	printf("LoadGlbMesh - %s primitives=%zu vertex arrays=%zu json=%.1f KB bin=%.1f KB\n", filePath.c_str(), glb.primitives.size(),
+		arrays.size(), glb.jsonSize / 1024.0, glb.binSize / 1024.0);
+	CloseGlbFile(glb);
+	return buffer;
+}
+
+/**
+ * @brief Collects the index ranges one draw of a mesh needs at a level of detail.
+ *
+ * With a cull view and level 0 only the visible meshlets are kept, adjacent ones merged into
+ * one range. Meshlets only cover level 0; other levels and unculled draws give their whole range.
+ *
+ * @param buffer The mesh the draw belongs to.
+ * @param draw The draw.
+ * @param cull Frustum and camera from MakeMeshCullView, or nullptr to keep everything.
+ * @param lod Level of detail, already clamped to the levels of the mesh.
+ * @param ranges Receives the ranges; appended to.
+ */
+void CollectDrawRanges(const MeshBuffer& buffer, const MeshDraw& draw, const MeshCullView* cull, int lod, ArenaVector<IndexRange>& ranges)
+{
+	if (lod > 0)
+	{
+		if (draw.lods[lod - 1].indexCount > 0)
+			ranges.push_back(draw.lods[lod - 1]);
+		return;
+	}
+	if (cull == nullptr || draw.meshletCount == 0)
+	{
+		IndexRange range = { draw.firstIndex, draw.indexCount };
+		ranges.push_back(range);
+		return;
+	}
+
+	size_t first = ranges.size();
+	for (unsigned int i = draw.firstMeshlet; i < draw.firstMeshlet + draw.meshletCount; i++)
+	{
+		const Meshlet& meshlet = buffer.meshlets[i];
+		if (!MeshletVisible(*cull, meshlet))
+			continue;
+		if (ranges.size() > first && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+		{
+			ranges.back().indexCount += meshlet.indexCount;
+		}
+		else
+		{
+			IndexRange range = { meshlet.firstIndex, meshlet.indexCount };
+			ranges.push_back(range);
+		}
+	}
+}
+
+/**
+ * @brief Draws a mesh, one glDrawElements per material run.
+ *
+ * With a cull view only the visible meshlets of each run are drawn: adjacent visible meshlets
+ * are merged into one range and the ranges go out in a single glMultiDrawElements. Meshlets
+ * only cover level 0; coarser levels are drawn whole once the mesh bounds pass the frustum test.
+ *
+ * @param buffer The mesh to draw.
+ * @param locations Uniform locations in the bound program.
+ * @param cull Frustum and camera from MakeMeshCullView, or nullptr to draw everything.
+ * @param lod Level of detail to draw, clamped to the levels the mesh has.
+ */
+void DrawMesh(const MeshBuffer& buffer, const MeshShaderLocations& locations, const MeshCullView* cull = nullptr, int lod = 0)
+{
+	lod = std::max(0, std::min(lod, buffer.lodCount - 1));
+	if (lod > 0 && cull != nullptr
+		&& !SphereInFrustum(*cull, (buffer.boundsMin + buffer.boundsMax) * 0.5f, glm::length(buffer.boundsMax - buffer.boundsMin) * 0.5f))
+		return;
+
+	ArenaScope scope;
+	ArenaVector<IndexRange> ranges;
+	ArenaVector<GLsizei> counts;
+	ArenaVector<const void*> offsets;
+	size_t indexSize = buffer.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	glUniform3fv(locations.positionScale, 1, &buffer.positionScale.x);
+	glUniform3fv(locations.positionOffset, 1, &buffer.positionOffset.x);
+	glUniform2fv(locations.texCoordScale, 1, &buffer.texCoordScale.x);
+	glUniform2fv(locations.texCoordOffset, 1, &buffer.texCoordOffset.x);
+	glBindVertexArray(buffer.VAO);
+	for (const MeshDraw& draw : buffer.draws)
+	{
+		if (draw.VAO != 0)
+			glBindVertexArray(draw.VAO);
+		if (buffer.EBO == 0)
+		{
+			glUniform1i(locations.materialIndex, draw.materialSlot);
+			glDrawArrays(GL_TRIANGLES, (GLint)draw.firstIndex, (GLsizei)draw.indexCount);
+			continue;
+		}
+
+		ranges.clear();
+		CollectDrawRanges(buffer, draw, cull, lod, ranges);
+		if (ranges.empty())
+			continue;
+		glUniform1i(locations.materialIndex, draw.materialSlot);
+		if (ranges.size() == 1)
+		{
+			glDrawElements(GL_TRIANGLES, (GLsizei)ranges[0].indexCount, buffer.indexType, (void*)(ranges[0].firstIndex * indexSize));
+			continue;
+		}
+		counts.clear();
+		offsets.clear();
+		for (const IndexRange& range : ranges)
+		{
+			counts.push_back((GLsizei)range.indexCount);
+			offsets.push_back((const void*)(range.firstIndex * indexSize));
+		}
+		glMultiDrawElements(GL_TRIANGLES, counts.data(), buffer.indexType, offsets.data(), (GLsizei)counts.size());
+	}
+}
+
+/**
+ * @brief DrawMesh for one instance: culled against its frustum and camera, at the level of detail its screen size calls for.
+ *
+ * @param buffer The mesh to draw.
+ * @param locations Uniform locations in the bound program.
+ * @param viewProjection The projection matrix times the view matrix.
+ * @param model The model matrix of the draw.
+ * @param cameraPosition The camera position in world space.
+ * @param lodState The instance's level for SelectMeshLod; nullptr uses the buffer's own, which is enough for a mesh drawn once per frame.
+ */
+void DrawMesh(const MeshBuffer& buffer, const MeshShaderLocations& locations, const glm::mat4& viewProjection,
+	const glm::mat4& model, const glm::vec3& cameraPosition, MeshLodState* lodState = nullptr)
+{
+	MeshCullView cull = MakeMeshCullView(viewProjection, model, cameraPosition);
+	float pixelsPerUnit = ProjectedPixelsPerUnit(viewProjection, model, (buffer.boundsMin + buffer.boundsMax) * 0.5f,
+		glm::length(buffer.boundsMax - buffer.boundsMin) * 0.5f);
+	int lod = SelectMeshLod(buffer.lodErrors, buffer.lodCount, pixelsPerUnit, lodState != nullptr ? *lodState : buffer.lodState);
+	DrawMesh(buffer, locations, &cull, lod);
+}
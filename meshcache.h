@@ -0,0 +1,553 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "contentcache.h"
+#include "mesh.h"
+
+// Bump whenever the layout or the processing that produces the cached data changes
+const uint32_t MESH_CACHE_VERSION = 9;
+
+// On-disk header; the submesh, material, meshlet and dependency tables, string table, vertex data and index data follow at the given offsets
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	SourceStamp source;
+	uint32_t vertexStride; // bytes per vertex
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize; // 2 or 4 bytes
+	uint32_t submeshCount;
+	uint32_t materialCount;
+	uint32_t dependencyCount;
+	uint32_t meshletCount;
+	uint32_t vertexFormat; // VertexFormat
+	float boundsMin[3];
+	float boundsMax[3];
+	uint32_t lodCount;
+	float lodErrors[MESH_MAX_LODS];
+	uint64_t submeshOffset;
+	uint64_t materialOffset;
+	uint64_t meshletOffset;
+	uint64_t dependencyOffset;
+	uint64_t stringOffset;
+	uint64_t stringSize;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+};
+
+struct MeshCacheSubMesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t nameOffset; // NUL-terminated, relative to the string table
+	uint32_t materialOffset;
+	int32_t materialIndex;
+	float boundsMin[3];
+	float boundsMax[3];
+	float center[3];
+	float radius;
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	uint32_t lods[MESH_MAX_LODS - 1][2]; // first index and index count of levels 1 and up
+};
+
+struct MeshCacheMaterial
+{
+	uint32_t nameOffset;
+	float diffuse[3];
+	float specular[3];
+	float emissive[3];
+	float shininess;
+};
+
+struct MeshCacheMeshlet
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float center[3];
+	float radius;
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+// Another file the mesh was built from; the entry is stale when it changes
+struct MeshCacheDependency
+{
+	uint32_t pathOffset;
+	uint32_t relative; // 1 if the path is relative to the directory of the source
+	SourceStamp stamp;
+};
+
+// Pointers into a mapped cache file, valid until the file is unmapped
+struct MeshCacheView
+{
+	const MeshCacheHeader* header = nullptr;
+	const MeshCacheSubMesh* submeshes = nullptr;
+	const MeshCacheMaterial* materials = nullptr;
+	const MeshCacheMeshlet* meshlets = nullptr;
+	const MeshCacheDependency* dependencies = nullptr;
+	const char* strings = nullptr;
+	const void* vertices = nullptr;
+	const void* indices = nullptr;
+};
+
+uint64_t AlignCacheOffset(uint64_t offset)
+{
+	return (offset + 15) & ~(uint64_t)15;
+}
+
+// True if count items of itemSize bytes at offset lie inside a file of fileSize bytes, aligned for
+// reading in place; written so that no sum can overflow
+bool MeshCacheTableFits(uint64_t offset, uint64_t count, uint64_t itemSize, uint64_t fileSize)
+{
+	return offset <= fileSize && offset % 4 == 0 && (fileSize - offset) / itemSize >= count;
+}
+
+// True if an index range lies inside the index buffer
+bool MeshCacheRangeFits(uint32_t first, uint32_t count, uint32_t total)
+{
+	return first <= total && total - first >= count;
+}
+
+/**
+ * @brief Checks that every table of a mapped entry lies inside the file and refers only to data that exists.
+ *
+ * Every string the tables name must start inside the string table, which must end in a NUL,
+ * every index and meshlet range must lie inside its buffer, and every index must address a
+ * vertex. Dependency stamps are not checked.
+ *
+ * @param file The mapped entry.
+ * @param format The vertex layout the caller wants.
+ * @return False if the entry is truncated, corrupt or of another version or layout.
+ */
+bool MeshCacheLayoutValid(const MappedFile& file, VertexFormat format)
+{
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.data;
+	if (file.size < sizeof(MeshCacheHeader) || memcmp(header->magic, "MSHC", 4) != 0 || header->version != MESH_CACHE_VERSION
+		|| header->lodCount < 1 || header->lodCount > MESH_MAX_LODS || header->vertexFormat != (uint32_t)format
+		|| header->vertexStride != VertexFormatSize(format) || (header->indexSize != 2 && header->indexSize != 4)
+		|| !MeshCacheTableFits(header->submeshOffset, header->submeshCount, sizeof(MeshCacheSubMesh), file.size)
+		|| !MeshCacheTableFits(header->materialOffset, header->materialCount, sizeof(MeshCacheMaterial), file.size)
+		|| !MeshCacheTableFits(header->meshletOffset, header->meshletCount, sizeof(MeshCacheMeshlet), file.size)
+		|| !MeshCacheTableFits(header->dependencyOffset, header->dependencyCount, sizeof(MeshCacheDependency), file.size)
+		|| !MeshCacheTableFits(header->vertexOffset, header->vertexCount, header->vertexStride, file.size)
+		|| !MeshCacheTableFits(header->indexOffset, header->indexCount, header->indexSize, file.size)
+		|| header->stringOffset > file.size || file.size - header->stringOffset < header->stringSize
+		|| (header->stringSize > 0 && file.data[header->stringOffset + header->stringSize - 1] != '\0'))
+		return false;
+
+	const MeshCacheSubMesh* submeshes = (const MeshCacheSubMesh*)(file.data + header->submeshOffset);
+	for (uint32_t i = 0; i < header->submeshCount; i++)
+	{
+		const MeshCacheSubMesh& submesh = submeshes[i];
+		if (submesh.nameOffset >= header->stringSize || submesh.materialOffset >= header->stringSize
+			|| !MeshCacheRangeFits(submesh.firstIndex, submesh.indexCount, header->indexCount)
+			|| !MeshCacheRangeFits(submesh.firstMeshlet, submesh.meshletCount, header->meshletCount))
+			return false;
+		for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+		{
+			if (!MeshCacheRangeFits(submesh.lods[level][0], submesh.lods[level][1], header->indexCount))
+				return false;
+		}
+	}
+	const MeshCacheMaterial* materials = (const MeshCacheMaterial*)(file.data + header->materialOffset);
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		if (materials[i].nameOffset >= header->stringSize)
+			return false;
+	}
+	const MeshCacheMeshlet* meshlets = (const MeshCacheMeshlet*)(file.data + header->meshletOffset);
+	for (uint32_t i = 0; i < header->meshletCount; i++)
+	{
+		if (!MeshCacheRangeFits(meshlets[i].firstIndex, meshlets[i].indexCount, header->indexCount))
+			return false;
+	}
+	const MeshCacheDependency* dependencies = (const MeshCacheDependency*)(file.data + header->dependencyOffset);
+	for (uint32_t i = 0; i < header->dependencyCount; i++)
+	{
+		if (dependencies[i].pathOffset >= header->stringSize)
+			return false;
+	}
+
+	// An index past the vertices would make the GPU read outside the vertex buffer
+	uint32_t maxIndex = 0;
+	if (header->indexSize == 2)
+	{
+		const uint16_t* indices = (const uint16_t*)(file.data + header->indexOffset);
+		for (uint32_t i = 0; i < header->indexCount; i++)
+			maxIndex = std::max<uint32_t>(maxIndex, indices[i]);
+	}
+	else
+	{
+		const uint32_t* indices = (const uint32_t*)(file.data + header->indexOffset);
+		for (uint32_t i = 0; i < header->indexCount; i++)
+			maxIndex = std::max(maxIndex, indices[i]);
+	}
+	return header->indexCount == 0 || maxIndex < header->vertexCount;
+}
+
+// Path of dependency i of an entry, as seen from the source at sourcePath
+std::string MeshCacheDependencyPath(const MeshCacheView& view, uint32_t i, const std::string& sourcePath)
+{
+	const MeshCacheDependency& dependency = view.dependencies[i];
+	const char* path = view.strings + dependency.pathOffset;
+	return dependency.relative != 0 ? DirectoryOf(sourcePath) + path : std::string(path);
+}
+
+/**
+ * @brief Rewrites a cache entry with new dependency stamps, for dependencies that matched only by content.
+ *
+ * Without this a dependency that was touched but not changed is hashed on every load. The
+ * mapping stays valid: the entry is replaced with a rename, as WriteMeshCache does.
+ *
+ * @param path The path of the entry.
+ * @param file The mapped entry, checked with MeshCacheLayoutValid.
+ * @param stamps The stamp of every dependency, in table order.
+ */
+void RestampMeshCache(const std::string& path, const MappedFile& file, const SourceStamp* stamps)
+{
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.data;
+	std::vector<char> data(file.data, file.data + file.size);
+	MeshCacheDependency* dependencies = (MeshCacheDependency*)(data.data() + header->dependencyOffset);
+	for (uint32_t i = 0; i < header->dependencyCount; i++)
+		dependencies[i].stamp = stamps[i];
+
+	std::error_code ec;
+	std::string tempPath = CacheTempPath(path);
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == NULL)
+		return;
+	bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+	written = fclose(f) == 0 && written;
+	if (written)
+		std::filesystem::rename(tempPath, path, ec);
+	if (!written || ec)
+		std::filesystem::remove(tempPath, ec);
+}
+
+/**
+ * @brief Maps the cache entry of a source's contents and checks that it is still valid.
+ *
+ * Entries are shared by every source with the same bytes. An entry is valid for a source when
+ * each dependency, looked up next to that source if it was next to the one the entry was built
+ * from, matches its stamp (see SourceStampMatches). The layout is checked first with
+ * MeshCacheLayoutValid, so a truncated or corrupt entry is rejected rather than read.
+ *
+ * @param sourcePath The source to load.
+ * @param key The content key of the source, from ContentKeyOf.
+ * @param format The vertex layout the caller wants; entries in another layout are rejected.
+ * @param file Receives the mapping, which must stay open while view is used.
+ * @param view Receives pointers to the cached data.
+ * @return False if there is no usable entry.
+ */
+bool OpenMeshCache(const std::string& sourcePath, uint64_t key, VertexFormat format, MappedFile& file, MeshCacheView& view)
+{
+	std::string path = ContentCachePath(key, "mesh");
+	if (!MapFile(path.c_str(), file))
+		return false;
+
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.data;
+	bool valid = MeshCacheLayoutValid(file, format) && header->source.hash == key;
+	view.dependencies = (const MeshCacheDependency*)(file.data + (valid ? header->dependencyOffset : 0));
+	view.strings = file.data + (valid ? header->stringOffset : 0);
+	std::vector<SourceStamp> stamps;
+	bool restamped = false;
+	for (uint32_t i = 0; valid && i < header->dependencyCount; i++)
+	{
+		stamps.push_back(view.dependencies[i].stamp);
+		valid = SourceStampMatches(MeshCacheDependencyPath(view, i, sourcePath), view.dependencies[i].stamp, &stamps.back());
+		restamped = restamped || stamps.back().time != view.dependencies[i].stamp.time;
+	}
+	if (valid && restamped && !file.archived)
+		RestampMeshCache(path, file, stamps.data());
+	if (!valid)
+	{
+		UnmapFile(file);
+		return false;
+	}
+
+	view.header = header;
+	view.submeshes = (const MeshCacheSubMesh*)(file.data + header->submeshOffset);
+	view.materials = (const MeshCacheMaterial*)(file.data + header->materialOffset);
+	view.meshlets = (const MeshCacheMeshlet*)(file.data + header->meshletOffset);
+	view.vertices = file.data + header->vertexOffset;
+	view.indices = file.data + header->indexOffset;
+	return true;
+}
+
+/**
+ * @brief Writes the cache entry for a source's contents, replacing any previous one atomically.
+ *
+ * Dependencies in the directory of the source, or below it, are stored relative to it, so a copy
+ * of the source and its MTL files elsewhere finds the same entry valid.
+ *
+ * @param sourcePath The source the mesh was built from.
+ * @param key The content key of the source, from ContentKeyOf.
+ * @param mesh The processed mesh.
+ * @param format The vertex layout to store.
+ * @return False if the entry could not be written.
+ */
+bool WriteMeshCache(const std::string& sourcePath, uint64_t key, const Mesh& mesh, VertexFormat format)
+{
+	ArenaScope scope;
+	MeshCacheHeader header = {};
+	memcpy(header.magic, "MSHC", 4);
+	header.version = MESH_CACHE_VERSION;
+	if (!StampSourceFile(sourcePath, false, header.source))
+		return false;
+	header.source.hash = key;
+	header.vertexFormat = (uint32_t)format;
+	header.vertexStride = (uint32_t)VertexFormatSize(format);
+	header.vertexCount = (uint32_t)MeshVertexCount(mesh);
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.indexSize = MeshUsesShortIndices(mesh) ? 2 : 4;
+	header.submeshCount = (uint32_t)mesh.submeshes.size();
+	header.materialCount = (uint32_t)mesh.materials.size();
+	header.dependencyCount = (uint32_t)mesh.dependencies.size();
+	header.meshletCount = (uint32_t)mesh.meshlets.size();
+	memcpy(header.boundsMin, &mesh.boundsMin.x, sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &mesh.boundsMax.x, sizeof(header.boundsMax));
+	header.lodCount = (uint32_t)mesh.lodCount;
+	memcpy(header.lodErrors, mesh.lodErrors, sizeof(header.lodErrors));
+
+	std::vector<MeshCacheSubMesh> submeshes(mesh.submeshes.size());
+	std::string strings;
+	for (size_t i = 0; i < submeshes.size(); i++)
+	{
+		const SubMesh& in = mesh.submeshes[i];
+		MeshCacheSubMesh& out = submeshes[i];
+		out.firstIndex = in.firstIndex;
+		out.indexCount = in.indexCount;
+		out.nameOffset = (uint32_t)strings.size();
+		strings.append(in.name.c_str(), in.name.size() + 1);
+		out.materialOffset = (uint32_t)strings.size();
+		strings.append(in.material.c_str(), in.material.size() + 1);
+		out.materialIndex = in.materialIndex;
+		memcpy(out.boundsMin, &in.boundsMin.x, sizeof(out.boundsMin));
+		memcpy(out.boundsMax, &in.boundsMax.x, sizeof(out.boundsMax));
+		memcpy(out.center, &in.center.x, sizeof(out.center));
+		out.radius = in.radius;
+		out.firstMeshlet = in.firstMeshlet;
+		out.meshletCount = in.meshletCount;
+		for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+		{
+			out.lods[level][0] = in.lods[level].firstIndex;
+			out.lods[level][1] = in.lods[level].indexCount;
+		}
+	}
+
+	std::vector<MeshCacheMaterial> materials(mesh.materials.size());
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		const Material& in = mesh.materials[i];
+		MeshCacheMaterial& out = materials[i];
+		out.nameOffset = (uint32_t)strings.size();
+		strings.append(in.name.c_str(), in.name.size() + 1);
+		memcpy(out.diffuse, &in.diffuse.x, sizeof(out.diffuse));
+		memcpy(out.specular, &in.specular.x, sizeof(out.specular));
+		memcpy(out.emissive, &in.emissive.x, sizeof(out.emissive));
+		out.shininess = in.shininess;
+	}
+
+	std::vector<MeshCacheMeshlet> meshlets(mesh.meshlets.size());
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet& in = mesh.meshlets[i];
+		MeshCacheMeshlet& out = meshlets[i];
+		out.firstIndex = in.firstIndex;
+		out.indexCount = in.indexCount;
+		memcpy(out.center, &in.center.x, sizeof(out.center));
+		out.radius = in.radius;
+		memcpy(out.coneAxis, &in.coneAxis.x, sizeof(out.coneAxis));
+		out.coneCutoff = in.coneCutoff;
+	}
+
+	std::vector<MeshCacheDependency> dependencies(mesh.dependencies.size());
+	std::string directory = DirectoryOf(sourcePath);
+	for (size_t i = 0; i < dependencies.size(); i++)
+	{
+		const std::string& path = mesh.dependencies[i];
+		bool relative = !directory.empty() && path.compare(0, directory.size(), directory) == 0;
+		std::string stored = relative ? path.substr(directory.size()) : path;
+		dependencies[i].pathOffset = (uint32_t)strings.size();
+		dependencies[i].relative = relative ? 1 : 0;
+		strings.append(stored.c_str(), stored.size() + 1);
+		if (!StampSourceFile(path, true, dependencies[i].stamp))
+			return false;
+	}
+
+	header.submeshOffset = AlignCacheOffset(sizeof(header));
+	header.materialOffset = AlignCacheOffset(header.submeshOffset + header.submeshCount * sizeof(MeshCacheSubMesh));
+	header.meshletOffset = AlignCacheOffset(header.materialOffset + header.materialCount * sizeof(MeshCacheMaterial));
+	header.dependencyOffset = AlignCacheOffset(header.meshletOffset + header.meshletCount * sizeof(MeshCacheMeshlet));
+	header.stringOffset = header.dependencyOffset + header.dependencyCount * sizeof(MeshCacheDependency);
+	header.stringSize = strings.size();
+	header.vertexOffset = AlignCacheOffset(header.stringOffset + header.stringSize);
+	header.indexOffset = AlignCacheOffset(header.vertexOffset + (uint64_t)header.vertexCount * header.vertexStride);
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_DIR, ec);
+	std::string path = ContentCachePath(key, "mesh");
+	std::string tempPath = CacheTempPath(path);
+	bool written = false;
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		const char padding[16] = {};
+		auto writeAt = [&](uint64_t offset, const void* data, size_t size)
+		{
+			uint64_t position = (uint64_t)out.tellp();
+			out.write(padding, (std::streamsize)(offset - position));
+			out.write((const char*)data, (std::streamsize)size);
+		};
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.submeshOffset, submeshes.data(), submeshes.size() * sizeof(MeshCacheSubMesh));
+		writeAt(header.materialOffset, materials.data(), materials.size() * sizeof(MeshCacheMaterial));
+		writeAt(header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(MeshCacheMeshlet));
+		writeAt(header.dependencyOffset, dependencies.data(), dependencies.size() * sizeof(MeshCacheDependency));
+		writeAt(header.stringOffset, strings.data(), strings.size());
+		if (format == VERTEX_FORMAT_PACKED)
+		{
+			ArenaVector<PackedVertex> packed = PackMeshVertices(mesh);
+			writeAt(header.vertexOffset, packed.data(), packed.size() * sizeof(PackedVertex));
+		}
+		else
+		{
+			writeAt(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(float));
+		}
+		if (header.indexSize == 2)
+		{
+			ArenaVector<unsigned short> shortIndices = NarrowIndices(mesh.indices);
+			writeAt(header.indexOffset, shortIndices.data(), shortIndices.size() * sizeof(unsigned short));
+		}
+		else
+		{
+			writeAt(header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+		}
+		out.close();
+		written = !out.fail();
+	}
+	if (written)
+		std::filesystem::rename(tempPath, path, ec);
+	if (!written || ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Rebuilds the submesh, meshlet and material tables and the bounds of a cache entry.
+ *
+ * @param view The mapped cache entry.
+ * @param submeshes Receives the submesh table.
+ * @param meshlets Receives the meshlets of the submeshes.
+ * @param materials Receives the materials the submeshes refer to.
+ * @param boundsMin Receives the minimum corner of the mesh bounds.
+ * @param boundsMax Receives the maximum corner of the mesh bounds.
+ */
+void ReadMeshCacheSubMeshes(const MeshCacheView& view, std::vector<SubMesh>& submeshes, std::vector<Meshlet>& meshlets,
+	std::vector<Material>& materials, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	const MeshCacheHeader* header = view.header;
+	boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	submeshes.resize(header->submeshCount);
+	for (uint32_t i = 0; i < header->submeshCount; i++)
+	{
+		const MeshCacheSubMesh& in = view.submeshes[i];
+		SubMesh& out = submeshes[i];
+		out.name = view.strings + in.nameOffset;
+		out.material = view.strings + in.materialOffset;
+		out.materialIndex = in.materialIndex;
+		out.firstIndex = in.firstIndex;
+		out.indexCount = in.indexCount;
+		out.boundsMin = glm::vec3(in.boundsMin[0], in.boundsMin[1], in.boundsMin[2]);
+		out.boundsMax = glm::vec3(in.boundsMax[0], in.boundsMax[1], in.boundsMax[2]);
+		out.center = glm::vec3(in.center[0], in.center[1], in.center[2]);
+		out.radius = in.radius;
+		out.firstMeshlet = in.firstMeshlet;
+		out.meshletCount = in.meshletCount;
+		for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+		{
+			out.lods[level].firstIndex = in.lods[level][0];
+			out.lods[level].indexCount = in.lods[level][1];
+		}
+	}
+	meshlets.resize(header->meshletCount);
+	for (uint32_t i = 0; i < header->meshletCount; i++)
+	{
+		const MeshCacheMeshlet& in = view.meshlets[i];
+		Meshlet& out = meshlets[i];
+		out.firstIndex = in.firstIndex;
+		out.indexCount = in.indexCount;
+		out.center = glm::vec3(in.center[0], in.center[1], in.center[2]);
+		out.radius = in.radius;
+		out.coneAxis = glm::vec3(in.coneAxis[0], in.coneAxis[1], in.coneAxis[2]);
+		out.coneCutoff = in.coneCutoff;
+	}
+	materials.resize(header->materialCount);
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		const MeshCacheMaterial& in = view.materials[i];
+		Material& out = materials[i];
+		out.name = view.strings + in.nameOffset;
+		out.diffuse = glm::vec3(in.diffuse[0], in.diffuse[1], in.diffuse[2]);
+		out.specular = glm::vec3(in.specular[0], in.specular[1], in.specular[2]);
+		out.emissive = glm::vec3(in.emissive[0], in.emissive[1], in.emissive[2]);
+		out.shininess = in.shininess;
+	}
+}
+
+/**
+ * @brief Decodes a whole cache entry back into a Mesh, e.g. to merge it with other meshes.
+ *
+ * Packed vertices are unpacked to floats, so positions come back to within their quantization step.
+ *
+ * @param view The mapped cache entry.
+ * @param sourcePath The source the entry was opened for, which relative dependencies are next to.
+ * @param mesh Receives the mesh.
+ */
+void ReadMeshCache(const MeshCacheView& view, const std::string& sourcePath, Mesh& mesh)
+{
+	const MeshCacheHeader* header = view.header;
+	ReadMeshCacheSubMeshes(view, mesh.submeshes, mesh.meshlets, mesh.materials, mesh.boundsMin, mesh.boundsMax);
+	mesh.lodCount = (int)header->lodCount;
+	memcpy(mesh.lodErrors, header->lodErrors, sizeof(mesh.lodErrors));
+	mesh.dependencies.clear();
+	for (uint32_t i = 0; i < header->dependencyCount; i++)
+		mesh.dependencies.push_back(MeshCacheDependencyPath(view, i, sourcePath));
+
+	mesh.vertices.resize((size_t)header->vertexCount * MESH_VERTEX_STRIDE);
+	if (header->vertexFormat == VERTEX_FORMAT_PACKED)
+	{
+		const PackedVertex* packed = (const PackedVertex*)view.vertices;
+		for (uint32_t v = 0; v < header->vertexCount; v++)
+			UnpackVertex(packed[v], mesh.boundsMin, mesh.boundsMax, mesh.vertices.data() + (size_t)v * MESH_VERTEX_STRIDE);
+	}
+	else
+	{
+		memcpy(mesh.vertices.data(), view.vertices, mesh.vertices.size() * sizeof(float));
+	}
+
+	mesh.indices.resize(header->indexCount);
+	if (header->indexSize == 2)
+	{
+		const unsigned short* indices = (const unsigned short*)view.indices;
+		for (uint32_t i = 0; i < header->indexCount; i++)
+			mesh.indices[i] = indices[i];
+	}
+	else
+	{
+		memcpy(mesh.indices.data(), view.indices, mesh.indices.size() * sizeof(unsigned int));
+	}
+}
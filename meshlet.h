@@ -0,0 +1,381 @@
+#pragma once
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "arena.h"
+#include "mesh.h"
+#include "meshoptimize.h"
+
+// Meshlet limits; 64 vertices and 124 triangles keep a meshlet within the usual mesh shader budgets
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+// How much BuildMeshlets favours narrow normal cones over compact bounding spheres, 0 to 1
+const float MESHLET_CONE_WEIGHT = 0.75f;
+
+// Back-face culling of whole meshlets. Off by default: the renderer leaves GL_CULL_FACE off,
+// so the inside of open parts can be visible and culling it would change the image.
+bool meshletBackfaceCulling = false;
+
+// Meshlets tested and culled by MeshletVisible since the counters were last cleared
+struct MeshletCounters
+{
+	size_t tested = 0;
+	size_t culled = 0;
+};
+
+MeshletCounters meshletCounters;
+
+// Frustum and camera of one draw in the object space of the mesh (see MakeMeshCullView)
+struct MeshCullView
+{
+	glm::vec4 planes[6]; // normalized, inside where dot(xyz, p) + w >= 0
+	glm::vec3 cameraPosition = glm::vec3(0.f);
+	bool backfaces = false;
+};
+
+/**
+ * @brief Computes the bounding sphere and normal cone of a meshlet.
+ *
+ * The cone axis is the average triangle normal and the cutoff the sine of the widest angle
+ * between it and a triangle normal. Cones wider than about 84 degrees are not worth testing
+ * and get a cutoff of 1.
+ *
+ * @param mesh The mesh the meshlet indexes.
+ * @param meshlet The meshlet to update; firstIndex and indexCount must be set.
+ */
+void ComputeMeshletBounds(const Mesh& mesh, Meshlet& meshlet)
+{
+	const float* vertices = mesh.vertices.data();
+	const unsigned int* indices = mesh.indices.data() + meshlet.firstIndex;
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (unsigned int i = 0; i < meshlet.indexCount; i++)
+	{
+		glm::vec3 p = glm::make_vec3(vertices + indices[i] * MESH_VERTEX_STRIDE);
+		boundsMin = glm::min(boundsMin, p);
+		boundsMax = glm::max(boundsMax, p);
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	float radius2 = 0.f;
+	glm::vec3 normalSum(0.f);
+	for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+	{
+		glm::vec3 a = glm::make_vec3(vertices + indices[i] * MESH_VERTEX_STRIDE);
+		glm::vec3 b = glm::make_vec3(vertices + indices[i + 1] * MESH_VERTEX_STRIDE);
+		glm::vec3 c = glm::make_vec3(vertices + indices[i + 2] * MESH_VERTEX_STRIDE);
+		radius2 = glm::max(radius2, glm::max(glm::dot(a - meshlet.center, a - meshlet.center),
+			glm::max(glm::dot(b - meshlet.center, b - meshlet.center), glm::dot(c - meshlet.center, c - meshlet.center))));
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float length = glm::length(normal);
+		if (length > 0.f)
+			normalSum += normal / length;
+	}
+	meshlet.radius = sqrtf(radius2);
+
+	meshlet.coneAxis = glm::vec3(0.f);
+	meshlet.coneCutoff = 1.f;
+	float axisLength = glm::length(normalSum);
+	if (axisLength <= 0.f)
+		return;
+	glm::vec3 axis = normalSum / axisLength;
+	float minDot = 1.f;
+	for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+	{
+		glm::vec3 a = glm::make_vec3(vertices + indices[i] * MESH_VERTEX_STRIDE);
+		glm::vec3 b = glm::make_vec3(vertices + indices[i + 1] * MESH_VERTEX_STRIDE);
+		glm::vec3 c = glm::make_vec3(vertices + indices[i + 2] * MESH_VERTEX_STRIDE);
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float length = glm::length(normal);
+		if (length > 0.f)
+			minDot = glm::min(minDot, glm::dot(axis, normal / length));
+	}
+	meshlet.coneAxis = axis;
+	if (minDot > 0.1f)
+		meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+}
+
+// Pairs local vertices at the same position, so triangles of faceted meshes find their neighbours
+void WeldLocalPositions(const LocalIndexRange& local, ArenaVector<unsigned int>& positionId)
+{
+	size_t count = local.globalId.size();
+	ArenaVector<unsigned int> order(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = (unsigned int)i;
+	const float* p = local.positions.data();
+	std::sort(order.begin(), order.end(), [p](unsigned int a, unsigned int b) { return memcmp(p + a * 3, p + b * 3, 3 * sizeof(float)) < 0; });
+	positionId.assign(count, 0);
+	unsigned int id = 0;
+	for (size_t i = 1; i < count; i++)
+	{
+		if (memcmp(p + order[i] * 3, p + order[i - 1] * 3, 3 * sizeof(float)) != 0)
+			id++;
+		positionId[order[i]] = id;
+	}
+}
+
+/**
+ * @brief Splits every submesh into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles.
+ *
+ * A meshlet grows from a seed triangle by adding the neighbouring triangle (sharing a vertex
+ * position) that adds the fewest vertices, then the one closest to the meshlet and to its
+ * average normal, which keeps the bounding spheres small and the normal cones narrow. When it
+ * runs out of neighbours it continues with the next unused triangle if that is close by.
+ *
+ * The triangles of each submesh are reordered into meshlet order, the meshlets sorted for
+ * overdraw, the triangles of each meshlet reordered for the vertex cache and the vertices
+ * renumbered for fetch, so run it after OptimizeMesh. Meshlets are
+ * consecutive runs of the index buffer and can be drawn as plain index ranges.
+ *
+ * @param mesh The mesh; fills mesh.meshlets and the meshlet range of every submesh.
+ */
+void BuildMeshlets(Mesh& mesh)
+{
+	ArenaScope scope;
+	mesh.meshlets.clear();
+	size_t indexCount = mesh.indices.size();
+	LocalIndexRange local(MeshVertexCount(mesh), indexCount);
+	ArenaVector<unsigned int> positionId, offsets, adjacency, vertexStamp, candidateStamp, candidates, order, starts;
+	ArenaVector<glm::vec3> centroids, normals;
+	ArenaVector<char> used;
+	for (SubMesh& submesh : mesh.submeshes)
+	{
+		submesh.firstMeshlet = (unsigned int)mesh.meshlets.size();
+		submesh.meshletCount = 0;
+		size_t triangleCount = submesh.indexCount / 3;
+		if (triangleCount == 0)
+			continue;
+		local.Gather(mesh, submesh.firstIndex, triangleCount * 3);
+		const unsigned int* indices = local.indices.data();
+		const float* positions = local.positions.data();
+
+		// Triangles around every welded position
+		WeldLocalPositions(local, positionId);
+		size_t positionCount = positionId.empty() ? 0 : *std::max_element(positionId.begin(), positionId.end()) + 1;
+		offsets.assign(positionCount + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			offsets[positionId[indices[i]] + 1]++;
+		for (size_t i = 0; i < positionCount; i++)
+			offsets[i + 1] += offsets[i];
+		adjacency.resize(triangleCount * 3);
+		{
+			ArenaVector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < triangleCount * 3; i++)
+				adjacency[fill[positionId[indices[i]]]++] = (unsigned int)(i / 3);
+		}
+
+		centroids.resize(triangleCount);
+		normals.resize(triangleCount);
+		float totalArea = 0.f;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			glm::vec3 a = glm::make_vec3(positions + indices[t * 3] * 3);
+			glm::vec3 b = glm::make_vec3(positions + indices[t * 3 + 1] * 3);
+			glm::vec3 c = glm::make_vec3(positions + indices[t * 3 + 2] * 3);
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			centroids[t] = (a + b + c) / 3.f;
+			normals[t] = length > 0.f ? normal / length : glm::vec3(0.f);
+			totalArea += length * 0.5f;
+		}
+		// Radius of a meshlet of average triangles, the unit of the distance term
+		float expectedRadius = sqrtf(totalArea / triangleCount * MESHLET_MAX_TRIANGLES / 3.14159265f);
+		if (expectedRadius <= 0.f)
+			expectedRadius = 1.f;
+
+		vertexStamp.assign(local.globalId.size(), 0);
+		candidateStamp.assign(triangleCount, 0);
+		used.assign(triangleCount, 0);
+		order.clear();
+		starts.clear();
+		size_t cursor = 0;
+		unsigned int meshletNumber = 0;
+		while (order.size() < triangleCount)
+		{
+			meshletNumber++;
+			starts.push_back((unsigned int)order.size());
+			candidates.clear();
+			size_t vertices = 0;
+			size_t triangles = 0;
+			glm::vec3 centroidSum(0.f), normalSum(0.f);
+			for (;;)
+			{
+				// Cheapest neighbour that still fits
+				long long best = -1;
+				float bestCost = FLT_MAX;
+				glm::vec3 center = triangles ? centroidSum / (float)triangles : glm::vec3(0.f);
+				glm::vec3 axis = glm::length(normalSum) > 0.f ? glm::normalize(normalSum) : glm::vec3(0.f);
+				for (unsigned int t : candidates)
+				{
+					if (used[t])
+						continue;
+					unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+					size_t added = (vertexStamp[a] != meshletNumber) + (b != a && vertexStamp[b] != meshletNumber)
+						+ (c != a && c != b && vertexStamp[c] != meshletNumber);
+					if (vertices + added > MESHLET_MAX_VERTICES)
+						continue;
+					float cost = added == 0 ? -1.f : (1.f - MESHLET_CONE_WEIGHT) * glm::length(centroids[t] - center) / expectedRadius
+						+ MESHLET_CONE_WEIGHT * (1.f - glm::dot(normals[t], axis));
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						best = t;
+					}
+				}
+				if (best < 0)
+				{
+					while (cursor < triangleCount && used[cursor])
+						cursor++;
+					if (cursor == triangleCount)
+						break;
+					bool fits = vertices + 3 <= MESHLET_MAX_VERTICES;
+					if (triangles > 0 && (!fits || glm::length(centroids[cursor] - center) > expectedRadius))
+						break;
+					best = (long long)cursor;
+				}
+
+				unsigned int t = (unsigned int)best;
+				used[t] = 1;
+				order.push_back(t);
+				triangles++;
+				centroidSum += centroids[t];
+				normalSum += normals[t];
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned int v = indices[t * 3 + k];
+					if (vertexStamp[v] != meshletNumber)
+					{
+						vertexStamp[v] = meshletNumber;
+						vertices++;
+					}
+					unsigned int position = positionId[v];
+					for (unsigned int a = offsets[position]; a < offsets[position + 1]; a++)
+					{
+						unsigned int neighbour = adjacency[a];
+						if (!used[neighbour] && candidateStamp[neighbour] != meshletNumber)
+						{
+							candidateStamp[neighbour] = meshletNumber;
+							candidates.push_back(neighbour);
+						}
+					}
+				}
+				if (triangles == MESHLET_MAX_TRIANGLES)
+					break;
+			}
+		}
+
+		// Meshlet order, then the meshlets themselves ordered for overdraw
+		ArenaVector<unsigned int> reordered(triangleCount * 3);
+		for (size_t i = 0; i < triangleCount; i++)
+			memcpy(reordered.data() + i * 3, indices + order[i] * 3, 3 * sizeof(unsigned int));
+		memcpy(local.indices.data(), reordered.data(), triangleCount * 3 * sizeof(unsigned int));
+		SortClustersForOverdraw(local.indices.data(), triangleCount * 3, positions, starts);
+
+		// Grouping scatters the vertex cache order, so restore it inside each meshlet, on the
+		// meshlet's own vertices numbered from 0 to keep the pass linear in its size
+		ArenaVector<unsigned int> meshletId(local.globalId.size(), UINT_MAX), meshletVertices, clusters;
+		for (size_t m = 0; m < starts.size(); m++)
+		{
+			unsigned int* first = local.indices.data() + starts[m] * 3;
+			size_t count = ((m + 1 < starts.size() ? starts[m + 1] : triangleCount) - starts[m]) * 3;
+			meshletVertices.clear();
+			for (size_t i = 0; i < count; i++)
+			{
+				if (meshletId[first[i]] == UINT_MAX)
+				{
+					meshletId[first[i]] = (unsigned int)meshletVertices.size();
+					meshletVertices.push_back(first[i]);
+				}
+				first[i] = meshletId[first[i]];
+			}
+			OptimizeVertexCache(first, count, meshletVertices.size(), VERTEX_CACHE_SIZE, clusters);
+			for (size_t i = 0; i < count; i++)
+				first[i] = meshletVertices[first[i]];
+			for (unsigned int v : meshletVertices)
+				meshletId[v] = UINT_MAX;
+		}
+		local.Scatter(mesh, submesh.firstIndex);
+
+		for (size_t m = 0; m < starts.size(); m++)
+		{
+			Meshlet meshlet;
+			meshlet.firstIndex = submesh.firstIndex + starts[m] * 3;
+			meshlet.indexCount = (unsigned int)((m + 1 < starts.size() ? starts[m + 1] : triangleCount) - starts[m]) * 3;
+			ComputeMeshletBounds(mesh, meshlet);
+			mesh.meshlets.push_back(meshlet);
+		}
+		submesh.meshletCount = (unsigned int)mesh.meshlets.size() - submesh.firstMeshlet;
+	}
+	OptimizeVertexFetch(mesh);
+}
+
+/**
+ * @brief Sets up culling for one draw of a mesh.
+ *
+ * The frustum planes are taken from viewProjection * model, so they are already in object space,
+ * and the camera is moved there too; meshlet bounds are then tested untransformed.
+ *
+ * @param viewProjection The projection matrix times the view matrix.
+ * @param model The model matrix of the draw.
+ * @param cameraPosition The camera position in world space.
+ * @return The view to pass to DrawMesh.
+ */
+MeshCullView MakeMeshCullView(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition)
+{
+	MeshCullView view;
+	glm::mat4 m = viewProjection * model;
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	for (int i = 0; i < 3; i++)
+	{
+		view.planes[i * 2] = rows[3] + rows[i];
+		view.planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+	for (glm::vec4& plane : view.planes)
+	{
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.f)
+			plane /= length;
+	}
+	view.cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.f));
+	view.backfaces = meshletBackfaceCulling;
+	return view;
+}
+
+// False when the sphere is entirely outside one of the frustum planes
+bool SphereInFrustum(const MeshCullView& view, const glm::vec3& center, float radius)
+{
+	for (const glm::vec4& plane : view.planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+// False when the meshlet is outside the frustum or, with view.backfaces, faces away from the camera
+bool MeshletVisible(const MeshCullView& view, const Meshlet& meshlet)
+{
+	meshletCounters.tested++;
+	if (!SphereInFrustum(view, meshlet.center, meshlet.radius))
+	{
+		meshletCounters.culled++;
+		return false;
+	}
+	if (view.backfaces && meshlet.coneCutoff < 1.f)
+	{
+		glm::vec3 toCenter = meshlet.center - view.cameraPosition;
+		if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+		{
+			meshletCounters.culled++;
+			return false;
+		}
+	}
+	return true;
+}
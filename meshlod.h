@@ -0,0 +1,591 @@
+#pragma once
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "arena.h"
+#include "mesh.h"
+#include "meshlet.h"
+#include "meshoptimize.h"
+
+// Triangle count of each generated level relative to the level before it
+const float MESH_LOD_REDUCTION = 0.5f;
+
+// A level is only kept if it has at most this fraction of the previous level's triangles
+const float MESH_LOD_MIN_REDUCTION = 0.8f;
+
+// Largest simplification error BuildMeshLods accepts, as a fraction of the mesh's bounding radius
+const float MESH_LOD_MAX_ERROR = 0.1f;
+
+// Simplification error in pixels a level may show on screen before a finer level is drawn
+const float MESH_LOD_PIXEL_ERROR = 1.f;
+
+// How far past the threshold the projected error has to move before the level changes, so a
+// mesh that sits at a switching distance does not pop back and forth
+const float MESH_LOD_HYSTERESIS = 0.2f;
+
+// Height in pixels of the view SelectMeshLod projects into; main.cpp renders at 1080p
+int meshLodViewportHeight = 1080;
+
+// Draws per level and level changes made by SelectMeshLod since the counters were last cleared
+struct MeshLodCounters
+{
+	size_t draws[MESH_MAX_LODS] = {};
+	size_t switches = 0;
+};
+
+MeshLodCounters meshLodCounters;
+
+// Level of detail one drawn instance is at, kept between frames for the hysteresis
+struct MeshLodState
+{
+	int level = 0;
+};
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and Heckbert
+struct Quadric
+{
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+
+	// Plane dot(normal, p) + d = 0 with a unit normal
+	void AddPlane(const glm::dvec3& normal, double d)
+	{
+		a2 += normal.x * normal.x;
+		ab += normal.x * normal.y;
+		ac += normal.x * normal.z;
+		ad += normal.x * d;
+		b2 += normal.y * normal.y;
+		bc += normal.y * normal.z;
+		bd += normal.y * d;
+		c2 += normal.z * normal.z;
+		cd += normal.z * d;
+		d2 += d * d;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a2 += q.a2;
+		ab += q.ab;
+		ac += q.ac;
+		ad += q.ad;
+		b2 += q.b2;
+		bc += q.bc;
+		bd += q.bd;
+		c2 += q.c2;
+		cd += q.cd;
+		d2 += q.d2;
+	}
+
+	double Evaluate(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+			+ b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+			+ c2 * z * z + 2.0 * cd * z
+			+ d2;
+		return error > 0.0 ? error : 0.0;
+	}
+};
+
+// How a position may move in SimplifyLocalRange
+enum LodVertexKind
+{
+	LOD_VERTEX_MANIFOLD = 0, // interior, one wedge: collapses along any edge
+	LOD_VERTEX_BORDER = 1, // on one open border, one wedge: collapses along its border
+	LOD_VERTEX_SEAM = 2, // on one UV seam, two wedges: collapses along its seam
+	LOD_VERTEX_LOCKED = 3, // corners, seam and border ends, non-manifold: never moves
+};
+
+// Edge of a triangle between two positions; sorting by key brings the uses of an edge together
+struct LodEdge
+{
+	uint64_t key; // smaller position in the high half
+	unsigned int triangle;
+};
+
+// One candidate edge collapse of SimplifyLocalRange: position from moves onto position to
+struct LodCollapse
+{
+	double cost;
+	unsigned int from;
+	unsigned int to;
+};
+
+/**
+ * @brief Simplifies a gathered index range with quadric error edge collapses, once per target.
+ *
+ * Positions collapse onto neighbouring positions, so the levels reuse the range's vertices.
+ * The attributes are tracked per wedge: the local vertices at one position with one UV, so
+ * copies that only differ in their normal (faceted meshes) move together. A position on a UV
+ * seam has a wedge on each side and may only slide along the seam, each wedge onto the wedge
+ * on its own side, which keeps the seam where it was; open borders likewise only shrink along
+ * themselves, and seam ends, corners and non-manifold positions never move. Each corner of
+ * the result takes the vertex of its wedge whose normal is closest to its new face. UVs are not
+ * part of the error metric.
+ *
+ * Collapses run in passes: all edges sorted by cost, then the cheapest ones that do not touch
+ * each other and flip no triangle are applied, until the target or maxError is reached.
+ *
+ * @param mesh The mesh the range was gathered from, for UVs and normals.
+ * @param local The gathered range; left unchanged.
+ * @param targets Triangle count to reach for each level, decreasing.
+ * @param levels Number of targets.
+ * @param maxError Largest collapse error, as a distance.
+ * @param out Receives the local triangle list of each level.
+ * @param errors Receives the error of each level, as a distance.
+ */
+void SimplifyLocalRange(const Mesh& mesh, const LocalIndexRange& local, const size_t* targets, int levels, float maxError,
+	ArenaVector<unsigned int>* out, float* errors)
+{
+	size_t vertexCount = local.globalId.size();
+	size_t indexCount = local.indices.size();
+
+	// Sorting by position then UV makes every wedge a run of vertices and every position a run of wedges
+	ArenaVector<float> keys(vertexCount * 5);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const float* source = mesh.vertices.data() + (size_t)local.globalId[v] * MESH_VERTEX_STRIDE;
+		memcpy(keys.data() + v * 5, local.positions.data() + v * 3, 3 * sizeof(float));
+		keys[v * 5 + 3] = source[6];
+		keys[v * 5 + 4] = source[7];
+	}
+	ArenaVector<unsigned int> order(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		order[v] = (unsigned int)v;
+	const float* k = keys.data();
+	std::sort(order.begin(), order.end(), [k](unsigned int a, unsigned int b) { return memcmp(k + a * 5, k + b * 5, 5 * sizeof(float)) < 0; });
+	ArenaVector<unsigned int> wedgeOf(vertexCount), wedgeStart, wedgePosition, positionWedges;
+	ArenaVector<glm::vec3> positions;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* key = k + order[i] * 5;
+		if (i == 0 || memcmp(key, k + order[i - 1] * 5, 5 * sizeof(float)) != 0)
+		{
+			if (i == 0 || memcmp(key, k + order[i - 1] * 5, 3 * sizeof(float)) != 0)
+			{
+				positions.push_back(glm::make_vec3(key));
+				positionWedges.push_back(0);
+			}
+			wedgeStart.push_back((unsigned int)i);
+			wedgePosition.push_back((unsigned int)positions.size() - 1);
+			positionWedges.back()++;
+		}
+		wedgeOf[order[i]] = (unsigned int)wedgeStart.size() - 1;
+	}
+	size_t wedgeCount = wedgeStart.size();
+	size_t positionCount = positions.size();
+	wedgeStart.push_back((unsigned int)vertexCount);
+
+	// Triangles as wedges; corners are compared by position
+	ArenaVector<unsigned int> triangles;
+	triangles.reserve(indexCount);
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		unsigned int a = wedgeOf[local.indices[i]], b = wedgeOf[local.indices[i + 1]], c = wedgeOf[local.indices[i + 2]];
+		if (wedgePosition[a] == wedgePosition[b] || wedgePosition[b] == wedgePosition[c] || wedgePosition[a] == wedgePosition[c])
+			continue;
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+	ArenaVector<LodEdge> edges;
+	auto gatherEdges = [&]()
+	{
+		edges.clear();
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = wedgePosition[triangles[i + e]], b = wedgePosition[triangles[i + (e + 1) % 3]];
+				LodEdge edge = { a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a, (unsigned int)(i / 3) };
+				edges.push_back(edge);
+			}
+		}
+		std::sort(edges.begin(), edges.end(), [](const LodEdge& x, const LodEdge& y) { return x.key < y.key; });
+	};
+	// Wedge a triangle has at a position
+	auto cornerWedge = [&](unsigned int triangle, unsigned int position)
+	{
+		const unsigned int* t = triangles.data() + triangle * 3;
+		return wedgePosition[t[0]] == position ? t[0] : wedgePosition[t[1]] == position ? t[1] : t[2];
+	};
+	// Kind of the edge edges[i..run): LOD_VERTEX_BORDER, LOD_VERTEX_SEAM, LOD_VERTEX_MANIFOLD or LOD_VERTEX_LOCKED if non-manifold
+	auto edgeKind = [&](size_t i, size_t run)
+	{
+		if (run - i == 1)
+			return LOD_VERTEX_BORDER;
+		if (run - i > 2)
+			return LOD_VERTEX_LOCKED;
+		unsigned int a = (unsigned int)(edges[i].key >> 32), b = (unsigned int)(edges[i].key & 0xFFFFFFFFu);
+		bool seam = cornerWedge(edges[i].triangle, a) != cornerWedge(edges[i + 1].triangle, a)
+			|| cornerWedge(edges[i].triangle, b) != cornerWedge(edges[i + 1].triangle, b);
+		return seam ? LOD_VERTEX_SEAM : LOD_VERTEX_MANIFOLD;
+	};
+
+	// Face planes, plus a plane through every open border edge so outlines keep their shape
+	ArenaVector<Quadric> quadrics(positionCount);
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		glm::dvec3 a = positions[wedgePosition[triangles[i]]];
+		glm::dvec3 b = positions[wedgePosition[triangles[i + 1]]];
+		glm::dvec3 c = positions[wedgePosition[triangles[i + 2]]];
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+		normal /= length;
+		for (int corner = 0; corner < 3; corner++)
+			quadrics[wedgePosition[triangles[i + corner]]].AddPlane(normal, -glm::dot(normal, a));
+	}
+
+	// Classify the positions by the borders and seams through them
+	gatherEdges();
+	ArenaVector<unsigned char> borderEdges(positionCount, 0), seamEdges(positionCount, 0), kinds(positionCount);
+	ArenaVector<char> nonManifold(positionCount, 0);
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t run = i + 1;
+		while (run < edges.size() && edges[run].key == edges[i].key)
+			run++;
+		unsigned int a = (unsigned int)(edges[i].key >> 32), b = (unsigned int)(edges[i].key & 0xFFFFFFFFu);
+		LodVertexKind kind = edgeKind(i, run);
+		if (kind == LOD_VERTEX_LOCKED)
+			nonManifold[a] = nonManifold[b] = 1;
+		else if (kind == LOD_VERTEX_BORDER)
+		{
+			borderEdges[a] = (unsigned char)std::min(borderEdges[a] + 1, 255);
+			borderEdges[b] = (unsigned char)std::min(borderEdges[b] + 1, 255);
+			glm::dvec3 pa = positions[a], pb = positions[b];
+			const unsigned int* t = triangles.data() + edges[i].triangle * 3;
+			glm::dvec3 face = glm::cross(glm::dvec3(positions[wedgePosition[t[1]]]) - glm::dvec3(positions[wedgePosition[t[0]]]),
+				glm::dvec3(positions[wedgePosition[t[2]]]) - glm::dvec3(positions[wedgePosition[t[0]]]));
+			glm::dvec3 normal = glm::cross(pb - pa, face);
+			double length = glm::length(normal);
+			if (length > 0.0)
+			{
+				normal /= length;
+				quadrics[a].AddPlane(normal, -glm::dot(normal, pa));
+				quadrics[b].AddPlane(normal, -glm::dot(normal, pa));
+			}
+		}
+		else if (kind == LOD_VERTEX_SEAM)
+		{
+			seamEdges[a] = (unsigned char)std::min(seamEdges[a] + 1, 255);
+			seamEdges[b] = (unsigned char)std::min(seamEdges[b] + 1, 255);
+		}
+		i = run;
+	}
+	for (size_t p = 0; p < positionCount; p++)
+	{
+		unsigned char kind = LOD_VERTEX_LOCKED;
+		if (nonManifold[p])
+			kind = LOD_VERTEX_LOCKED;
+		else if (positionWedges[p] == 1 && borderEdges[p] == 0 && seamEdges[p] == 0)
+			kind = LOD_VERTEX_MANIFOLD;
+		else if (positionWedges[p] == 1 && borderEdges[p] == 2 && seamEdges[p] == 0)
+			kind = LOD_VERTEX_BORDER;
+		else if (positionWedges[p] == 2 && borderEdges[p] == 0 && seamEdges[p] == 2)
+			kind = LOD_VERTEX_SEAM;
+		kinds[p] = kind;
+	}
+
+	ArenaVector<unsigned int> offsets, adjacency, remap;
+	ArenaVector<LodCollapse> collapses;
+	ArenaVector<char> touched;
+	double worst = 0.0;
+	double maxCost = (double)maxError * maxError;
+	for (int level = 0; level < levels; level++)
+	{
+		while (triangles.size() / 3 > targets[level])
+		{
+			// Triangles around every position
+			offsets.assign(positionCount + 1, 0);
+			for (unsigned int w : triangles)
+				offsets[wedgePosition[w] + 1]++;
+			for (size_t p = 0; p < positionCount; p++)
+				offsets[p + 1] += offsets[p];
+			adjacency.resize(triangles.size());
+			{
+				ArenaVector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < triangles.size(); i++)
+					adjacency[fill[wedgePosition[triangles[i]]]++] = (unsigned int)(i / 3);
+			}
+
+			// Cheaper allowed direction of every edge
+			gatherEdges();
+			collapses.clear();
+			for (size_t i = 0; i < edges.size();)
+			{
+				size_t run = i + 1;
+				while (run < edges.size() && edges[run].key == edges[i].key)
+					run++;
+				unsigned int a = (unsigned int)(edges[i].key >> 32), b = (unsigned int)(edges[i].key & 0xFFFFFFFFu);
+				LodVertexKind kind = edgeKind(i, run);
+				i = run;
+				bool fromA = kinds[a] == LOD_VERTEX_MANIFOLD ? kind == LOD_VERTEX_MANIFOLD : kinds[a] != LOD_VERTEX_LOCKED && kinds[a] == kind;
+				bool fromB = kinds[b] == LOD_VERTEX_MANIFOLD ? kind == LOD_VERTEX_MANIFOLD : kinds[b] != LOD_VERTEX_LOCKED && kinds[b] == kind;
+				if (!fromA && !fromB)
+					continue;
+				Quadric sum = quadrics[a];
+				sum.Add(quadrics[b]);
+				double toB = fromA ? sum.Evaluate(positions[b]) : DBL_MAX;
+				double toA = fromB ? sum.Evaluate(positions[a]) : DBL_MAX;
+				LodCollapse collapse = { toB <= toA ? toB : toA, toB <= toA ? a : b, toB <= toA ? b : a };
+				if (collapse.cost <= maxCost)
+					collapses.push_back(collapse);
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const LodCollapse& x, const LodCollapse& y) { return x.cost < y.cost; });
+
+			remap.resize(wedgeCount);
+			for (size_t w = 0; w < wedgeCount; w++)
+				remap[w] = (unsigned int)w;
+			touched.assign(positionCount, 0);
+			size_t live = triangles.size() / 3;
+			size_t applied = 0;
+			for (const LodCollapse& collapse : collapses)
+			{
+				if (live <= targets[level])
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				// Wedge mapping from the triangles on the edge, then reject collapses that leave a
+				// wedge without a partner or flip or flatten a remaining triangle
+				bool valid = true;
+				size_t removed = 0;
+				for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+				{
+					const unsigned int* t = triangles.data() + adjacency[a] * 3;
+					if (wedgePosition[t[0]] == collapse.to || wedgePosition[t[1]] == collapse.to || wedgePosition[t[2]] == collapse.to)
+					{
+						remap[cornerWedge(adjacency[a], collapse.from)] = cornerWedge(adjacency[a], collapse.to);
+						removed++;
+					}
+				}
+				for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1] && valid; a++)
+				{
+					const unsigned int* t = triangles.data() + adjacency[a] * 3;
+					unsigned int from = cornerWedge(adjacency[a], collapse.from);
+					valid = remap[from] != from;
+					if (!valid || removed == 0 || wedgePosition[t[0]] == collapse.to || wedgePosition[t[1]] == collapse.to
+						|| wedgePosition[t[2]] == collapse.to)
+						continue;
+					glm::vec3 p[3], q[3];
+					for (int corner = 0; corner < 3; corner++)
+					{
+						p[corner] = positions[wedgePosition[t[corner]]];
+						q[corner] = wedgePosition[t[corner]] == collapse.from ? positions[collapse.to] : p[corner];
+					}
+					glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+					glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+					valid = glm::dot(before, after) > 0.25f * glm::length(before) * glm::length(after) && glm::length(after) > 0.f;
+				}
+				if (!valid)
+				{
+					for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+					{
+						unsigned int from = cornerWedge(adjacency[a], collapse.from);
+						remap[from] = from;
+					}
+					continue;
+				}
+
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				worst = std::max(worst, collapse.cost);
+				live -= removed;
+				applied++;
+				for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+				{
+					const unsigned int* t = triangles.data() + adjacency[a] * 3;
+					touched[wedgePosition[t[0]]] = touched[wedgePosition[t[1]]] = touched[wedgePosition[t[2]]] = 1;
+				}
+			}
+			if (applied == 0)
+				break;
+
+			size_t written = 0;
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				unsigned int a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+				if (wedgePosition[a] == wedgePosition[b] || wedgePosition[b] == wedgePosition[c] || wedgePosition[a] == wedgePosition[c])
+					continue;
+				triangles[written++] = a;
+				triangles[written++] = b;
+				triangles[written++] = c;
+			}
+			triangles.resize(written);
+		}
+
+		// Back to vertices: the vertex of each wedge whose normal best matches the new face
+		ArenaVector<unsigned int>& indices = out[level];
+		indices.resize(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			glm::vec3 a = positions[wedgePosition[triangles[i]]];
+			glm::vec3 b = positions[wedgePosition[triangles[i + 1]]];
+			glm::vec3 c = positions[wedgePosition[triangles[i + 2]]];
+			glm::vec3 face = glm::cross(b - a, c - a);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int w = triangles[i + corner];
+				unsigned int best = order[wedgeStart[w]];
+				float bestDot = -FLT_MAX;
+				for (unsigned int s = wedgeStart[w]; s < wedgeStart[w + 1] && wedgeStart[w + 1] - wedgeStart[w] > 1; s++)
+				{
+					const float* source = mesh.vertices.data() + (size_t)local.globalId[order[s]] * MESH_VERTEX_STRIDE;
+					glm::vec3 normal(source[3], source[4], source[5]);
+					float length = glm::length(normal);
+					float d = length > 0.f ? glm::dot(normal, face) / length : -FLT_MAX;
+					if (d > bestDot)
+					{
+						bestDot = d;
+						best = order[s];
+					}
+				}
+				indices[i + corner] = best;
+			}
+		}
+		errors[level] = (float)sqrt(worst);
+	}
+}
+
+/**
+ * @brief Appends up to MESH_MAX_LODS - 1 simplified levels of every submesh to the index buffer.
+ *
+ * Each level aims for MESH_LOD_REDUCTION of the previous level's triangles, simplified from it
+ * with SimplifyLocalRange; submeshes are simplified on their own, so the joins between them
+ * stay closed. A level is kept when the whole mesh shrinks to MESH_LOD_MIN_REDUCTION of the
+ * previous level; lodErrors records how far each level may be off, in object space.
+ *
+ * Levels index the vertices of level 0, so run it last, after BuildMeshlets. Every level is
+ * ordered for the vertex cache and laid out submesh after submesh, like level 0.
+ *
+ * @param mesh The mesh; sets lodCount, lodErrors and the level ranges of every submesh.
+ */
+void BuildMeshLods(Mesh& mesh)
+{
+	ArenaScope scope;
+	const int levels = MESH_MAX_LODS - 1;
+	size_t baseIndexCount = 0;
+	for (SubMesh& submesh : mesh.submeshes)
+	{
+		baseIndexCount = std::max(baseIndexCount, (size_t)submesh.firstIndex + submesh.indexCount);
+		for (IndexRange& range : submesh.lods)
+			range = IndexRange();
+	}
+	mesh.indices.resize(baseIndexCount);
+	mesh.lodCount = 1;
+	for (float& error : mesh.lodErrors)
+		error = 0.f;
+
+	float maxError = MESH_LOD_MAX_ERROR * 0.5f * glm::length(mesh.boundsMax - mesh.boundsMin);
+	ArenaVector<unsigned int> levelIndices[levels], levelStarts[levels], simplified[levels];
+	size_t levelTriangles[MESH_MAX_LODS] = { baseIndexCount / 3 };
+	float levelErrors[MESH_MAX_LODS] = {};
+	LocalIndexRange local(MeshVertexCount(mesh), baseIndexCount);
+	ArenaVector<unsigned int> clusters;
+	for (SubMesh& submesh : mesh.submeshes)
+	{
+		for (int level = 0; level < levels; level++)
+			levelStarts[level].push_back((unsigned int)levelIndices[level].size());
+		size_t triangleCount = submesh.indexCount / 3;
+		if (triangleCount == 0)
+			continue;
+		local.Gather(mesh, submesh.firstIndex, triangleCount * 3);
+
+		size_t targets[levels];
+		size_t target = triangleCount;
+		for (int level = 0; level < levels; level++)
+		{
+			target = (size_t)(target * MESH_LOD_REDUCTION);
+			targets[level] = target;
+		}
+		float errors[levels];
+		SimplifyLocalRange(mesh, local, targets, levels, maxError, simplified, errors);
+		for (int level = 0; level < levels; level++)
+		{
+			ArenaVector<unsigned int>& indices = simplified[level];
+			OptimizeVertexCache(indices.data(), indices.size(), local.globalId.size(), VERTEX_CACHE_SIZE, clusters);
+			for (unsigned int index : indices)
+				levelIndices[level].push_back(local.globalId[index]);
+			levelTriangles[level + 1] += indices.size() / 3;
+			levelErrors[level + 1] = std::max(levelErrors[level + 1], errors[level]);
+		}
+		local.Scatter(mesh, submesh.firstIndex);
+	}
+
+	for (int level = 0; level < levels; level++)
+	{
+		if (levelTriangles[level + 1] > MESH_LOD_MIN_REDUCTION * levelTriangles[mesh.lodCount - 1])
+			break;
+		unsigned int base = (unsigned int)mesh.indices.size();
+		mesh.indices.insert(mesh.indices.end(), levelIndices[level].begin(), levelIndices[level].end());
+		for (size_t s = 0; s < mesh.submeshes.size(); s++)
+		{
+			unsigned int start = levelStarts[level][s];
+			unsigned int end = s + 1 < mesh.submeshes.size() ? levelStarts[level][s + 1] : (unsigned int)levelIndices[level].size();
+			mesh.submeshes[s].lods[level].firstIndex = base + start;
+			mesh.submeshes[s].lods[level].indexCount = end - start;
+		}
+		mesh.lodErrors[mesh.lodCount] = levelErrors[level + 1];
+		mesh.lodCount++;
+	}
+}
+
+/**
+ * @brief Projects the bounding sphere of a draw and returns how many pixels one object-space unit covers at its near side.
+ *
+ * The y row of viewProjection * model is the projection's y scale times the view-space y axis
+ * in object units, so its length also carries the model scale; the w row gives the distance.
+ *
+ * @param viewProjection The projection matrix times the view matrix.
+ * @param model The model matrix of the draw.
+ * @param center Centre of the sphere in object space.
+ * @param radius Radius of the sphere in object space.
+ * @return Pixels per object unit on a meshLodViewportHeight view, FLT_MAX when the camera is inside the sphere.
+ */
+float ProjectedPixelsPerUnit(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& center, float radius)
+{
+	glm::mat4 m = viewProjection * model;
+	glm::vec3 yRow(m[0][1], m[1][1], m[2][1]);
+	glm::vec3 wRow(m[0][3], m[1][3], m[2][3]);
+	float distance = glm::dot(wRow, center) + m[3][3] - radius * glm::length(wRow);
+	if (distance <= 0.f)
+		return FLT_MAX;
+	return glm::length(yRow) / distance * meshLodViewportHeight * 0.5f;
+}
+
+/**
+ * @brief Picks the coarsest level whose error stays under MESH_LOD_PIXEL_ERROR pixels on screen.
+ *
+ * Starting from the level the instance was at, the level only gets finer once its projected
+ * error is MESH_LOD_HYSTERESIS above the threshold, and coarser once the next level's error is
+ * MESH_LOD_HYSTERESIS below it.
+ *
+ * @param lodErrors Object-space error of every level, increasing.
+ * @param lodCount Number of levels.
+ * @param pixelsPerUnit Result of ProjectedPixelsPerUnit for the draw.
+ * @param state The instance's level, updated.
+ * @return The level to draw.
+ */
+int SelectMeshLod(const float* lodErrors, int lodCount, float pixelsPerUnit, MeshLodState& state)
+{
+	int level = std::max(0, std::min(state.level, lodCount - 1));
+	while (level > 0 && lodErrors[level] * pixelsPerUnit > MESH_LOD_PIXEL_ERROR * (1.f + MESH_LOD_HYSTERESIS))
+		level--;
+	while (level + 1 < lodCount && lodErrors[level + 1] * pixelsPerUnit <= MESH_LOD_PIXEL_ERROR * (1.f - MESH_LOD_HYSTERESIS))
+		level++;
+	if (level != state.level)
+		meshLodCounters.switches++;
+	meshLodCounters.draws[level]++;
+	state.level = level;
+	return level;
+}
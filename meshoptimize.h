@@ -0,0 +1,460 @@
+#pragma once
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "arena.h"
+#include "mesh.h"
+
+// Entries of the simulated FIFO post-transform cache; 16 is a safe lower bound on current GPUs
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// How much worse than Tipsify's own ACMR a cluster may get so it can be moved for overdraw
+const float OVERDRAW_THRESHOLD = 1.05f;
+
+// Post-transform cache efficiency of an index buffer
+struct VertexCacheStats
+{
+	double acmr = 0.0; // average cache miss ratio: shaded vertices per triangle, 0.5 at best
+	double atvr = 0.0; // average transform to vertex ratio: shaded vertices per vertex, 1.0 at best
+};
+
+// Cache efficiency of a mesh before and after each stage of OptimizeMesh
+struct MeshOptimizeStats
+{
+	VertexCacheStats before;
+	VertexCacheStats vertexCache; // after Tipsify
+	VertexCacheStats after; // after overdraw ordering, final
+	size_t clusters = 0; // after the overdraw split
+};
+
+/**
+ * @brief Simulates a FIFO vertex cache over an index buffer.
+ *
+ * @param indices The triangle list.
+ * @param indexCount Number of indices.
+ * @param vertexCount Number of vertices the indices address.
+ * @param cacheSize Cache entries.
+ * @return ACMR over all triangles and ATVR over the vertices referenced.
+ */
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+	unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+	VertexCacheStats stats;
+	if (indexCount == 0)
+		return stats;
+	ArenaVector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	size_t misses = 0;
+	size_t referenced = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (cacheTime[v] == 0)
+			referenced++;
+		if (time - cacheTime[v] > cacheSize)
+		{
+			cacheTime[v] = time++;
+			misses++;
+		}
+	}
+	stats.acmr = (double)misses / (indexCount / 3);
+	stats.atvr = (double)misses / referenced;
+	return stats;
+}
+
+/**
+ * @brief Reorders triangles for the vertex cache with Tipsify (Sander, Nehab and Barczak 2007).
+ *
+ * Triangles are emitted in fans around one vertex at a time; the next fan vertex is a vertex of
+ * the last fans that is still in the cache, else the most recent vertex with triangles left.
+ * Runs in linear time.
+ *
+ * @param indices The triangle list, reordered in place; every vertex below vertexCount must be used.
+ * @param indexCount Number of indices.
+ * @param vertexCount Number of vertices the indices address.
+ * @param cacheSize Cache entries to optimize for.
+ * @param clusters Receives the first triangle of every run that starts with a cold cache.
+ */
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize,
+	ArenaVector<unsigned int>& clusters)
+{
+	clusters.clear();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles around each vertex, and how many of them are not emitted yet
+	ArenaVector<unsigned int> live(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		live[indices[i]]++;
+	ArenaVector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	ArenaVector<unsigned int> adjacency(indexCount);
+	{
+		ArenaVector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	ArenaVector<unsigned int> cacheTime(vertexCount, 0);
+	ArenaVector<char> emitted(triangleCount, 0);
+	ArenaVector<unsigned int> deadEnd;
+	deadEnd.reserve(indexCount);
+	ArenaVector<unsigned int> candidates;
+	candidates.reserve(indexCount);
+	ArenaVector<unsigned int> output(indexCount);
+	size_t written = 0;
+	unsigned int time = cacheSize + 1;
+	size_t cursor = 0;
+	long long fan = 0;
+	clusters.push_back(0);
+	while (fan >= 0)
+	{
+		candidates.clear();
+		for (unsigned int k = offsets[fan]; k < offsets[fan + 1]; k++)
+		{
+			unsigned int t = adjacency[k];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[t * 3 + c];
+				output[written++] = v;
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+		}
+
+		// Prefer the oldest candidate that stays in the cache while its own fan is emitted
+		long long next = -1;
+		long long best = -1;
+		for (unsigned int v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+			long long priority = 0;
+			if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = time - cacheTime[v];
+			if (priority > best)
+			{
+				best = priority;
+				next = v;
+			}
+		}
+		if (next < 0)
+		{
+			while (!deadEnd.empty() && next < 0)
+			{
+				unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+					next = v;
+			}
+			while (next < 0 && cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					next = (long long)cursor;
+				cursor++;
+			}
+			if (next >= 0 && written / 3 != clusters.back())
+				clusters.push_back((unsigned int)(written / 3));
+		}
+		fan = next;
+	}
+	memcpy(indices, output.data(), indexCount * sizeof(unsigned int));
+}
+
+/**
+ * @brief Sorts clusters of triangles so the outward-facing ones are drawn first, for early-Z.
+ *
+ * The key of a cluster is how far its area-weighted centroid lies in front of the centroid of
+ * the whole range, along the cluster's average normal.
+ *
+ * @param indices The triangle list, reordered in place.
+ * @param indexCount Number of indices.
+ * @param positions Three floats per vertex.
+ * @param clusters First triangle of every cluster, ascending; replaced by the starts in the new order.
+ */
+void SortClustersForOverdraw(unsigned int* indices, size_t indexCount, const float* positions, ArenaVector<unsigned int>& clusters)
+{
+	if (clusters.empty())
+		return;
+
+	// Area-weighted centroid and normal of every cluster and of the whole range
+	size_t triangleCount = indexCount / 3;
+	size_t clusterCount = clusters.size();
+	ArenaVector<glm::vec3> centroids(clusterCount, glm::vec3(0.f));
+	ArenaVector<glm::vec3> normals(clusterCount, glm::vec3(0.f));
+	ArenaVector<float> areas(clusterCount, 0.f);
+	glm::vec3 meshCentroid(0.f);
+	float meshArea = 0.f;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+		for (size_t t = clusters[c]; t < end; t++)
+		{
+			glm::vec3 a = glm::make_vec3(positions + indices[t * 3] * 3);
+			glm::vec3 b = glm::make_vec3(positions + indices[t * 3 + 1] * 3);
+			glm::vec3 d = glm::make_vec3(positions + indices[t * 3 + 2] * 3);
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float area = glm::length(normal);
+			centroids[c] += (a + b + d) * (area / 3.f);
+			normals[c] += normal;
+			areas[c] += area;
+		}
+		meshCentroid += centroids[c];
+		meshArea += areas[c];
+	}
+	if (meshArea > 0.f)
+		meshCentroid /= meshArea;
+
+	ArenaVector<float> keys(clusterCount, 0.f);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float length = glm::length(normals[c]);
+		if (areas[c] > 0.f && length > 0.f)
+			keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / length);
+	}
+	ArenaVector<unsigned int> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = (unsigned int)c;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+	ArenaVector<unsigned int> starts(clusters.begin(), clusters.end());
+	ArenaVector<unsigned int> output(indexCount);
+	size_t written = 0;
+	clusters.clear();
+	for (unsigned int c : order)
+	{
+		size_t end = c + 1 < clusterCount ? starts[c + 1] : triangleCount;
+		clusters.push_back((unsigned int)(written / 3));
+		memcpy(output.data() + written, indices + starts[c] * 3, (end - starts[c]) * 3 * sizeof(unsigned int));
+		written += (end - starts[c]) * 3;
+	}
+	memcpy(indices, output.data(), indexCount * sizeof(unsigned int));
+}
+
+/**
+ * @brief Orders clusters of triangles so the outward-facing ones are drawn first, for early-Z.
+ *
+ * Each cold-cache run from OptimizeVertexCache is split again wherever its ACMR so far drops to
+ * threshold times its own ACMR, so moving clusters costs at most that factor. The clusters are
+ * then ordered by SortClustersForOverdraw.
+ *
+ * @param indices The triangle list after OptimizeVertexCache, reordered in place.
+ * @param indexCount Number of indices.
+ * @param positions Three floats per vertex.
+ * @param vertexCount Number of vertices the indices address.
+ * @param clusters The runs from OptimizeVertexCache; replaced by the split clusters in draw order.
+ * @param cacheSize Cache entries to optimize for.
+ * @param threshold Allowed ACMR factor, e.g. OVERDRAW_THRESHOLD.
+ */
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount,
+	ArenaVector<unsigned int>& clusters, unsigned int cacheSize, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || clusters.empty())
+		return;
+
+	ArenaVector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	auto triangleMisses = [&](size_t t)
+	{
+		unsigned int misses = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			if (time - cacheTime[v] > cacheSize)
+			{
+				cacheTime[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	ArenaVector<unsigned int> split;
+	split.reserve(triangleCount);
+	for (size_t h = 0; h < clusters.size(); h++)
+	{
+		size_t start = clusters[h];
+		size_t end = h + 1 < clusters.size() ? clusters[h + 1] : triangleCount;
+		time += cacheSize + 1;
+		size_t runMisses = 0;
+		for (size_t t = start; t < end; t++)
+			runMisses += triangleMisses(t);
+		double limit = threshold * (double)runMisses / (end - start);
+
+		time += cacheSize + 1;
+		split.push_back((unsigned int)start);
+		size_t clusterStart = start;
+		size_t misses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			misses += triangleMisses(t);
+			if (t + 1 < end && misses <= limit * (t - clusterStart + 1))
+			{
+				split.push_back((unsigned int)(t + 1));
+				time += cacheSize + 1;
+				clusterStart = t + 1;
+				misses = 0;
+			}
+		}
+	}
+
+	clusters.assign(split.begin(), split.end());
+	SortClustersForOverdraw(indices, indexCount, positions, clusters);
+}
+
+/**
+ * @brief Renumbers the vertices in the order the index buffer first uses them, so vertex fetches walk memory forwards.
+ *
+ * @param mesh The mesh to reorder; vertices no index refers to move to the end.
+ */
+void OptimizeVertexFetch(Mesh& mesh)
+{
+	size_t vertexCount = MeshVertexCount(mesh);
+	const unsigned int UNUSED = 0xFFFFFFFFu;
+	ArenaVector<unsigned int> remap(vertexCount, UNUSED);
+	unsigned int next = 0;
+	for (unsigned int& index : mesh.indices)
+	{
+		if (remap[index] == UNUSED)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] == UNUSED)
+			remap[v] = next++;
+	}
+
+	ArenaVector<float> original(mesh.vertices.begin(), mesh.vertices.end());
+	for (size_t v = 0; v < vertexCount; v++)
+		memcpy(mesh.vertices.data() + remap[v] * MESH_VERTEX_STRIDE, original.data() + v * MESH_VERTEX_STRIDE, MESH_VERTEX_STRIDE * sizeof(float));
+}
+
+// An index range of a mesh renumbered to compact local vertex numbers, so per-range passes
+// only touch arrays the size of the range. Create inside an ArenaScope.
+struct LocalIndexRange
+{
+	ArenaVector<unsigned int> indices;
+	ArenaVector<unsigned int> globalId; // mesh vertex of every local vertex
+	ArenaVector<float> positions; // three floats per local vertex
+	ArenaVector<unsigned int> localId; // local vertex of every mesh vertex while gathered
+
+	LocalIndexRange(size_t vertexCount, size_t maxIndices)
+		: localId(vertexCount, 0xFFFFFFFFu)
+	{
+		indices.reserve(maxIndices);
+		globalId.reserve(vertexCount < maxIndices ? vertexCount : maxIndices);
+		positions.reserve(globalId.capacity() * 3);
+	}
+
+	void Gather(const Mesh& mesh, size_t first, size_t count)
+	{
+		indices.resize(count);
+		globalId.clear();
+		positions.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned int v = mesh.indices[first + i];
+			if (localId[v] == 0xFFFFFFFFu)
+			{
+				localId[v] = (unsigned int)globalId.size();
+				globalId.push_back(v);
+				const float* position = mesh.vertices.data() + v * MESH_VERTEX_STRIDE;
+				positions.insert(positions.end(), position, position + 3);
+			}
+			indices[i] = localId[v];
+		}
+	}
+
+	// Writes the (reordered) range back and clears the local numbering for the next Gather
+	void Scatter(Mesh& mesh, size_t first)
+	{
+		for (size_t i = 0; i < indices.size(); i++)
+			mesh.indices[first + i] = globalId[indices[i]];
+		for (unsigned int v : globalId)
+			localId[v] = 0xFFFFFFFFu;
+	}
+};
+
+/**
+ * @brief Reorders an indexed mesh for the GPU: vertex cache, then overdraw, then vertex fetch.
+ *
+ * Triangles only move within their submesh, so the submesh ranges, materials and bounds stay valid.
+ * Each submesh is optimized on its own compact vertex numbering.
+ *
+ * @param mesh The mesh to optimize.
+ * @return ACMR/ATVR before and after the stages.
+ */
+MeshOptimizeStats OptimizeMesh(Mesh& mesh)
+{
+	ArenaScope scope;
+	MeshOptimizeStats stats;
+	size_t vertexCount = MeshVertexCount(mesh);
+	size_t indexCount = mesh.indices.size();
+	stats.before = AnalyzeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+
+	// Index ranges to optimize, one per submesh
+	ArenaVector<unsigned int> ranges;
+	for (const SubMesh& submesh : mesh.submeshes)
+	{
+		ranges.push_back(submesh.firstIndex);
+		ranges.push_back(submesh.indexCount);
+	}
+	if (mesh.submeshes.empty())
+	{
+		ranges.push_back(0);
+		ranges.push_back((unsigned int)indexCount);
+	}
+
+	LocalIndexRange local(vertexCount, indexCount);
+	ArenaVector<unsigned int> clusters;
+	clusters.reserve(indexCount / 3 + 1);
+	ArenaVector<unsigned int> rangeClusters; // per range: the run count, then the runs from the vertex cache pass
+	rangeClusters.reserve(indexCount / 3 + ranges.size());
+
+	// Runs one pass over every range in its local vertex numbering
+	auto optimizeRanges = [&](bool overdraw)
+	{
+		size_t nextCluster = 0;
+		for (size_t r = 0; r < ranges.size(); r += 2)
+		{
+			size_t count = ranges[r + 1];
+			local.Gather(mesh, ranges[r], count);
+			if (!overdraw)
+			{
+				OptimizeVertexCache(local.indices.data(), count, local.globalId.size(), VERTEX_CACHE_SIZE, clusters);
+				rangeClusters.push_back((unsigned int)clusters.size());
+				rangeClusters.insert(rangeClusters.end(), clusters.begin(), clusters.end());
+			}
+			else
+			{
+				unsigned int runs = rangeClusters[nextCluster];
+				clusters.assign(rangeClusters.begin() + nextCluster + 1, rangeClusters.begin() + nextCluster + 1 + runs);
+				nextCluster += runs + 1;
+				OptimizeOverdraw(local.indices.data(), count, local.positions.data(), local.globalId.size(), clusters,
+					VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+				stats.clusters += clusters.size();
+			}
+			local.Scatter(mesh, ranges[r]);
+		}
+	};
+
+	optimizeRanges(false);
+	stats.vertexCache = AnalyzeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+	optimizeRanges(true);
+	OptimizeVertexFetch(mesh);
+	stats.after = AnalyzeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+	return stats;
+}
@@ -0,0 +1,1093 @@
+#pragma once
+#include <charconv>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_USE_SSE2 1
+#endif
+
+#include "arena.h"
+#include "mapfile.h"
+#include "mesh.h"
+#include "threadpool.h"
+
+// A face corner resolved to 0-based indices, -1 when the component is absent
+struct ObjCorner
+{
+	int v;
+	int vt;
+	int vn;
+};
+
+// Start of an "o" object or "usemtl" run; fields not set by the record carry over from the previous group
+struct ObjGroup
+{
+	size_t firstCorner = 0;
+	std::string name;
+	std::string material;
+	bool hasName = false;
+	bool hasMaterial = false;
+};
+
+// Raw attribute pools of an OBJ file plus the triangle corners that index them; the pools come
+// from the arena of the ArenaScope the ObjData is created in
+struct ObjData
+{
+	ArenaVector<glm::vec3> positions;
+	ArenaVector<glm::vec2> uvs;
+	ArenaVector<glm::vec3> normals;
+	ArenaVector<ObjCorner> corners; // three per triangle
+	std::vector<ObjGroup> groups; // in file order
+	std::vector<std::string> materialLibraries; // "mtllib" file names
+};
+
+// Number of records in a span of OBJ text
+struct ObjCounts
+{
+	size_t positions = 0;
+	size_t uvs = 0;
+	size_t normals = 0;
+	size_t corners = 0; // triangle corners after triangulating every face
+};
+
+// Files smaller than this are not worth splitting across threads
+const size_t OBJ_MIN_CHUNK_SIZE = 128 * 1024;
+
+const char* SkipBlanks(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+	return p;
+}
+
+const char* SkipLine(const char* p, const char* end)
+{
+	const char* nl = (const char*)memchr(p, '\n', end - p);
+	return nl ? nl + 1 : end;
+}
+
+#ifdef OBJ_USE_SSE2
+// x must not be 0
+int CountTrailingZeros(unsigned int x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctz(x);
+#endif
+}
+
+// 16 bytes of 0xFF then 16 of 0; loading at OBJ_KEEP_MASK + 16 - n keeps the first n bytes
+alignas(16) const unsigned char OBJ_KEEP_MASK[32] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+/**
+ * @brief Parses Blender's fixed-point form, -?d.d to -?dd.dddddd, with SSE2.
+ *
+ * Blender writes positions and UVs with six decimals and normals with four. The digits are
+ * classified and reduced to an integer N (the decimals padded to six) in registers, and the value
+ * is N / 1e6 divided in double. A six-decimal number below 100 is never closer to a float rounding
+ * boundary than the double error, so narrowing rounds exactly like from_chars. Any other form is
+ * left to the general parser.
+ *
+ * @param p Start of the number (after blanks); at least 16 bytes must be readable.
+ * @param value Receives the number.
+ * @return Pointer past the number, or nullptr if the text is not in the fixed form.
+ */
+const char* ParseObjFixedFloat(const char* p, float& value)
+{
+	bool negative = *p == '-';
+	p += negative;
+
+	__m128i text = _mm_loadu_si128((const __m128i*)p);
+	__m128i digits = _mm_sub_epi8(text, _mm_set1_epi8('0'));
+	int digitMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits));
+	int dotMask = _mm_movemask_epi8(_mm_cmpeq_epi8(text, _mm_set1_epi8('.')));
+
+	// One or two integer digits, the point, then one to six decimals
+	int integerDigits = (dotMask & 0x6) == 0x2 ? 1 : (dotMask & 0x6) == 0x4 ? 2 : 0;
+	if (integerDigits == 0 || (digitMask & ((1 << integerDigits) - 1)) != (1 << integerDigits) - 1)
+		return nullptr;
+	int decimals = CountTrailingZeros(~(unsigned int)digitMask >> (integerDigits + 1));
+	if (decimals == 0 || decimals > 6)
+		return nullptr;
+	int length = integerDigits + 1 + decimals;
+	char next = p[length];
+	if (next != ' ' && next != '\t' && next != '\r' && next != '\n')
+		return nullptr;
+
+	// Drop the point so bytes 0..7 hold the eight digits of N, zero-padded on both sides
+	__m128i packed;
+	if (integerDigits == 2)
+	{
+		__m128i head = _mm_and_si128(digits, _mm_set_epi32(0, 0, 0, 0x0000FFFF));
+		__m128i tail = _mm_and_si128(_mm_srli_si128(digits, 1), _mm_set_epi32(0, 0, -1, (int)0xFFFF0000));
+		packed = _mm_or_si128(head, tail);
+	}
+	else
+	{
+		__m128i head = _mm_and_si128(_mm_slli_si128(digits, 1), _mm_set_epi32(0, 0, 0, 0x0000FF00));
+		__m128i tail = _mm_and_si128(digits, _mm_set_epi32(0, 0, -1, (int)0xFFFF0000));
+		packed = _mm_or_si128(head, tail);
+	}
+	packed = _mm_and_si128(packed, _mm_loadu_si128((const __m128i*)(OBJ_KEEP_MASK + 16 - (2 + decimals))));
+
+	// 8 digits -> 4 pairs -> 2 groups of four, each step a multiply-add of adjacent lanes
+	__m128i words = _mm_unpacklo_epi8(packed, _mm_setzero_si128());
+	__m128i pairs = _mm_madd_epi16(words, _mm_set_epi16(1, 10, 1, 10, 1, 10, 1, 10));
+	__m128i quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100));
+	int high = _mm_cvtsi128_si32(quads);
+	int low = _mm_cvtsi128_si32(_mm_srli_si128(quads, 4));
+	int n = high * 10000 + low;
+
+	value = (float)(n / 1e6);
+	if (negative)
+		value = -value;
+	return p + length;
+}
+#endif
+
+/**
+ * @brief Parses one float in place, without allocating and independent of the locale.
+ *
+ * Blender's fixed-point numbers take the SSE2 path (ParseObjFixedFloat); everything else goes
+ * through from_chars.
+ *
+ * @return Pointer past the number, or p unchanged (value = 0) if there is none.
+ */
+const char* ParseObjFloat(const char* p, const char* end, float& value)
+{
+	p = SkipBlanks(p, end);
+#ifdef OBJ_USE_SSE2
+	if (end - p >= 17)
+	{
+		const char* fixedEnd = ParseObjFixedFloat(p, value);
+		if (fixedEnd != nullptr)
+			return fixedEnd;
+	}
+#endif
+	const char* start = p;
+	if (p < end && *p == '+')
+		++p;
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+	{
+		value = 0.f;
+		return result.ec == std::errc::result_out_of_range ? result.ptr : start;
+	}
+	return result.ptr;
+}
+
+const char* ParseObjIndex(const char* p, const char* end, int& value)
+{
+	if (p < end && *p == '+')
+		++p;
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+		value = 0;
+	return result.ptr;
+}
+
+// OBJ indices are 1-based, negative ones count back from the last element read so far
+int ResolveObjIndex(int index, size_t count)
+{
+	if (index > 0)
+		return index - 1;
+	if (index < 0)
+		return (int)count + index;
+	return -1;
+}
+
+bool IsObjFaceEnd(const char* p, const char* end)
+{
+	return p >= end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+const char* SkipObjToken(const char* p, const char* end)
+{
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+		++p;
+	return p;
+}
+
+// Number of corners (blank-separated tokens) of an "f" record
+int CountObjFaceCorners(const char* p, const char* end)
+{
+	int count = 0;
+	for (;;)
+	{
+		p = SkipBlanks(p, end);
+		if (IsObjFaceEnd(p, end))
+			return count;
+		p = SkipObjToken(p, end);
+		count++;
+	}
+}
+
+/**
+ * @brief Parses one face corner token (v, v/vt, v//vn or v/vt/vn).
+ *
+ * A malformed token gives a corner with every index set to -1.
+ */
+ObjCorner ParseObjCorner(const char* p, const char* end, const ObjCounts& read)
+{
+	int v = 0, vt = 0, vn = 0;
+	p = ParseObjIndex(p, end, v);
+	if (p < end && *p == '/')
+	{
+		++p;
+		if (p < end && *p != '/')
+			p = ParseObjIndex(p, end, vt);
+		if (p < end && *p == '/')
+			p = ParseObjIndex(p + 1, end, vn);
+	}
+
+	ObjCorner corner;
+	corner.v = ResolveObjIndex(v, read.positions);
+	corner.vt = ResolveObjIndex(vt, read.uvs);
+	corner.vn = ResolveObjIndex(vn, read.normals);
+	return corner;
+}
+
+/**
+ * @brief Parses an "f" record and triangulates it as a fan around its first corner.
+ *
+ * An n-corner face writes exactly (n - 2) * 3 corners, matching CountObjFaceCorners.
+ *
+ * @param p Start of the first corner.
+ * @param end End of the buffer.
+ * @param read Records read so far in the file; corners is advanced by the corners written.
+ * @param out The corner pool, sized for the whole file.
+ * @return Pointer to the end of the record.
+ */
+const char* ParseObjFace(const char* p, const char* end, ObjCounts& read, ObjCorner* out)
+{
+	ObjCorner first, previous;
+	int count = 0;
+	for (;;)
+	{
+		p = SkipBlanks(p, end);
+		if (IsObjFaceEnd(p, end))
+			break;
+
+		ObjCorner corner = ParseObjCorner(p, end, read);
+		p = SkipObjToken(p, end);
+		if (count == 0)
+		{
+			first = corner;
+		}
+		else if (count >= 2)
+		{
+			ObjCorner* triangle = out + read.corners;
+			triangle[0] = first;
+			triangle[1] = previous;
+			triangle[2] = corner;
+			read.corners += 3;
+		}
+		previous = corner;
+		count++;
+	}
+	return p;
+}
+
+// Classifies the record starting at p: 'v', 't' (vt), 'n' (vn), 'f', 'o', 'u' (usemtl), 'm' (mtllib) or 0 for anything else
+char ObjRecordType(const char* p, const char* end)
+{
+	if (p + 1 >= end)
+		return 0;
+	bool blank = p[1] == ' ' || p[1] == '\t';
+	switch (p[0])
+	{
+	case 'v':
+		if (blank)
+			return 'v';
+		if (p[1] == 't' || p[1] == 'n')
+			return p[1];
+		break;
+	case 'f':
+		if (blank)
+			return 'f';
+		break;
+	case 'o':
+		if (blank)
+			return 'o';
+		break;
+	case 'u':
+		if (end - p > 7 && memcmp(p, "usemtl", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+			return 'u';
+		break;
+	case 'm':
+		if (end - p > 7 && memcmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+			return 'm';
+		break;
+	}
+	return 0;
+}
+
+// Rest of the line with surrounding blanks and any CR removed
+std::string ReadObjName(const char* p, const char* end)
+{
+	p = SkipBlanks(p, end);
+	const char* last = p;
+	while (last < end && *last != '\n')
+		++last;
+	while (last > p && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t'))
+		--last;
+	return std::string(p, last);
+}
+
+/**
+ * @brief Pre-scan pass: counts the records and triangle corners of a span without parsing any numbers.
+ */
+ObjCounts CountObjRecords(const char* begin, const char* end)
+{
+	ObjCounts counts;
+	const char* p = begin;
+	while (p < end)
+	{
+		p = SkipBlanks(p, end);
+		switch (ObjRecordType(p, end))
+		{
+		case 'v': counts.positions++; break;
+		case 't': counts.uvs++; break;
+		case 'n': counts.normals++; break;
+		case 'f':
+		{
+			int faceCorners = CountObjFaceCorners(p + 2, end);
+			if (faceCorners >= 3)
+				counts.corners += (faceCorners - 2) * 3;
+			break;
+		}
+		}
+		p = SkipLine(p, end);
+	}
+	return counts;
+}
+
+// Group record for an "o" or "usemtl" line starting at p
+ObjGroup ReadObjGroupRecord(const char* p, const char* end, size_t firstCorner)
+{
+	ObjGroup group;
+	group.firstCorner = firstCorner;
+	if (*p == 'o')
+	{
+		group.name = ReadObjName(p + 1, end);
+		group.hasName = true;
+	}
+	else
+	{
+		group.material = ReadObjName(p + 6, end);
+		group.hasMaterial = true;
+	}
+	return group;
+}
+
+/**
+ * @brief Parses a "v", "vt" or "vn" record into the next free slot of its pool.
+ *
+ * @param p Start of the record.
+ * @param end End of the buffer.
+ * @param obj The data whose pools are written.
+ * @param read Records read so far in the file; the count of the record's pool is advanced.
+ * @return Pointer past the last number of the record.
+ */
+const char* ParseObjAttribute(const char* p, const char* end, ObjData& obj, ObjCounts& read)
+{
+	switch (ObjRecordType(p, end))
+	{
+	case 'v':
+	{
+		glm::vec3& vertex = obj.positions[read.positions++];
+		p = ParseObjFloat(p + 2, end, vertex.x);
+		p = ParseObjFloat(p, end, vertex.y);
+		p = ParseObjFloat(p, end, vertex.z);
+		break;
+	}
+	case 't':
+	{
+		glm::vec2& uv = obj.uvs[read.uvs++];
+		p = ParseObjFloat(p + 2, end, uv.x);
+		p = ParseObjFloat(p, end, uv.y);
+		break;
+	}
+	case 'n':
+	{
+		glm::vec3& normal = obj.normals[read.normals++];
+		p = ParseObjFloat(p + 2, end, normal.x);
+		p = ParseObjFloat(p, end, normal.y);
+		p = ParseObjFloat(p, end, normal.z);
+		break;
+	}
+	}
+	return p;
+}
+
+/**
+ * @brief Tokenizes a newline-aligned span of OBJ text in place.
+ *
+ * Attributes and corners are written into the pre-sized pools of obj starting at base, so
+ * spans can be parsed independently once the records before them have been counted.
+ *
+ * @param begin Start of the span.
+ * @param end End of the span.
+ * @param obj Pools to write into, sized for the whole file.
+ * @param base Number of each record in the file before this span.
+ * @param groups Receives the groups started in this span.
+ * @param libraries Receives the material libraries named in this span.
+ */
+void ParseObjRange(const char* begin, const char* end, ObjData& obj, ObjCounts base, std::vector<ObjGroup>& groups,
+	std::vector<std::string>& libraries)
+{
+	ObjCounts read = base;
+	const char* p = begin;
+	while (p < end)
+	{
+		p = SkipBlanks(p, end);
+		switch (ObjRecordType(p, end))
+		{
+		case 'v':
+		case 't':
+		case 'n':
+			p = ParseObjAttribute(p, end, obj, read);
+			break;
+		case 'f':
+			p = ParseObjFace(p + 2, end, read, obj.corners.data());
+			break;
+		case 'o':
+		case 'u':
+			groups.push_back(ReadObjGroupRecord(p, end, read.corners));
+			break;
+		case 'm':
+			libraries.push_back(ReadObjName(p + 6, end));
+			break;
+		}
+		p = SkipLine(p, end);
+	}
+}
+
+/**
+ * @brief Turns the raw group records into consecutive, non-empty groups covering every corner.
+ *
+ * Names and materials are carried forward, and records starting at the same corner (an "o"
+ * directly followed by "usemtl") are merged into one group.
+ *
+ * @param records The raw records in file order; replaced by the finalized groups.
+ * @param cornerCount Total number of corners the groups cover.
+ */
+void FinalizeObjGroups(std::vector<ObjGroup>& records, size_t cornerCount)
+{
+	std::vector<ObjGroup> groups(1);
+	for (const ObjGroup& record : records)
+	{
+		ObjGroup group = groups.back();
+		group.firstCorner = record.firstCorner;
+		if (record.hasName)
+			group.name = record.name;
+		if (record.hasMaterial)
+			group.material = record.material;
+		if (group.firstCorner == groups.back().firstCorner)
+			groups.back() = group;
+		else
+			groups.push_back(group);
+	}
+
+	records.clear();
+	for (size_t i = 0; i < groups.size(); i++)
+	{
+		size_t last = i + 1 < groups.size() ? groups[i + 1].firstCorner : cornerCount;
+		if (last > groups[i].firstCorner)
+			records.push_back(groups[i]);
+	}
+}
+
+/**
+ * @brief Tokenizes an OBJ buffer in place into attribute pools and triangle corners.
+ *
+ * @param begin Start of the OBJ text.
+ * @param end End of the OBJ text.
+ * @param obj Receives the parsed data.
+ */
+void ParseObj(const char* begin, const char* end, ObjData& obj)
+{
+	ObjCounts counts = CountObjRecords(begin, end);
+	obj.positions.resize(counts.positions);
+	obj.uvs.resize(counts.uvs);
+	obj.normals.resize(counts.normals);
+	obj.corners.resize(counts.corners);
+	ParseObjRange(begin, end, obj, ObjCounts(), obj.groups, obj.materialLibraries);
+	FinalizeObjGroups(obj.groups, obj.corners.size());
+}
+
+/**
+ * @brief Parses an OBJ buffer on a thread pool, producing exactly what ParseObj produces.
+ *
+ * The text is split into newline-aligned chunks. Each chunk is counted in parallel, the counts
+ * are prefix-summed into per-chunk offsets, then every chunk is parsed in parallel straight
+ * into its slot of the shared pools.
+ *
+ * @param begin Start of the OBJ text.
+ * @param end End of the OBJ text.
+ * @param obj Receives the parsed data.
+ * @param pool The pool to parse on.
+ */
+void ParseObjParallel(const char* begin, const char* end, ObjData& obj, ThreadPool& pool)
+{
+	size_t size = end - begin;
+	size_t chunkCount = (pool.Size() + 1) * 2;
+	if (chunkCount > size / OBJ_MIN_CHUNK_SIZE)
+		chunkCount = size / OBJ_MIN_CHUNK_SIZE;
+	if (chunkCount < 2)
+	{
+		ParseObj(begin, end, obj);
+		return;
+	}
+
+	// Chunk boundaries, each moved forward to just after a newline
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = begin;
+	bounds[chunkCount] = end;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* split = begin + size * i / chunkCount;
+		if (split < bounds[i - 1])
+			split = bounds[i - 1];
+		bounds[i] = SkipLine(split, end);
+	}
+
+	std::vector<ObjCounts> bases(chunkCount + 1);
+	ParallelFor(pool, chunkCount, [&](size_t i)
+	{
+		bases[i + 1] = CountObjRecords(bounds[i], bounds[i + 1]);
+	});
+	for (size_t i = 1; i <= chunkCount; i++)
+	{
+		bases[i].positions += bases[i - 1].positions;
+		bases[i].uvs += bases[i - 1].uvs;
+		bases[i].normals += bases[i - 1].normals;
+		bases[i].corners += bases[i - 1].corners;
+	}
+	obj.positions.resize(bases[chunkCount].positions);
+	obj.uvs.resize(bases[chunkCount].uvs);
+	obj.normals.resize(bases[chunkCount].normals);
+	obj.corners.resize(bases[chunkCount].corners);
+
+	std::vector<std::vector<ObjGroup>> chunkGroups(chunkCount);
+	std::vector<std::vector<std::string>> chunkLibraries(chunkCount);
+	ParallelFor(pool, chunkCount, [&](size_t i)
+	{
+		ParseObjRange(bounds[i], bounds[i + 1], obj, bases[i], chunkGroups[i], chunkLibraries[i]);
+	});
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		obj.groups.insert(obj.groups.end(), chunkGroups[i].begin(), chunkGroups[i].end());
+		obj.materialLibraries.insert(obj.materialLibraries.end(), chunkLibraries[i].begin(), chunkLibraries[i].end());
+	}
+	FinalizeObjGroups(obj.groups, obj.corners.size());
+}
+
+/**
+ * @brief Writes one corner in the interleaved layout used by the VAOs.
+ *
+ * @param obj The parsed OBJ data.
+ * @param corner The corner to expand.
+ * @param out Destination for MESH_VERTEX_STRIDE floats: position, normal and UV.
+ */
+void ExpandObjCorner(const ObjData& obj, const ObjCorner& corner, float* out)
+{
+	glm::vec3 vertex = (corner.v >= 0 && corner.v < (int)obj.positions.size()) ? obj.positions[corner.v] : glm::vec3(0.f);
+	glm::vec2 uv = (corner.vt >= 0 && corner.vt < (int)obj.uvs.size()) ? obj.uvs[corner.vt] : glm::vec2(0.f);
+	glm::vec3 normal = (corner.vn >= 0 && corner.vn < (int)obj.normals.size()) ? obj.normals[corner.vn] : glm::vec3(0.f);
+
+	out[0] = vertex.x;
+	out[1] = vertex.y;
+	out[2] = vertex.z;
+	out[3] = normal.x;
+	out[4] = normal.y;
+	out[5] = normal.z;
+	out[6] = uv.x;
+	out[7] = uv.y;
+}
+
+// Expands corners [first, last) into consecutive vertices
+void ExpandObjCorners(const ObjData& obj, size_t first, size_t last, float* out)
+{
+	for (size_t i = first; i < last; i++)
+	{
+		ExpandObjCorner(obj, obj.corners[i], out);
+		out += MESH_VERTEX_STRIDE;
+	}
+}
+
+std::vector<float> ExpandObjData(const ObjData& obj)
+{
+	std::vector<float> vertices(obj.corners.size() * MESH_VERTEX_STRIDE);
+	ExpandObjCorners(obj, 0, obj.corners.size(), vertices.data());
+	return vertices;
+}
+
+/**
+ * @brief Reads an OBJ file and extracts vertex, normal, and UV data.
+ *
+ * The file is memory-mapped and tokenized in place, so no per-line strings or streams are created.
+ *
+ * @param filePath The path to the OBJ file.
+ * @return A vector containing the vertex data (interleaved position, normal, and UV).
+ */
+std::vector<float> ReadObjFile(const std::string& filePath)
+{
+	MappedFile file;
+	if (!MapFile(filePath.c_str(), file))
+	{
+		std::cerr << "Failed to open file: " << filePath << std::endl;
+		return std::vector<float>();
+	}
+
+	ArenaScope scope;
+	ObjData obj;
+	ParseObj(file.data, file.data + file.size, obj);
+	UnmapFile(file);
+
+	return ExpandObjData(obj);
+}
+
+/**
+ * @brief Multi-threaded ReadObjFile, the output is bit-identical to the serial reader.
+ *
+ * @param filePath The path to the OBJ file.
+ * @param pool The pool to parse on.
+ * @return A vector containing the vertex data (interleaved position, normal, and UV).
+ */
+std::vector<float> ReadObjFileParallel(const std::string& filePath, ThreadPool& pool)
+{
+	MappedFile file;
+	if (!MapFile(filePath.c_str(), file))
+	{
+		std::cerr << "Failed to open file: " << filePath << std::endl;
+		return std::vector<float>();
+	}
+
+	ArenaScope scope;
+	ObjData obj;
+	ParseObjParallel(file.data, file.data + file.size, obj, pool);
+	UnmapFile(file);
+
+	std::vector<float> vertices(obj.corners.size() * MESH_VERTEX_STRIDE);
+	const size_t cornersPerTask = 16 * 1024;
+	size_t tasks = (obj.corners.size() + cornersPerTask - 1) / cornersPerTask;
+	ParallelFor(pool, tasks, [&](size_t i)
+	{
+		size_t first = i * cornersPerTask;
+		size_t last = first + cornersPerTask < obj.corners.size() ? first + cornersPerTask : obj.corners.size();
+		ExpandObjCorners(obj, first, last, vertices.data() + first * MESH_VERTEX_STRIDE);
+	});
+	return vertices;
+}
+
+unsigned int HashObjCorner(const ObjCorner& corner)
+{
+	unsigned int h = (unsigned int)corner.v * 0x9E3779B1u;
+	h ^= (unsigned int)corner.vt * 0x85EBCA77u;
+	h ^= (unsigned int)corner.vn * 0xC2B2AE3Du;
+	return h ^ (h >> 15);
+}
+
+/**
+ * @brief Builds an indexed mesh, merging corners that share the same (v, vt, vn) triple.
+ *
+ * Uses an open-addressing hash table sized once for the worst case, so there is no rehashing.
+ * Every OBJ group becomes a submesh with its own index range, material name and bounds.
+ *
+ * @param obj The parsed OBJ data.
+ * @return The mesh with one vertex per unique corner.
+ */
+Mesh BuildIndexedMesh(const ObjData& obj)
+{
+	Mesh mesh;
+	size_t cornerCount = obj.corners.size();
+	mesh.indices.resize(cornerCount);
+
+	size_t capacity = 16;
+	while (capacity < cornerCount * 2)
+		capacity <<= 1;
+	const unsigned int EMPTY = 0xFFFFFFFFu;
+	ArenaVector<unsigned int> slots(capacity, EMPTY);
+	ArenaVector<ObjCorner> unique;
+	unique.reserve(cornerCount);
+
+	for (size_t i = 0; i < cornerCount; i++)
+	{
+		const ObjCorner& corner = obj.corners[i];
+		size_t slot = HashObjCorner(corner) & (capacity - 1);
+		for (;;)
+		{
+			unsigned int index = slots[slot];
+			if (index == EMPTY)
+			{
+				index = (unsigned int)unique.size();
+				slots[slot] = index;
+				unique.push_back(corner);
+				mesh.indices[i] = index;
+				break;
+			}
+			const ObjCorner& other = unique[index];
+			if (other.v == corner.v && other.vt == corner.vt && other.vn == corner.vn)
+			{
+				mesh.indices[i] = index;
+				break;
+			}
+			slot = (slot + 1) & (capacity - 1);
+		}
+	}
+
+	mesh.vertices.resize(unique.size() * MESH_VERTEX_STRIDE);
+	for (size_t i = 0; i < unique.size(); i++)
+		ExpandObjCorner(obj, unique[i], mesh.vertices.data() + i * MESH_VERTEX_STRIDE);
+
+	for (const ObjGroup& group : obj.groups)
+	{
+		SubMesh submesh;
+		submesh.name = group.name;
+		submesh.material = group.material;
+		submesh.firstIndex = (unsigned int)group.firstCorner;
+		mesh.submeshes.push_back(submesh);
+	}
+	for (size_t i = 0; i < mesh.submeshes.size(); i++)
+	{
+		size_t last = i + 1 < mesh.submeshes.size() ? mesh.submeshes[i + 1].firstIndex : cornerCount;
+		mesh.submeshes[i].indexCount = (unsigned int)(last - mesh.submeshes[i].firstIndex);
+	}
+	ComputeMeshBounds(mesh);
+	return mesh;
+}
+
+/**
+ * @brief Reads the newmtl/Kd/Ks/Ke/Ns entries of an MTL file.
+ *
+ * @param filePath The path to the MTL file.
+ * @param materials Materials are appended here.
+ * @return False if the file could not be opened.
+ */
+bool ReadMtlFile(const std::string& filePath, std::vector<Material>& materials)
+{
+	MappedFile file;
+	if (!MapFile(filePath.c_str(), file))
+		return false;
+
+	const char* p = file.data;
+	const char* end = file.data + file.size;
+	Material* current = nullptr;
+	while (p < end)
+	{
+		p = SkipBlanks(p, end);
+		if (end - p > 7 && memcmp(p, "newmtl", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+		{
+			materials.push_back(Material());
+			current = &materials.back();
+			current->name = ReadObjName(p + 6, end);
+		}
+		else if (current != nullptr && end - p > 3 && (p[2] == ' ' || p[2] == '\t'))
+		{
+			glm::vec3* colour = nullptr;
+			if (p[0] == 'K' && p[1] == 'd')
+				colour = &current->diffuse;
+			else if (p[0] == 'K' && p[1] == 's')
+				colour = &current->specular;
+			else if (p[0] == 'K' && p[1] == 'e')
+				colour = &current->emissive;
+
+			if (colour != nullptr)
+			{
+				p = ParseObjFloat(p + 2, end, colour->x);
+				p = ParseObjFloat(p, end, colour->y);
+				p = ParseObjFloat(p, end, colour->z);
+			}
+			else if (p[0] == 'N' && p[1] == 's')
+			{
+				p = ParseObjFloat(p + 2, end, current->shininess);
+			}
+		}
+		p = SkipLine(p, end);
+	}
+	UnmapFile(file);
+	return true;
+}
+
+/**
+ * @brief Loads the materials of an OBJ file and links its submeshes to them.
+ *
+ * Both the mtllib files and the MTL next to the OBJ with the same base name are read, since
+ * some exports name a library that does not exist. Every MTL found is recorded in
+ * mesh.dependencies. Submeshes whose material is not found keep materialIndex -1.
+ *
+ * @param filePath The path to the OBJ file.
+ * @param obj The parsed OBJ data.
+ * @param mesh The mesh whose materials are resolved.
+ */
+void ResolveObjMaterials(const std::string& filePath, const ObjData& obj, Mesh& mesh)
+{
+	std::string directory = DirectoryOf(filePath);
+	std::vector<std::string> libraries;
+	for (const std::string& library : obj.materialLibraries)
+		libraries.push_back(directory + library);
+	size_t dot = filePath.find_last_of('.');
+	if (dot != std::string::npos && dot > directory.size())
+		libraries.push_back(filePath.substr(0, dot) + ".mtl");
+
+	std::vector<Material> library;
+	for (size_t i = 0; i < libraries.size(); i++)
+	{
+		bool seen = false;
+		for (size_t j = 0; j < i; j++)
+			seen = seen || libraries[j] == libraries[i];
+		if (!seen && ReadMtlFile(libraries[i], library))
+			mesh.dependencies.push_back(libraries[i]);
+	}
+
+	for (SubMesh& submesh : mesh.submeshes)
+	{
+		submesh.materialIndex = -1;
+		if (submesh.material.empty())
+			continue;
+		for (size_t i = 0; i < mesh.materials.size() && submesh.materialIndex < 0; i++)
+		{
+			if (mesh.materials[i].name == submesh.material)
+				submesh.materialIndex = (int)i;
+		}
+		for (size_t i = 0; i < library.size() && submesh.materialIndex < 0; i++)
+		{
+			if (library[i].name == submesh.material)
+			{
+				submesh.materialIndex = (int)mesh.materials.size();
+				mesh.materials.push_back(library[i]);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Reads an OBJ file into an indexed mesh and reports how many corners were merged.
+ *
+ * @param filePath The path to the OBJ file.
+ * @param pool The pool to parse on.
+ * @param mesh Receives the mesh.
+ * @return False if the file could not be opened.
+ */
+bool ReadObjMesh(const std::string& filePath, ThreadPool& pool, Mesh& mesh)
+{
+	MappedFile file;
+	if (!MapFile(filePath.c_str(), file))
+	{
+		std::cerr << "Failed to open file: " << filePath << std::endl;
+		return false;
+	}
+
+	ArenaScope scope;
+	ObjData obj;
+	ParseObjParallel(file.data, file.data + file.size, obj, pool);
+	UnmapFile(file);
+
+	mesh = BuildIndexedMesh(obj);
+	ResolveObjMaterials(filePath, obj, mesh);
+	size_t vertexCount = MeshVertexCount(mesh);
+	printf("ReadObjMesh - %s triangles=%zu vertices=%zu submeshes=%zu materials=%zu dedup=%.2fx\n", filePath.c_str(),
+		mesh.indices.size() / 3, vertexCount, mesh.submeshes.size(), mesh.materials.size(),
+		vertexCount ? (double)mesh.indices.size() / vertexCount : 0.0);
+	return true;
+}
+
+// Resumable reader that expands the faces of an OBJ file a chunk of vertices at a time,
+// without building the corner list or the expanded vertex array (see StreamObjMesh)
+struct ObjStream
+{
+	std::string path;
+	MappedFile file;
+	ObjData obj; // attribute pools, group records and libraries; corners stays empty
+	ObjCounts counts; // totals of the file
+	ObjCounts read; // records read by the face pass
+	const char* cursor = nullptr;
+	std::vector<ObjCorner> face; // triangulated corners of the current face
+	size_t faceNext = 0;
+	size_t emitted = 0; // vertices written so far
+	glm::vec3 boundsMin = glm::vec3(0.f); // of every position in the file
+	glm::vec3 boundsMax = glm::vec3(0.f);
+	glm::vec3 quantizationScale = glm::vec3(0.f);
+	std::vector<glm::vec3> recordMin; // bounds of the vertices written under each group record
+	std::vector<glm::vec3> recordMax;
+};
+
+/**
+ * @brief Opens an OBJ file for streaming: counts the records and reads the attribute pools.
+ *
+ * The faces are read later by ReadObjStream. Host memory is the attribute pools only; the
+ * file itself is memory-mapped.
+ *
+ * @param filePath The path to the OBJ file.
+ * @param stream Receives the open stream.
+ * @return False if the file could not be opened.
+ */
+bool OpenObjStream(const std::string& filePath, ObjStream& stream)
+{
+	if (!MapFile(filePath.c_str(), stream.file))
+	{
+		std::cerr << "Failed to open file: " << filePath << std::endl;
+		return false;
+	}
+	stream.path = filePath;
+	const char* begin = stream.file.data;
+	const char* end = begin + stream.file.size;
+	stream.counts = CountObjRecords(begin, end);
+	stream.obj.positions.resize(stream.counts.positions);
+	stream.obj.uvs.resize(stream.counts.uvs);
+	stream.obj.normals.resize(stream.counts.normals);
+
+	ObjCounts read;
+	for (const char* p = begin; p < end; p = SkipLine(p, end))
+	{
+		p = SkipBlanks(p, end);
+		switch (ObjRecordType(p, end))
+		{
+		case 'v':
+		case 't':
+		case 'n':
+			p = ParseObjAttribute(p, end, stream.obj, read);
+			break;
+		case 'm':
+			stream.obj.materialLibraries.push_back(ReadObjName(p + 6, end));
+			break;
+		}
+	}
+
+	if (!stream.obj.positions.empty())
+	{
+		stream.boundsMin = stream.boundsMax = stream.obj.positions[0];
+		for (const glm::vec3& position : stream.obj.positions)
+		{
+			stream.boundsMin = glm::min(stream.boundsMin, position);
+			stream.boundsMax = glm::max(stream.boundsMax, position);
+		}
+	}
+	stream.quantizationScale = PositionQuantizationScale(stream.boundsMin, stream.boundsMax);
+	stream.cursor = begin;
+	stream.recordMin.push_back(glm::vec3(FLT_MAX));
+	stream.recordMax.push_back(glm::vec3(-FLT_MAX));
+	return true;
+}
+
+/**
+ * @brief Expands the next vertices of an open stream, three per triangle corner.
+ *
+ * @param stream The stream to read from.
+ * @param format Layout to write: MESH_VERTEX_STRIDE floats or PackedVertex (quantized to the
+ *        stream bounds).
+ * @param out Destination with room for maxVertices vertices.
+ * @param maxVertices Capacity of out.
+ * @return Number of vertices written; less than maxVertices only at the end of the file.
+ */
+size_t ReadObjStream(ObjStream& stream, VertexFormat format, void* out, size_t maxVertices)
+{
+	const char* end = stream.file.data + stream.file.size;
+	size_t written = 0;
+	while (written < maxVertices)
+	{
+		if (stream.faceNext < stream.face.size())
+		{
+			float vertex[MESH_VERTEX_STRIDE];
+			ExpandObjCorner(stream.obj, stream.face[stream.faceNext++], vertex);
+			if (format == VERTEX_FORMAT_PACKED)
+				PackVertex(vertex, stream.boundsMin, stream.quantizationScale, ((PackedVertex*)out)[written]);
+			else
+				memcpy((float*)out + written * MESH_VERTEX_STRIDE, vertex, sizeof(vertex));
+			glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+			stream.recordMin.back() = glm::min(stream.recordMin.back(), position);
+			stream.recordMax.back() = glm::max(stream.recordMax.back(), position);
+			written++;
+			continue;
+		}
+		if (stream.cursor >= end)
+			break;
+
+		const char* p = SkipBlanks(stream.cursor, end);
+		switch (ObjRecordType(p, end))
+		{
+		// The attribute pools are complete, but the face pass counts records for relative indices
+		case 'v': stream.read.positions++; break;
+		case 't': stream.read.uvs++; break;
+		case 'n': stream.read.normals++; break;
+		case 'f':
+		{
+			int faceCorners = CountObjFaceCorners(p + 2, end);
+			stream.face.resize(faceCorners >= 3 ? (faceCorners - 2) * 3 : 0);
+			ObjCounts faceRead = stream.read;
+			faceRead.corners = 0;
+			ParseObjFace(p + 2, end, faceRead, stream.face.data());
+			stream.faceNext = 0;
+			break;
+		}
+		case 'o':
+		case 'u':
+			stream.obj.groups.push_back(ReadObjGroupRecord(p, end, stream.emitted + written));
+			stream.recordMin.push_back(glm::vec3(FLT_MAX));
+			stream.recordMax.push_back(glm::vec3(-FLT_MAX));
+			break;
+		}
+		stream.cursor = SkipLine(p, end);
+	}
+	stream.emitted += written;
+	return written;
+}
+
+/**
+ * @brief Closes a stream and describes what it wrote as a non-indexed mesh.
+ *
+ * mesh gets the submeshes (firstIndex and indexCount address vertices), materials, bounds and
+ * dependencies; its vertex and index arrays stay empty. Submesh spheres enclose the submesh box,
+ * since the vertices are no longer available to fit them tighter.
+ *
+ * @param stream The stream, read to the end.
+ * @param mesh Receives the description.
+ */
+void CloseObjStream(ObjStream& stream, Mesh& mesh)
+{
+	// Bounds of each final group are the union of the records that start inside it
+	std::vector<size_t> recordStart(1, 0);
+	for (const ObjGroup& record : stream.obj.groups)
+		recordStart.push_back(record.firstCorner);
+	FinalizeObjGroups(stream.obj.groups, stream.emitted);
+
+	mesh = Mesh();
+	size_t record = 0;
+	for (size_t i = 0; i < stream.obj.groups.size(); i++)
+	{
+		const ObjGroup& group = stream.obj.groups[i];
+		size_t last = i + 1 < stream.obj.groups.size() ? stream.obj.groups[i + 1].firstCorner : stream.emitted;
+		SubMesh submesh;
+		submesh.name = group.name;
+		submesh.material = group.material;
+		submesh.firstIndex = (unsigned int)group.firstCorner;
+		submesh.indexCount = (unsigned int)(last - group.firstCorner);
+		glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		for (; record < recordStart.size() && recordStart[record] < last; record++)
+		{
+			lo = glm::min(lo, stream.recordMin[record]);
+			hi = glm::max(hi, stream.recordMax[record]);
+		}
+		submesh.boundsMin = lo;
+		submesh.boundsMax = hi;
+		submesh.center = (lo + hi) * 0.5f;
+		submesh.radius = glm::length(hi - lo) * 0.5f;
+		mesh.submeshes.push_back(submesh);
+	}
+	mesh.boundsMin = stream.boundsMin;
+	mesh.boundsMax = stream.boundsMax;
+	ResolveObjMaterials(stream.path, stream.obj, mesh);
+	UnmapFile(stream.file);
+}
@@ -0,0 +1,266 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "hash.h"
+#include "lz.h"
+
+// Single-file asset archive. The header is followed by blobs starting on PAK_ALIGNMENT
+// boundaries, then the entry table sorted by path and the NUL-terminated path strings. A
+// stored blob is the file as is, so readers get a pointer into the mapped archive; a
+// compressed one is an LZ block (lz.h) that is decoded on open.
+
+const uint32_t PAK_VERSION = 1;
+const uint64_t PAK_ALIGNMENT = 64;
+
+enum PakEntryFlags
+{
+	PAK_COMPRESSED = 1,
+};
+
+struct PakHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t entryOffset;
+	uint64_t stringOffset;
+	uint64_t stringSize;
+};
+
+struct PakEntry
+{
+	uint32_t pathOffset; // relative to the string table
+	uint32_t flags; // PakEntryFlags
+	uint64_t offset; // of the blob, from the start of the archive
+	uint64_t storedSize; // bytes in the archive
+	uint64_t size; // bytes once decoded
+	int64_t time; // modification time of the packed file, as StampSourceFile reads it
+	uint64_t hash; // XXH64 of the decoded bytes
+};
+
+// Tables of an archive held in memory, valid while that memory is
+struct PakArchive
+{
+	const char* data = nullptr;
+	size_t size = 0;
+	const PakEntry* entries = nullptr;
+	uint32_t entryCount = 0;
+	const char* strings = nullptr;
+};
+
+// A file to put in an archive: the path it is found under and the file on disk
+struct PakInput
+{
+	std::string path;
+	std::string file;
+	bool compress = false; // kept stored anyway if compression saves less than an eighth
+};
+
+// Archive paths use '/' and have no leading "./", whatever the caller passes
+std::string NormalizePakPath(const char* path)
+{
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	while (normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+	return normalized;
+}
+
+uint64_t AlignPakOffset(uint64_t offset)
+{
+	return (offset + PAK_ALIGNMENT - 1) & ~(PAK_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Checks the header and tables of an archive in memory.
+ *
+ * @param data The archive, e.g. a mapped .pak file; must stay valid while pak is used.
+ * @param size Size of the archive.
+ * @param pak Receives the tables.
+ * @return False if the data is not a valid archive.
+ */
+bool OpenPak(const char* data, size_t size, PakArchive& pak)
+{
+	pak = PakArchive();
+	const PakHeader* header = (const PakHeader*)data;
+	if (data == nullptr || size < sizeof(PakHeader) || memcmp(header->magic, "PAK1", 4) != 0 || header->version != PAK_VERSION
+		|| header->entryOffset % alignof(PakEntry) != 0 || header->entryOffset > size
+		|| (size - header->entryOffset) / sizeof(PakEntry) < header->entryCount
+		|| header->stringOffset > size || size - header->stringOffset < header->stringSize
+		|| (header->stringSize > 0 && data[header->stringOffset + header->stringSize - 1] != '\0'))
+		return false;
+
+	const PakEntry* entries = (const PakEntry*)(data + header->entryOffset);
+	const char* strings = data + header->stringOffset;
+	for (uint32_t i = 0; i < header->entryCount; i++)
+	{
+		const PakEntry& entry = entries[i];
+		if (entry.pathOffset >= header->stringSize || entry.offset > size || size - entry.offset < entry.storedSize
+			|| ((entry.flags & PAK_COMPRESSED) == 0 && entry.storedSize != entry.size)
+			|| (i > 0 && strcmp(strings + entries[i - 1].pathOffset, strings + entry.pathOffset) >= 0))
+			return false;
+	}
+	pak.data = data;
+	pak.size = size;
+	pak.entries = entries;
+	pak.entryCount = header->entryCount;
+	pak.strings = strings;
+	return true;
+}
+
+const char* PakEntryPath(const PakArchive& pak, const PakEntry& entry)
+{
+	return pak.strings + entry.pathOffset;
+}
+
+// Binary search of the entry table; nullptr if the archive has no such file
+const PakEntry* FindPakEntry(const PakArchive& pak, const char* path)
+{
+	if (pak.entryCount == 0)
+		return nullptr;
+	std::string name = NormalizePakPath(path);
+	const PakEntry* first = pak.entries;
+	const PakEntry* last = pak.entries + pak.entryCount;
+	const PakEntry* found = std::lower_bound(first, last, name, [&pak](const PakEntry& entry, const std::string& key)
+	{
+		return strcmp(PakEntryPath(pak, entry), key.c_str()) < 0;
+	});
+	return found != last && name == PakEntryPath(pak, *found) ? found : nullptr;
+}
+
+/**
+ * @brief Copies or decodes an entry into memory of the caller.
+ *
+ * @param pak The archive.
+ * @param entry An entry of the archive.
+ * @param out Receives entry.size bytes.
+ * @return False if a compressed blob is corrupt.
+ */
+bool ReadPakEntry(const PakArchive& pak, const PakEntry& entry, char* out)
+{
+	const char* blob = pak.data + entry.offset;
+	if ((entry.flags & PAK_COMPRESSED) == 0)
+	{
+		memcpy(out, blob, (size_t)entry.size);
+		return true;
+	}
+	return LzDecompress(blob, (size_t)entry.storedSize, out, (size_t)entry.size);
+}
+
+bool ReadWholeFile(const std::string& path, std::vector<char>& data)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == NULL)
+		return false;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data.resize(size > 0 ? (size_t)size : 0);
+	bool ok = size >= 0 && fread(data.data(), 1, data.size(), f) == data.size();
+	fclose(f);
+	return ok;
+}
+
+/**
+ * @brief Writes an archive of the given files, replacing any previous one atomically.
+ *
+ * @param pakPath The archive to write.
+ * @param inputs The files; paths must be unique after NormalizePakPath.
+ * @return False if a file could not be read or the archive could not be written.
+ */
+bool WritePak(const std::string& pakPath, const std::vector<PakInput>& inputs)
+{
+	std::vector<PakInput> sorted = inputs;
+	for (PakInput& input : sorted)
+		input.path = NormalizePakPath(input.path.c_str());
+	std::sort(sorted.begin(), sorted.end(), [](const PakInput& a, const PakInput& b) { return a.path < b.path; });
+	for (size_t i = 1; i < sorted.size(); i++)
+	{
+		if (sorted[i].path == sorted[i - 1].path)
+		{
+			printf("WritePak - %s is listed twice\n", sorted[i].path.c_str());
+			return false;
+		}
+	}
+
+	std::string tempPath = pakPath + ".tmp";
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == NULL)
+	{
+		printf("WritePak - could not create %s\n", tempPath.c_str());
+		return false;
+	}
+	PakHeader header = {};
+	memcpy(header.magic, "PAK1", 4);
+	header.version = PAK_VERSION;
+	header.entryCount = (uint32_t)sorted.size();
+	std::vector<PakEntry> entries(sorted.size());
+	std::string strings;
+	std::vector<char> data, compressed;
+	uint64_t offset = sizeof(PakHeader);
+	const char padding[PAK_ALIGNMENT] = {};
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	for (size_t i = 0; ok && i < sorted.size(); i++)
+	{
+		const PakInput& input = sorted[i];
+		PakEntry& entry = entries[i];
+		std::error_code ec;
+		entry.time = (int64_t)std::filesystem::last_write_time(input.file, ec).time_since_epoch().count();
+		if (ec || !ReadWholeFile(input.file, data))
+		{
+			printf("WritePak - could not read %s\n", input.file.c_str());
+			ok = false;
+			break;
+		}
+		entry.pathOffset = (uint32_t)strings.size();
+		strings.append(input.path.c_str(), input.path.size() + 1);
+		entry.size = data.size();
+		entry.hash = XXH64(data.data(), data.size());
+
+		const char* blob = data.data();
+		entry.storedSize = data.size();
+		if (input.compress && !data.empty())
+		{
+			compressed.resize(LzCompressBound(data.size()));
+			size_t compressedSize = LzCompress(data.data(), data.size(), compressed.data(), compressed.size());
+			if (compressedSize > 0 && compressedSize <= data.size() - data.size() / 8)
+			{
+				entry.flags |= PAK_COMPRESSED;
+				entry.storedSize = compressedSize;
+				blob = compressed.data();
+			}
+		}
+		entry.offset = AlignPakOffset(offset);
+		ok = fwrite(padding, 1, (size_t)(entry.offset - offset), f) == entry.offset - offset
+			&& fwrite(blob, 1, (size_t)entry.storedSize, f) == entry.storedSize;
+		offset = entry.offset + entry.storedSize;
+	}
+
+	header.entryOffset = AlignPakOffset(offset);
+	header.stringOffset = header.entryOffset + entries.size() * sizeof(PakEntry);
+	header.stringSize = strings.size();
+	ok = ok && fwrite(padding, 1, (size_t)(header.entryOffset - offset), f) == header.entryOffset - offset
+		&& fwrite(entries.data(), sizeof(PakEntry), entries.size(), f) == entries.size()
+		&& fwrite(strings.data(), 1, strings.size(), f) == strings.size()
+		&& fseek(f, 0, SEEK_SET) == 0
+		&& fwrite(&header, sizeof(header), 1, f) == 1;
+	ok = fclose(f) == 0 && ok;
+
+	std::error_code ec;
+	if (ok)
+		std::filesystem::rename(tempPath, pakPath, ec);
+	if (!ok || ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
@@ -1,6 +1,5 @@
 #version 330 core
 
-in vec3 col;
 in vec3 nor;
 in vec3 FragPos;
 in vec2 tex;
@@ -17,10 +16,27 @@ uniform vec3 SunColour;
 
 uniform sampler2D Texture;
 
+// Must match MAX_MATERIALS in meshbuffer.h
+#define MAX_MATERIALS 256
+
+struct Material
+{
+	vec4 diffuse;  // Kd
+	vec4 specular; // Ks, Ns in w
+	vec4 emissive; // Ke
+};
+
+layout(std140) uniform Materials
+{
+	Material materials[MAX_MATERIALS];
+};
+
+uniform int materialIndex;
+
 
 out vec4 fragColour;
 
-float CalculateSunlightIllumination()
+vec3 CalculateSunlightIllumination(Material m)
 {
     float amb = 0.1f;
 
@@ -31,14 +47,14 @@ float CalculateSunlightIllumination()
 	vec3 NFromLight = -NToLight;
 	vec3 refDir = reflect(NFromLight, Nnor);
 	vec3 NcamDir = normalize(camPos - FragPos);
-	float spec = pow(max(dot(NcamDir, refDir), 0.f), 128);
+	float spec = pow(max(dot(NcamDir, refDir), 0.f), m.specular.w);
 
-	float i = (amb + diff + spec);
+	vec3 i = (amb + diff) * m.diffuse.rgb + spec * m.specular.rgb;
 
 	return i;
 }
 
-float CalculateSpotIllumination()
+vec3 CalculateSpotIllumination(Material m)
 {
 	float amb = 0.1f;
 
@@ -49,7 +65,7 @@ float CalculateSpotIllumination()
 	vec3 NFromLight = -NToLight;
 	vec3 refDir = reflect(NFromLight, Nnor);
 	vec3 NcamDir = normalize(camPos - FragPos);
-	float spec = pow(max(dot(NcamDir, refDir), 0.f), 128);
+	float spec = pow(max(dot(NcamDir, refDir), 0.f), m.specular.w);
 
 	float d = length(lightPos - FragPos);
 	float c = 1.5f;
@@ -61,14 +77,14 @@ float CalculateSpotIllumination()
 	vec3 NSpotDir = normalize(lightDirection);
 	float theta = dot(NFromLight, NSpotDir);
 
-	float i;
+	vec3 i;
 	if(theta > phi)
 	{
-		i = (amb + diff + spec) * att;
+		i = ((amb + diff) * m.diffuse.rgb + spec * m.specular.rgb) * att;
 	}
 	else
 	{
-		i = (amb) * att;
+		i = (amb * m.diffuse.rgb) * att;
 	}
 
 	return i;
@@ -76,16 +92,18 @@ float CalculateSpotIllumination()
 
 void main()
 {
+    Material m = materials[materialIndex];
+
     // Calculate illumination from the first light source
-    float phong1 = CalculateSpotIllumination();
-    vec3 lightEffect1 = phong1 * col * lightColour; // Color effect of the first light
+    vec3 phong1 = CalculateSpotIllumination(m);
+    vec3 lightEffect1 = phong1 * lightColour; // Color effect of the first light
 
     // Calculate illumination from the Sun
-    float phongSun = CalculateSunlightIllumination();
-    vec3 sunEffect = phongSun * col * SunColour; // Color effect of the sunlight
+    vec3 phongSun = CalculateSunlightIllumination(m);
+    vec3 sunEffect = phongSun * SunColour; // Color effect of the sunlight
 
-    // Combine the color contributions from both lights
-    vec3 combinedColor = lightEffect1 + sunEffect;
+    // Combine the color contributions from both lights, plus the material's own emission
+    vec3 combinedColor = lightEffect1 + sunEffect + m.emissive.rgb;
 
     // Apply the combined color to the texture color
     vec4 texColor = texture(Texture, tex);
@@ -1,7 +1,6 @@
 #version 330 core
 
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aCol;
 layout(location = 2) in vec3 aNor;
 layout(location = 3) in vec3 aTex;
 
@@ -9,7 +8,13 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
-out vec3 col;
+// Dequantizes packed positions (see PackMeshVertices); identity for float vertices
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+// Maps the texture coordinates to a bottom-left origin; flips v for zero-copy glTF meshes
+uniform vec2 texCoordScale;
+uniform vec2 texCoordOffset;
+
 out vec3 nor;
 out vec3 FragPos;
 out vec2 tex;
@@ -17,9 +22,9 @@ out vec2 tex;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.f);
-	FragPos = vec3(model * vec4(aPos, 1.f));
-	col = aCol;
+	vec3 position = aPos * positionScale + positionOffset;
+	gl_Position = projection * view * model * vec4(position, 1.f);
+	FragPos = vec3(model * vec4(position, 1.f));
 	nor = mat3(transpose(inverse(model))) * aNor;
-	tex = aTex.xy;
+	tex = aTex.xy * texCoordScale + texCoordOffset;
 }
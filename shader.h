@@ -5,10 +5,11 @@
 
 unsigned int LoadShader(const char* vertexShaderFile, const char* fragmentShaderFile)
 {
+	ArenaScope scope;
 	int success;
 	char infoLog[512];
 	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	char* vertexShaderSource = read_file(vertexShaderFile);
+	char* vertexShaderSource = read_file(vertexShaderFile, &scope.GetArena());
 	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
 	glCompileShader(vertexShader);
 	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
@@ -19,7 +20,7 @@ unsigned int LoadShader(const char* vertexShaderFile, const char* fragmentShader
 	}
 
 	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	char* fragmentShaderSource = read_file(fragmentShaderFile);
+	char* fragmentShaderSource = read_file(fragmentShaderFile, &scope.GetArena());
 	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
 	glCompileShader(fragmentShader);
 	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
@@ -34,9 +35,6 @@ unsigned int LoadShader(const char* vertexShaderFile, const char* fragmentShader
 	glAttachShader(shaderProgram, fragmentShader);
 	glLinkProgram(shaderProgram);
 
-	free(fragmentShaderSource);
-	free(vertexShaderSource);
-
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
 
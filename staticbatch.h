@@ -0,0 +1,247 @@
+#pragma once
+#include <glad/glad.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "meshbuffer.h"
+
+// One mesh of a static batch. mesh holds the part's draws, meshlets, levels of detail and bounds
+// with index ranges into the batch's index buffer, but no GL objects of its own; the part's
+// indices count from baseVertex.
+struct StaticBatchPart
+{
+	std::string name;
+	GLuint texture = 0;
+	GLint baseVertex = 0;
+	MeshBuffer mesh;
+};
+
+// Meshes that never move relative to each other, merged into one vertex and one index buffer so
+// they draw with a single VAO and one multi-draw per texture and material
+struct StaticBatch
+{
+	MeshBuffer buffer; // shared VAO/VBO/EBO; bounds are the union of the parts
+	std::vector<StaticBatchPart> parts;
+	Mesh staging; // vertices and indices of the parts until UploadStaticBatch
+	size_t maxPartVertices = 0;
+};
+
+// One index range of a part, as DrawStaticBatch groups them
+struct StaticBatchRange
+{
+	GLuint texture;
+	int materialSlot;
+	GLint baseVertex;
+	IndexRange range;
+};
+
+/**
+ * @brief Appends a mesh to a batch that has not been uploaded yet.
+ *
+ * Indices stay relative to the part and the part's draws, meshlets and levels of detail are
+ * moved to where its indices land in the batch, so everything PrepareObjMesh built still works.
+ *
+ * @param batch The batch.
+ * @param mesh The mesh; its bounds must be computed.
+ * @param texture The texture the part is drawn with.
+ * @param name Shown in the log.
+ */
+void AppendStaticPart(StaticBatch& batch, const Mesh& mesh, GLuint texture, const std::string& name)
+{
+	Mesh& staging = batch.staging;
+	size_t vertexCount = MeshVertexCount(mesh);
+	unsigned int firstIndex = (unsigned int)staging.indices.size();
+	if (batch.parts.empty())
+	{
+		staging.boundsMin = mesh.boundsMin;
+		staging.boundsMax = mesh.boundsMax;
+	}
+	else
+	{
+		staging.boundsMin = glm::min(staging.boundsMin, mesh.boundsMin);
+		staging.boundsMax = glm::max(staging.boundsMax, mesh.boundsMax);
+	}
+
+	StaticBatchPart part;
+	part.name = name;
+	part.texture = texture;
+	part.baseVertex = (GLint)MeshVertexCount(staging);
+	staging.vertices.insert(staging.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+	staging.indices.insert(staging.indices.end(), mesh.indices.begin(), mesh.indices.end());
+	batch.maxPartVertices = std::max(batch.maxPartVertices, vertexCount);
+
+	part.mesh.submeshes = mesh.submeshes;
+	for (SubMesh& submesh : part.mesh.submeshes)
+	{
+		submesh.firstIndex += firstIndex;
+		for (int level = 0; level < MESH_MAX_LODS - 1; level++)
+			submesh.lods[level].firstIndex += firstIndex;
+	}
+	part.mesh.meshlets = mesh.meshlets;
+	for (Meshlet& meshlet : part.mesh.meshlets)
+		meshlet.firstIndex += firstIndex;
+	part.mesh.lodCount = mesh.lodCount;
+	memcpy(part.mesh.lodErrors, mesh.lodErrors, sizeof(part.mesh.lodErrors));
+	part.mesh.boundsMin = mesh.boundsMin;
+	part.mesh.boundsMax = mesh.boundsMax;
+	BuildMeshDraws(part.mesh, mesh.materials);
+	batch.parts.push_back(part);
+}
+
+/**
+ * @brief PrepareObjMesh for a static part: a cache hit is decoded back into prepared.mesh and unmapped.
+ *
+ * @param filePath The path to the model file.
+ * @param pool The pool to parse on.
+ * @param prepared Receives the data to pass to AddStaticPart.
+ */
+void PrepareStaticMesh(const std::string& filePath, ThreadPool& pool, PreparedMesh& prepared)
+{
+	PrepareObjMesh(filePath, pool, prepared);
+	if (!prepared.cached)
+		return;
+	ReadMeshCache(prepared.view, prepared.path, prepared.mesh);
+	UnmapFile(prepared.cacheFile);
+	prepared.cached = false;
+}
+
+// Appends the result of PrepareStaticMesh to a batch and releases its CPU data
+void AddStaticPart(StaticBatch& batch, PreparedMesh& prepared, GLuint texture)
+{
+	if (!prepared.valid)
+		return;
+	AppendStaticPart(batch, prepared.mesh, texture, prepared.path);
+	prepared.mesh = Mesh();
+}
+
+/**
+ * @brief Creates the shared GPU buffers of a batch and releases its staging data.
+ *
+ * Packed positions are quantized to the bounds of the whole batch. Indices are stored as 16-bit
+ * when every part has at most 65536 vertices, since they count from each part's base vertex.
+ *
+ * @param batch The batch; no parts can be added afterwards.
+ * @param format The vertex layout to upload in.
+ */
+void UploadStaticBatch(StaticBatch& batch, VertexFormat format = meshVertexFormat)
+{
+	if (batch.parts.empty())
+		return;
+	ArenaScope scope;
+	const Mesh& staging = batch.staging;
+	ArenaVector<PackedVertex> packed;
+	const void* vertices = staging.vertices.data();
+	size_t vertexBytes = staging.vertices.size() * sizeof(float);
+	if (format == VERTEX_FORMAT_PACKED)
+	{
+		packed = PackMeshVertices(staging);
+		vertices = packed.data();
+		vertexBytes = packed.size() * sizeof(PackedVertex);
+	}
+
+	bool shortIndices = batch.maxPartVertices <= 0x10000;
+	if (shortIndices)
+	{
+		ArenaVector<unsigned short> narrow = NarrowIndices(staging.indices);
+		batch.buffer = UploadMeshData(vertices, vertexBytes, format, narrow.data(), narrow.size(), GL_UNSIGNED_SHORT);
+	}
+	else
+	{
+		batch.buffer = UploadMeshData(vertices, vertexBytes, format, staging.indices.data(), staging.indices.size(), GL_UNSIGNED_INT);
+	}
+	batch.buffer.boundsMin = staging.boundsMin;
+	batch.buffer.boundsMax = staging.boundsMax;
+	SetPositionDequantization(batch.buffer);
+	printf("UploadStaticBatch - %zu parts vertices=%zu indices=%zu (%d-bit) %.1f KB\n", batch.parts.size(),
+		MeshVertexCount(staging), staging.indices.size(), shortIndices ? 16 : 32,
+		(vertexBytes + staging.indices.size() * (shortIndices ? 2 : 4)) / 1024.0);
+	batch.staging = Mesh();
+}
+
+/**
+ * @brief Draws every part of a batch with one glMultiDrawElementsBaseVertex per texture and material.
+ *
+ * Each part is culled and gets its level of detail on its own, as DrawMesh would do, and its
+ * visible ranges join those of the other parts with the same texture and material slot.
+ *
+ * @param batch The uploaded batch.
+ * @param locations Uniform locations in the bound program.
+ * @param viewProjection The projection matrix times the view matrix.
+ * @param model The model matrix shared by all parts, already set in the program.
+ * @param cameraPosition The camera position in world space.
+ * @return The number of draw calls issued.
+ */
+size_t DrawStaticBatch(const StaticBatch& batch, const MeshShaderLocations& locations, const glm::mat4& viewProjection,
+	const glm::mat4& model, const glm::vec3& cameraPosition)
+{
+	const MeshBuffer& buffer = batch.buffer;
+	if (buffer.VAO == 0)
+		return 0;
+
+	ArenaScope scope;
+	MeshCullView cull = MakeMeshCullView(viewProjection, model, cameraPosition);
+	ArenaVector<StaticBatchRange> entries;
+	ArenaVector<IndexRange> ranges;
+	for (const StaticBatchPart& part : batch.parts)
+	{
+		const MeshBuffer& mesh = part.mesh;
+		glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+		float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+		if (!SphereInFrustum(cull, center, radius))
+			continue;
+		int lod = SelectMeshLod(mesh.lodErrors, mesh.lodCount, ProjectedPixelsPerUnit(viewProjection, model, center, radius), mesh.lodState);
+		for (const MeshDraw& draw : mesh.draws)
+		{
+			ranges.clear();
+			CollectDrawRanges(mesh, draw, &cull, lod, ranges);
+			for (const IndexRange& range : ranges)
+			{
+				StaticBatchRange entry = { part.texture, draw.materialSlot, part.baseVertex, range };
+				entries.push_back(entry);
+			}
+		}
+	}
+	std::stable_sort(entries.begin(), entries.end(), [](const StaticBatchRange& a, const StaticBatchRange& b)
+	{
+		return a.texture != b.texture ? a.texture < b.texture : a.materialSlot < b.materialSlot;
+	});
+
+	ArenaVector<GLsizei> counts;
+	ArenaVector<const void*> offsets;
+	ArenaVector<GLint> baseVertices;
+	size_t indexSize = buffer.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	glUniform3fv(locations.positionScale, 1, &buffer.positionScale.x);
+	glUniform3fv(locations.positionOffset, 1, &buffer.positionOffset.x);
+	glUniform2fv(locations.texCoordScale, 1, &buffer.texCoordScale.x);
+	glUniform2fv(locations.texCoordOffset, 1, &buffer.texCoordOffset.x);
+	glBindVertexArray(buffer.VAO);
+	size_t drawCalls = 0;
+	GLuint boundTexture = 0;
+	for (size_t first = 0; first < entries.size();)
+	{
+		size_t last = first;
+		counts.clear();
+		offsets.clear();
+		baseVertices.clear();
+		for (; last < entries.size() && entries[last].texture == entries[first].texture
+			&& entries[last].materialSlot == entries[first].materialSlot; last++)
+		{
+			counts.push_back((GLsizei)entries[last].range.indexCount);
+			offsets.push_back((const void*)(entries[last].range.firstIndex * indexSize));
+			baseVertices.push_back(entries[last].baseVertex);
+		}
+		if (drawCalls == 0 || entries[first].texture != boundTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, entries[first].texture);
+			boundTexture = entries[first].texture;
+		}
+		glUniform1i(locations.materialIndex, entries[first].materialSlot);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), buffer.indexType, offsets.data(), (GLsizei)counts.size(),
+			baseVertices.data());
+		drawCalls++;
+		first = last;
+	}
+	return drawCalls;
+}
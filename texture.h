@@ -3,13 +3,19 @@
 #include <iostream>
 #include "bitmap.h"
 
-GLuint setup_texture(const char* filename)
+/**
+ * @brief Fills a texture object with mipmapped BGR pixels decoded by loadbitmap.
+ *
+ * @param texObject A texture name from glGenTextures.
+ * @param pxls Tightly packed BGR pixels as returned by loadbitmap, or NULL to leave the texture empty.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ */
+void fill_texture(GLuint texObject, const unsigned char* pxls, int width, int height)
 {
 	glEnable(GL_TEXTURE_2D);
 	glEnable(GL_BLEND);
 
-	GLuint texObject;
-	glGenTextures(1, &texObject);
 	glBindTexture(GL_TEXTURE_2D, texObject);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -17,21 +23,29 @@ GLuint setup_texture(const char* filename)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
-	unsigned char* pxls = NULL;
-	BITMAPINFOHEADER info;
-	BITMAPFILEHEADER file;
-	loadbitmap(filename, pxls, &info, &file);
-
 	if (pxls != NULL)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, info.biWidth, info.biHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pxls);
+		// GL swizzles BMP's channel order itself; rows are not padded to four bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, pxls);
 	}
 	glGenerateMipmap(GL_TEXTURE_2D);
 
-	delete[] pxls;
-
 	glDisable(GL_TEXTURE_2D);
 	glDisable(GL_BLEND);
+}
+
+GLuint setup_texture(const char* filename)
+{
+	ArenaScope scope;
+	unsigned char* pxls = NULL;
+	BITMAPINFOHEADER info;
+	BITMAPFILEHEADER file;
+	loadbitmap(filename, pxls, &info, &file, &scope.GetArena());
+
+	GLuint texObject;
+	glGenTextures(1, &texObject);
+	fill_texture(texObject, pxls, info.biWidth, info.biHeight);
 
 	return texObject;
 	//return 0;
@@ -63,7 +77,8 @@ GLuint setup_mipmaps(const char* filename[], int n)
 
 		if (pxls != NULL)
 		{
-			glTexImage2D(GL_TEXTURE_2D, c, GL_RGB, info[c].biWidth, info[c].biHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pxls[c]);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, c, GL_RGB, info[c].biWidth, info[c].biHeight, 0, GL_BGR, GL_UNSIGNED_BYTE, pxls[c]);
 		}
 
 		delete[] pxls[c];
@@ -0,0 +1,114 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include "bitmap.h"
+#include "contentcache.h"
+
+// Bump whenever the layout or the decoding that produces the cached pixels changes
+const uint32_t TEXTURE_CACHE_VERSION = 2;
+
+// On-disk header of a decoded texture; BGR pixels as loadbitmap returns them follow at pixelOffset
+struct TextureCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint64_t pixelOffset;
+	uint64_t pixelSize;
+};
+
+/**
+ * @brief Maps the decoded pixels of an image by the content key of its file.
+ *
+ * @param key The content key of the image file, from ContentKeyOf.
+ * @param file Receives the mapping, which must stay open while pixels is used.
+ * @param pixels Receives the BGR pixels, bottom row first.
+ * @param width Receives the width in pixels.
+ * @param height Receives the height in pixels.
+ * @return False if there is no usable entry.
+ */
+bool OpenTextureCache(uint64_t key, MappedFile& file, const unsigned char*& pixels, int& width, int& height)
+{
+	if (!MapFile(ContentCachePath(key, "tex").c_str(), file))
+		return false;
+	const TextureCacheHeader* header = (const TextureCacheHeader*)file.data;
+	bool valid = file.size >= sizeof(TextureCacheHeader)
+		&& memcmp(header->magic, "TEXC", 4) == 0
+		&& header->version == TEXTURE_CACHE_VERSION
+		&& header->pixelSize == (uint64_t)header->width * header->height * 3
+		&& header->pixelOffset <= file.size && file.size - header->pixelOffset >= header->pixelSize;
+	if (!valid)
+	{
+		UnmapFile(file);
+		return false;
+	}
+	pixels = (const unsigned char*)file.data + header->pixelOffset;
+	width = (int)header->width;
+	height = (int)header->height;
+	return true;
+}
+
+/**
+ * @brief Writes the decoded pixels of an image, replacing any previous entry atomically.
+ *
+ * @param key The content key of the image file, from ContentKeyOf.
+ * @param pixels BGR pixels, bottom row first.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @return False if the entry could not be written.
+ */
+bool WriteTextureCache(uint64_t key, const unsigned char* pixels, int width, int height)
+{
+	TextureCacheHeader header = {};
+	memcpy(header.magic, "TEXC", 4);
+	header.version = TEXTURE_CACHE_VERSION;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.pixelOffset = 64;
+	header.pixelSize = (uint64_t)width * height * 3;
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_DIR, ec);
+	std::string path = ContentCachePath(key, "tex");
+	std::string tempPath = CacheTempPath(path);
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	const char padding[64] = {};
+	bool written = fwrite(&header, sizeof(header), 1, f) == 1
+		&& fwrite(padding, 1, (size_t)header.pixelOffset - sizeof(header), f) == header.pixelOffset - sizeof(header)
+		&& fwrite(pixels, 1, (size_t)header.pixelSize, f) == header.pixelSize;
+	written = fclose(f) == 0 && written;
+	if (written)
+		std::filesystem::rename(tempPath, path, ec);
+	if (!written || ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Decodes an image file with loadbitmap and writes its texture cache entry.
+ *
+ * @param filePath The path to the BMP file.
+ * @param key The content key of the file, from ContentKeyOf.
+ * @return False if the image could not be decoded or the entry could not be written.
+ */
+bool BakeTexture(const std::string& filePath, uint64_t key)
+{
+	ArenaScope scope;
+	unsigned char* pixels = NULL;
+	BITMAPINFOHEADER info;
+	BITMAPFILEHEADER file;
+	if (!loadbitmap(filePath.c_str(), pixels, &info, &file, &scope.GetArena()))
+		return false;
+	return WriteTextureCache(key, pixels, info.biWidth, info.biHeight);
+}
@@ -0,0 +1,247 @@
+#pragma once
+#include <glad/glad.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "contentcache.h"
+
+enum TextureAcquireResult
+{
+	TEXTURE_CREATED, // a new name; the caller fills it and calls SetTextureSize
+	TEXTURE_PATH_HIT, // the path was acquired before
+	TEXTURE_CONTENT_HIT, // another path with the same contents was acquired before
+	TEXTURE_REFILL, // from Reacquire: the path keeps its name, which the caller fills again
+};
+
+// What a TextureManager saved, for the log
+struct TextureManagerStats
+{
+	size_t requests = 0; // Acquire calls
+	size_t pathHits = 0;
+	size_t contentHits = 0;
+	size_t textures = 0; // GL textures alive
+	size_t residentBytes = 0; // estimated VRAM of those textures
+	size_t savedBytes = 0; // estimated VRAM the hits on them would have taken as copies
+};
+
+/**
+ * @brief Estimates the VRAM of an RGB texture with a full mip chain.
+ *
+ * Drivers store GL_RGB8 with four bytes per texel, so that is what is counted.
+ *
+ * @param width Width of level 0 in pixels.
+ * @param height Height of level 0 in pixels.
+ * @return The bytes of all levels.
+ */
+size_t TextureBytes(int width, int height)
+{
+	size_t bytes = 0;
+	for (;;)
+	{
+		bytes += (size_t)width * height * 4;
+		if (width <= 1 && height <= 1)
+			return bytes;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+}
+
+// Hands out one GL texture per image: a path acquired again, or a file with the same contents
+// as one acquired before, gets the existing name and adds a reference; the last Release deletes
+// it. Each path's name is kept in one place, so the reference Acquire returns follows the path
+// when Reacquire moves it to a texture of its own. Use on the GL thread only.
+class TextureManager
+{
+public:
+	TextureManager() = default;
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	/**
+	 * @brief Finds or creates the texture of an image file and adds a reference to it.
+	 *
+	 * @param path The path to the image file.
+	 * @param result Receives whether the name is new and must be filled by the caller.
+	 * @return The path's texture name, valid until its last reference is released.
+	 */
+	const GLuint& Acquire(const std::string& path, TextureAcquireResult& result)
+	{
+		stats.requests++;
+		std::map<std::string, GLuint>::iterator byPath = paths.find(path);
+		if (byPath != paths.end())
+		{
+			result = TEXTURE_PATH_HIT;
+			stats.pathHits++;
+			AddReference(byPath->second, path, 1);
+			return byPath->second;
+		}
+		uint64_t key = 0;
+		bool keyed = ContentKeyOf(path, key);
+		std::map<uint64_t, GLuint>::iterator byContent = keyed ? contents.find(key) : contents.end();
+		if (byContent != contents.end())
+		{
+			result = TEXTURE_CONTENT_HIT;
+			stats.contentHits++;
+			GLuint& slot = paths[path] = byContent->second;
+			AddReference(slot, path, 1);
+			return slot;
+		}
+
+		result = TEXTURE_CREATED;
+		GLuint& slot = paths[path] = Create(keyed, key);
+		AddReference(slot, path, 1);
+		return slot;
+	}
+
+	/**
+	 * @brief Gives a path whose file changed a texture that holds only its new contents.
+	 *
+	 * A texture the path shares with other paths stays theirs: the path and its references move
+	 * to a new name, or to the texture of another path that now has the same contents. A texture
+	 * of the path alone keeps its name. The reference Acquire returned is updated.
+	 *
+	 * @param path A path acquired before.
+	 * @param keyed Whether key is the content key of the changed file.
+	 * @param key The content key.
+	 * @param result TEXTURE_REFILL or TEXTURE_CREATED if the caller must fill the name and call SetTextureSize.
+	 * @return The path's texture name, or 0 if the path is not acquired.
+	 */
+	GLuint Reacquire(const std::string& path, bool keyed, uint64_t key, TextureAcquireResult& result)
+	{
+		std::map<std::string, GLuint>::iterator byPath = paths.find(path);
+		if (byPath == paths.end())
+			return 0;
+		GLuint old = byPath->second;
+		Entry& entry = entries[old];
+		std::map<uint64_t, GLuint>::iterator byContent = keyed ? contents.find(key) : contents.end();
+		bool unchanged = keyed && entry.keyed && entry.key == key;
+		if (unchanged || ((byContent == contents.end() || byContent->second == old) && entry.paths.size() == 1))
+		{
+			// Only this path draws with the name, so refill it and key it by the new contents
+			if (entry.keyed)
+				ForgetContents(entry.key, old);
+			entry.keyed = keyed;
+			entry.key = key;
+			if (keyed)
+				contents[key] = old;
+			result = TEXTURE_REFILL;
+			return old;
+		}
+
+		GLuint texture;
+		if (byContent != contents.end())
+		{
+			result = TEXTURE_CONTENT_HIT;
+			texture = byContent->second;
+		}
+		else
+		{
+			result = TEXTURE_CREATED;
+			texture = Create(keyed, key);
+		}
+		// Keep a reference for every other path on the old name, in case some were released
+		size_t moved = std::min(entry.paths[path], entry.references - (entry.paths.size() - 1));
+		entry.paths.erase(path);
+		entry.references -= moved;
+		entry.acquisitions -= moved;
+		AddReference(texture, path, moved);
+		byPath->second = texture;
+		if (entry.references == 0)
+			Delete(entries.find(old));
+		return texture;
+	}
+
+	// Records the size a texture was filled with, for the VRAM estimates
+	void SetTextureSize(GLuint texture, int width, int height)
+	{
+		std::map<GLuint, Entry>::iterator found = entries.find(texture);
+		if (found != entries.end())
+			found->second.bytes = width > 0 && height > 0 ? TextureBytes(width, height) : 0;
+	}
+
+	// Drops a reference; the last one deletes the texture and forgets its paths
+	void Release(GLuint texture)
+	{
+		std::map<GLuint, Entry>::iterator found = entries.find(texture);
+		if (found != entries.end() && --found->second.references == 0)
+			Delete(found);
+	}
+
+	TextureManagerStats Stats() const
+	{
+		TextureManagerStats current = stats;
+		current.textures = entries.size();
+		for (const std::pair<const GLuint, Entry>& entry : entries)
+		{
+			current.residentBytes += entry.second.bytes;
+			current.savedBytes += (entry.second.acquisitions - 1) * entry.second.bytes;
+		}
+		return current;
+	}
+
+	void PrintStats(const char* caller) const
+	{
+		TextureManagerStats current = Stats();
+		printf("%s - %zu texture requests, %zu hits (%zu by path, %zu by content), %zu textures %.1f MB in VRAM, %.1f MB saved\n",
+			caller, current.requests, current.pathHits + current.contentHits, current.pathHits, current.contentHits, current.textures,
+			current.residentBytes / (1024.0 * 1024.0), current.savedBytes / (1024.0 * 1024.0));
+	}
+
+private:
+	struct Entry
+	{
+		std::map<std::string, size_t> paths; // to the references taken through each
+		bool keyed = false;
+		uint64_t key = 0; // content key, if keyed
+		size_t references = 0;
+		size_t acquisitions = 0; // including released ones
+		size_t bytes = 0;
+	};
+
+	// Another texture may have taken over the key since
+	void ForgetContents(uint64_t key, GLuint texture)
+	{
+		std::map<uint64_t, GLuint>::iterator found = contents.find(key);
+		if (found != contents.end() && found->second == texture)
+			contents.erase(found);
+	}
+
+	void Delete(std::map<GLuint, Entry>::iterator found)
+	{
+		GLuint texture = found->first;
+		for (const std::pair<const std::string, size_t>& path : found->second.paths)
+			paths.erase(path.first);
+		if (found->second.keyed)
+			ForgetContents(found->second.key, texture);
+		entries.erase(found);
+		glDeleteTextures(1, &texture);
+	}
+
+	GLuint Create(bool keyed, uint64_t key)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+		Entry& entry = entries[texture];
+		entry.keyed = keyed;
+		entry.key = key;
+		if (keyed)
+			contents[key] = texture;
+		return texture;
+	}
+
+	void AddReference(GLuint texture, const std::string& path, size_t count)
+	{
+		Entry& entry = entries[texture];
+		entry.paths[path] += count;
+		entry.references += count;
+		entry.acquisitions += count;
+	}
+
+	std::map<GLuint, Entry> entries;
+	std::map<std::string, GLuint> paths;
+	std::map<uint64_t, GLuint> contents;
+	TextureManagerStats stats;
+};
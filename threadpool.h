@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO of tasks
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int threads = 0)
+	{
+		if (threads == 0)
+			threads = std::thread::hardware_concurrency();
+		if (threads == 0)
+			threads = 1;
+		for (unsigned int i = 0; i < threads; i++)
+			workers.emplace_back([this]() { WorkerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		wake.notify_one();
+	}
+
+	unsigned int Size() const
+	{
+		return (unsigned int)workers.size();
+	}
+
+private:
+	void WorkerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (tasks.empty())
+					return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
+
+/**
+ * @brief Runs body(0) .. body(count - 1) on the pool and returns when all have finished.
+ *
+ * The calling thread takes part in the work, so this is safe to call from inside a pool task.
+ *
+ * @param pool The pool providing the helper threads.
+ * @param count Number of iterations.
+ * @param body Function called once per iteration index.
+ */
+void ParallelFor(ThreadPool& pool, size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	struct State
+	{
+		std::atomic<size_t> next{ 0 };
+		size_t done = 0;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	const std::function<void(size_t)>* work = &body;
+
+	// Helpers that start after every index is claimed return without touching body
+	auto run = [state, count, work]()
+	{
+		size_t completed = 0;
+		for (size_t i = state->next++; i < count; i = state->next++)
+		{
+			(*work)(i);
+			completed++;
+		}
+		if (completed > 0)
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->done += completed;
+			if (state->done == count)
+				state->finished.notify_all();
+		}
+	};
+
+	size_t helpers = count - 1 < pool.Size() ? count - 1 : pool.Size();
+	for (size_t i = 0; i < helpers; i++)
+		pool.Submit(run);
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state, count]() { return state->done == count; });
+}
@@ -0,0 +1,462 @@
+// Bakes models and images into the content-addressed cache (contentcache.h), so the viewer maps
+// processed meshes and decoded textures instead of parsing OBJ and decoding BMP files at startup.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. -Iinclude tools/asset_baker.cpp -o asset_baker
+//   ./asset_baker [-j N] [--force] [file-or-directory...]
+//
+// Directories (default: resources) are searched recursively for .obj, .glb and .bmp files.
+// cache/manifest.json lists the inputs of every baked asset with their stamps and hashes: a
+// model depends on its file and the MTL files it reads, and an MTL depends on the textures it
+// names (map_Kd and the like), which are baked along with the model. An asset is rebuilt only
+// when one of its inputs changed or its cache entry is gone; --force rebuilds everything.
+// Assets are baked in parallel on N threads (default: all cores), files with the same contents
+// once. Run tools/pak_packer afterwards to ship the cache in the archive.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+#include "json.h"
+#include "meshbake.h"
+#include "texturecache.h"
+
+// Bump whenever the manifest layout changes
+const int BAKE_MANIFEST_VERSION = 1;
+const char BAKE_MANIFEST_PATH[] = "cache/manifest.json";
+
+enum BakeKind
+{
+	BAKE_MESH,
+	BAKE_TEXTURE,
+};
+
+enum BakeResult
+{
+	BAKE_FAILED,
+	BAKE_UP_TO_DATE,
+	BAKE_REUSED, // the entry was there, built by the viewer or for a file with the same contents
+	BAKE_BUILT,
+};
+
+// A file an asset was built from, as it was then
+struct BakeInput
+{
+	std::string path;
+	SourceStamp stamp;
+};
+
+// Manifest entry of one source file
+struct BakeRecord
+{
+	std::string source;
+	BakeKind kind = BAKE_MESH;
+	uint64_t key = 0;
+	std::vector<BakeInput> inputs; // the source first
+	std::vector<std::string> textures; // named by the MTL inputs
+	BakeResult result = BAKE_FAILED;
+};
+
+bool HasBakeExtension(const std::string& path, BakeKind& kind)
+{
+	if (HasExtension(path, "obj") || HasExtension(path, "glb"))
+		kind = BAKE_MESH;
+	else if (HasExtension(path, "bmp"))
+		kind = BAKE_TEXTURE;
+	else
+		return false;
+	return true;
+}
+
+// The versions and layout every entry in a manifest was built with; a mismatch rebuilds everything
+std::string BakeSettings()
+{
+	char settings[64];
+	snprintf(settings, sizeof(settings), "%d/%u/%u/%d", BAKE_MANIFEST_VERSION, MESH_CACHE_VERSION, TEXTURE_CACHE_VERSION,
+		(int)meshVertexFormat);
+	return settings;
+}
+
+uint64_t ParseHex(const std::string& text)
+{
+	return strtoull(text.c_str(), nullptr, 16);
+}
+
+std::string FormatHex(uint64_t value)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)value);
+	return text;
+}
+
+/**
+ * @brief Reads the manifest of an earlier run.
+ *
+ * @param records Receives the entries by source path.
+ * @return False if there is no manifest, it does not parse or it was written with other settings.
+ */
+bool ReadBakeManifest(std::map<std::string, BakeRecord>& records)
+{
+	MappedFile file;
+	if (!MapDiskFile(BAKE_MANIFEST_PATH, file))
+		return false;
+	JsonValue manifest;
+	std::string error;
+	bool parsed = ParseJson(file.data, file.data + file.size, manifest, &error);
+	UnmapFile(file);
+	if (!parsed)
+	{
+		printf("asset_baker - ignoring %s: %s\n", BAKE_MANIFEST_PATH, error.c_str());
+		return false;
+	}
+	if (manifest.String("settings") != BakeSettings())
+		return false;
+
+	const JsonValue* assets = manifest.Find("assets");
+	for (size_t i = 0; i < (assets != nullptr ? assets->Size() : 0); i++)
+	{
+		const JsonValue* asset = assets->At(i);
+		if (asset == nullptr || asset->type != JSON_OBJECT)
+			continue;
+		BakeRecord record;
+		record.source = asset->String("source");
+		record.kind = asset->String("kind") == "texture" ? BAKE_TEXTURE : BAKE_MESH;
+		record.key = ParseHex(asset->String("key"));
+		const JsonValue* inputs = asset->Find("inputs");
+		for (size_t j = 0; j < (inputs != nullptr ? inputs->Size() : 0); j++)
+		{
+			const JsonValue* in = inputs->At(j);
+			if (in == nullptr || in->type != JSON_OBJECT)
+				continue;
+			BakeInput input;
+			input.path = in->String("path");
+			input.stamp.size = (uint64_t)in->Number("size", 0.0);
+			input.stamp.time = strtoll(in->String("time").c_str(), nullptr, 10);
+			input.stamp.hash = ParseHex(in->String("hash"));
+			record.inputs.push_back(input);
+		}
+		const JsonValue* textures = asset->Find("textures");
+		for (size_t j = 0; j < (textures != nullptr ? textures->Size() : 0); j++)
+		{
+			const JsonValue* texture = textures->At(j);
+			if (texture != nullptr && texture->type == JSON_STRING)
+				record.textures.push_back(texture->string);
+		}
+		if (!record.source.empty() && !record.inputs.empty())
+			records[record.source] = record;
+	}
+	return true;
+}
+
+// Writes the manifest, replacing the old one atomically
+bool WriteBakeManifest(const std::map<std::string, BakeRecord>& records)
+{
+	std::string json = "{\n\t\"settings\": " + JsonEscape(BakeSettings()) + ",\n\t\"assets\": [";
+	bool first = true;
+	for (const std::pair<const std::string, BakeRecord>& entry : records)
+	{
+		const BakeRecord& record = entry.second;
+		json += first ? "\n\t\t{" : ",\n\t\t{";
+		first = false;
+		json += "\"source\": " + JsonEscape(record.source) + ", \"kind\": " + (record.kind == BAKE_TEXTURE ? "\"texture\"" : "\"mesh\"")
+			+ ", \"key\": \"" + FormatHex(record.key) + "\",\n\t\t\t\"inputs\": [";
+		for (size_t i = 0; i < record.inputs.size(); i++)
+		{
+			const BakeInput& input = record.inputs[i];
+			json += (i ? ", {" : "{") + std::string("\"path\": ") + JsonEscape(input.path) + ", \"size\": "
+				+ std::to_string(input.stamp.size) + ", \"time\": \"" + std::to_string(input.stamp.time) + "\", \"hash\": \""
+				+ FormatHex(input.stamp.hash) + "\"}";
+		}
+		json += "],\n\t\t\t\"textures\": [";
+		for (size_t i = 0; i < record.textures.size(); i++)
+			json += (i ? ", " : "") + JsonEscape(record.textures[i]);
+		json += "]}";
+	}
+	json += "\n\t]\n}\n";
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_DIR, ec);
+	std::string tempPath = CacheTempPath(BAKE_MANIFEST_PATH);
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	bool written = fwrite(json.data(), 1, json.size(), f) == json.size();
+	written = fclose(f) == 0 && written;
+	if (written)
+		std::filesystem::rename(tempPath, BAKE_MANIFEST_PATH, ec);
+	if (!written || ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+// Image files an MTL file names in its map_* and bump statements, next to the MTL
+std::vector<std::string> ReadMtlTextures(const std::string& mtlPath)
+{
+	std::vector<std::string> textures;
+	MappedFile file;
+	if (!MapFile(mtlPath.c_str(), file))
+		return textures;
+	std::string directory = DirectoryOf(mtlPath);
+	const char* p = file.data;
+	const char* end = file.data + file.size;
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		while (p < lineEnd && (*p == ' ' || *p == '\t'))
+			p++;
+		if ((lineEnd - p > 4 && memcmp(p, "map_", 4) == 0) || (lineEnd - p > 5 && memcmp(p, "bump ", 5) == 0))
+		{
+			// The file name is the last word; options such as -bm 1.0 come before it
+			const char* nameEnd = lineEnd;
+			while (nameEnd > p && (nameEnd[-1] == '\r' || nameEnd[-1] == ' ' || nameEnd[-1] == '\t'))
+				nameEnd--;
+			const char* name = nameEnd;
+			while (name > p && name[-1] != ' ' && name[-1] != '\t')
+				name--;
+			if (name > p && name < nameEnd)
+				textures.push_back(directory + std::string(name, nameEnd));
+		}
+		p = lineEnd + 1;
+	}
+	UnmapFile(file);
+	return textures;
+}
+
+// True if every input still matches its stamp and the entry the record points at exists
+bool BakeRecordUpToDate(const BakeRecord& record, uint64_t key)
+{
+	std::error_code ec;
+	if (record.key != key || record.inputs.empty() || record.inputs[0].path != record.source
+		|| !std::filesystem::exists(ContentCachePath(key, record.kind == BAKE_TEXTURE ? "tex" : "mesh"), ec))
+		return false;
+	for (const BakeInput& input : record.inputs)
+	{
+		if (!SourceStampMatches(input.path, input.stamp))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Brings the cache entry of one source up to date and fills in its manifest record.
+ *
+ * @param record The record; source, kind and key are set, the rest is from the last run if any.
+ * @param previous True if record came from the manifest.
+ * @param force Rebuild even if the inputs did not change.
+ * @param pool The pool BakeMesh parses on.
+ */
+void BakeAsset(BakeRecord& record, bool previous, bool force, ThreadPool& pool)
+{
+	if (previous && !force && BakeRecordUpToDate(record, record.key))
+	{
+		record.result = BAKE_UP_TO_DATE;
+		return;
+	}
+
+	std::vector<std::string> dependencies;
+	if (record.kind == BAKE_TEXTURE)
+	{
+		MappedFile file;
+		const unsigned char* pixels;
+		int width, height;
+		if (!force && OpenTextureCache(record.key, file, pixels, width, height))
+		{
+			record.result = BAKE_REUSED;
+			UnmapFile(file);
+		}
+		else
+		{
+			record.result = BakeTexture(record.source, record.key) ? BAKE_BUILT : BAKE_FAILED;
+		}
+	}
+	else
+	{
+		MappedFile file;
+		MeshCacheView view;
+		Mesh mesh;
+		if (!force && OpenMeshCache(record.source, record.key, meshVertexFormat, file, view))
+		{
+			record.result = BAKE_REUSED;
+			for (uint32_t i = 0; i < view.header->dependencyCount; i++)
+				dependencies.push_back(MeshCacheDependencyPath(view, i, record.source));
+			UnmapFile(file);
+		}
+		else if (BakeMesh(record.source, record.key, pool, meshVertexFormat, mesh))
+		{
+			record.result = BAKE_BUILT;
+			dependencies = mesh.dependencies;
+		}
+		else
+		{
+			record.result = BAKE_FAILED;
+		}
+	}
+	if (record.result == BAKE_FAILED)
+		return;
+
+	record.inputs.clear();
+	record.textures.clear();
+	dependencies.insert(dependencies.begin(), record.source);
+	for (const std::string& path : dependencies)
+	{
+		BakeInput input;
+		input.path = path;
+		if (!StampSourceFile(path, true, input.stamp))
+			continue;
+		record.inputs.push_back(input);
+		if (HasExtension(path, "mtl"))
+		{
+			std::vector<std::string> textures = ReadMtlTextures(path);
+			record.textures.insert(record.textures.end(), textures.begin(), textures.end());
+		}
+	}
+}
+
+/**
+ * @brief Bakes a set of sources in parallel; files with the same contents go one after another
+ * on one thread, so only the first builds the shared entry.
+ *
+ * @param records The records to bake, with source, kind and key set.
+ * @param previous Which of them came from the manifest.
+ * @param force Rebuild even if the inputs did not change.
+ * @param pool The pool to bake on.
+ */
+void BakeAll(std::vector<BakeRecord>& records, const std::vector<char>& previous, bool force, ThreadPool& pool)
+{
+	std::map<std::pair<int, uint64_t>, std::vector<size_t>> groups;
+	for (size_t i = 0; i < records.size(); i++)
+		groups[std::make_pair((int)records[i].kind, records[i].key)].push_back(i);
+	std::vector<const std::vector<size_t>*> work;
+	for (const std::pair<const std::pair<int, uint64_t>, std::vector<size_t>>& group : groups)
+		work.push_back(&group.second);
+	ParallelFor(pool, work.size(), [&](size_t g)
+	{
+		bool built = false;
+		for (size_t i : *work[g])
+		{
+			BakeAsset(records[i], previous[i] != 0, force && !built, pool);
+			built = built || records[i].result == BAKE_BUILT;
+		}
+	});
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int threads = 0;
+	bool force = false;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "-j" && i + 1 < argc)
+			threads = (unsigned int)atoi(argv[++i]);
+		else if (option == "--force")
+			force = true;
+		else
+			paths.push_back(option);
+	}
+	if (paths.empty())
+		paths.push_back("resources");
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::string> sources;
+	for (const std::string& path : paths)
+	{
+		std::error_code ec;
+		BakeKind kind;
+		if (std::filesystem::is_directory(path, ec))
+		{
+			for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(path, ec))
+			{
+				if (entry.is_regular_file(ec) && HasBakeExtension(entry.path().generic_string(), kind))
+					sources.push_back(entry.path().generic_string());
+			}
+		}
+		else if (std::filesystem::is_regular_file(path, ec) && HasBakeExtension(path, kind))
+		{
+			sources.push_back(path);
+		}
+		else
+		{
+			printf("asset_baker - %s is not a model, an image or a directory\n", path.c_str());
+			return 1;
+		}
+	}
+	std::sort(sources.begin(), sources.end());
+	sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+	std::map<std::string, BakeRecord> manifest;
+	if (!ReadBakeManifest(manifest))
+		manifest.clear();
+
+	// Models first, then the textures their MTLs name that were not given
+	ThreadPool pool(threads);
+	size_t counts[4] = {};
+	std::vector<std::string> failed;
+	for (int pass = 0; pass < 2 && !sources.empty(); pass++)
+	{
+		std::vector<uint64_t> keys(sources.size());
+		std::vector<char> keyed(sources.size(), 0);
+		ParallelFor(pool, sources.size(), [&](size_t i)
+		{
+			keyed[i] = ContentKeyOf(sources[i], keys[i]) ? 1 : 0;
+		});
+		std::vector<BakeRecord> records;
+		std::vector<char> previous;
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			if (keyed[i] == 0)
+			{
+				counts[BAKE_FAILED]++;
+				failed.push_back(sources[i]);
+				manifest.erase(sources[i]);
+				continue;
+			}
+			std::map<std::string, BakeRecord>::iterator found = manifest.find(sources[i]);
+			records.push_back(found != manifest.end() ? found->second : BakeRecord());
+			previous.push_back(found != manifest.end() ? 1 : 0);
+			records.back().source = sources[i];
+			HasBakeExtension(sources[i], records.back().kind);
+			records.back().key = keys[i];
+		}
+		BakeAll(records, previous, force, pool);
+
+		std::vector<std::string> named;
+		for (const BakeRecord& record : records)
+		{
+			counts[record.result]++;
+			if (record.result == BAKE_FAILED)
+			{
+				failed.push_back(record.source);
+				manifest.erase(record.source);
+				continue;
+			}
+			manifest[record.source] = record;
+			for (const std::string& texture : record.textures)
+			{
+				BakeKind kind;
+				if (HasBakeExtension(texture, kind) && kind == BAKE_TEXTURE && !std::binary_search(sources.begin(), sources.end(), texture))
+					named.push_back(texture);
+			}
+		}
+		std::sort(named.begin(), named.end());
+		named.erase(std::unique(named.begin(), named.end()), named.end());
+		sources = named;
+	}
+
+	bool written = WriteBakeManifest(manifest);
+	printf("asset_baker - %zu built, %zu reused from the cache, %zu up to date, %zu failed in %.1f ms on %u threads\n",
+		counts[BAKE_BUILT], counts[BAKE_REUSED], counts[BAKE_UP_TO_DATE], counts[BAKE_FAILED],
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), pool.Size());
+	for (const std::string& path : failed)
+		printf("asset_baker - could not bake %s\n", path.c_str());
+	if (!written)
+		printf("asset_baker - could not write %s\n", BAKE_MANIFEST_PATH);
+	return failed.empty() && written ? 0 : 1;
+}
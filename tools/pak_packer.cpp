@@ -0,0 +1,121 @@
+// Packs shaders, models, textures and mesh cache entries into one archive that the viewer mounts
+// at startup (MountPak in mapfile.h), so loading opens a single file instead of one per asset.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -I. -Iinclude tools/pak_packer.cpp -o pak_packer
+//   ./pak_packer -z -o resources.pak phong.vert phong.frag resources cache
+//   ./pak_packer --list resources.pak
+//
+// Directories are packed recursively, under the paths the viewer asks for, so run it from the
+// directory the viewer runs in. Run the viewer once first to fill cache/ with processed meshes;
+// a packed cache entry is read straight from the archive mapping. With -z every file that
+// shrinks by at least an eighth is LZ-compressed, except extensions given with --store (by
+// default "mesh", which keeps cache entries zero-copy).
+
+#include <algorithm>
+#include <filesystem>
+
+#include "mapfile.h"
+
+int ListPak(const char* path)
+{
+	MappedFile file;
+	PakArchive pak;
+	if (!MapDiskFile(path, file) || !OpenPak(file.data, file.size, pak))
+	{
+		printf("pak_packer - %s is not a valid archive\n", path);
+		return 1;
+	}
+	std::vector<char> data;
+	int corrupt = 0;
+	for (uint32_t i = 0; i < pak.entryCount; i++)
+	{
+		const PakEntry& entry = pak.entries[i];
+		data.resize((size_t)entry.size);
+		bool valid = ReadPakEntry(pak, entry, data.data()) && XXH64(data.data(), data.size()) == entry.hash;
+		corrupt += valid ? 0 : 1;
+		printf("%10llu %10llu %s %s%s\n", (unsigned long long)entry.size, (unsigned long long)entry.storedSize,
+			(entry.flags & PAK_COMPRESSED) != 0 ? "lz" : "  ", PakEntryPath(pak, entry), valid ? "" : " CORRUPT");
+	}
+	printf("%u entries, %.1f KB\n", pak.entryCount, file.size / 1024.0);
+	UnmapFile(file);
+	return corrupt == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	std::string output = "resources.pak";
+	bool compress = false;
+	std::vector<std::string> stored = { "mesh" };
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--list" && i + 1 < argc)
+			return ListPak(argv[++i]);
+		else if (option == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else if (option == "-z")
+			compress = true;
+		else if (option == "--store" && i + 1 < argc)
+			stored.push_back(argv[++i]);
+		else
+			paths.push_back(option);
+	}
+	if (paths.empty())
+	{
+		printf("usage: %s [-z] [--store ext]... [-o out.pak] file-or-directory...\n       %s --list file.pak\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	std::vector<PakInput> inputs;
+	auto add = [&](const std::filesystem::path& file)
+	{
+		PakInput input;
+		input.file = file.generic_string();
+		input.path = input.file;
+		std::string extension = file.extension().string();
+		if (!extension.empty())
+			extension.erase(0, 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)(c | 0x20); });
+		input.compress = compress && std::find(stored.begin(), stored.end(), extension) == stored.end();
+		inputs.push_back(input);
+	};
+	for (const std::string& path : paths)
+	{
+		std::error_code ec;
+		if (std::filesystem::is_directory(path, ec))
+		{
+			for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(path, ec))
+			{
+				if (entry.is_regular_file(ec) && entry.path().extension() != ".tmp" && entry.path().generic_string() != output)
+					add(entry.path());
+			}
+		}
+		else if (std::filesystem::is_regular_file(path, ec))
+		{
+			add(path);
+		}
+		else
+		{
+			printf("pak_packer - %s does not exist\n", path.c_str());
+			return 1;
+		}
+	}
+
+	if (!WritePak(output, inputs))
+	{
+		printf("pak_packer - could not write %s\n", output.c_str());
+		return 1;
+	}
+	uintmax_t original = 0;
+	for (const PakInput& input : inputs)
+	{
+		std::error_code ec;
+		original += std::filesystem::file_size(input.file, ec);
+	}
+	std::error_code ec;
+	printf("pak_packer - %s: %zu files, %.1f KB from %.1f KB\n", output.c_str(), inputs.size(),
+		std::filesystem::file_size(output, ec) / 1024.0, original / 1024.0);
+	return 0;
+}
@@ -1,22 +1,41 @@
 #pragma once
 #include <iostream>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-char* read_file(const char* filename)
+#include "arena.h"
+#include "mapfile.h"
+
+#ifndef _WIN32
+#include <errno.h>
+
+typedef int errno_t;
+
+// MSVC's checked fopen, so the loaders also build on Linux (e.g. for bench/loader_bench.cpp)
+inline errno_t fopen_s(FILE** file, const char* filename, const char* mode)
 {
-	FILE* f;
-	fopen_s(&f, filename, "rb");
-	if (f == NULL)
+	*file = fopen(filename, mode);
+	return *file == NULL ? errno : 0;
+}
+#endif
+
+// Reads a whole file as a NUL-terminated string; free() it, or pass an arena to allocate from
+char* read_file(const char* filename, Arena* arena = NULL)
+{
+	MappedFile f;
+	if (!MapFile(filename, f))
 		return NULL;
-	fseek(f, 0, SEEK_END);
-	long size = ftell(f);
-	rewind(f);
-	char* bfr = (char*)malloc(sizeof(char) * (size + 1));
+	size_t size = f.size;
+	char* bfr = arena != NULL ? arena->AllocateArray<char>(size + 1) : (char*)malloc(sizeof(char) * (size + 1));
 	if (bfr == NULL)
+	{
+		UnmapFile(f);
 		return NULL;
-	long ret = fread(bfr, 1, size, f);
-	if (ret != size)
-		return NULL;
+	}
+	if (size > 0)
+		memcpy(bfr, f.data, size);
+	UnmapFile(f);
 	bfr[size] = '\0';
 	return bfr;
 }